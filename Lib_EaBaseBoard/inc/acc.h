@@ -8,6 +8,15 @@
 #ifndef __ACC_H
 #define __ACC_H
 
+#include "board.h"
+
+/* INT1/DRDY output of the MMA7455, DRDY or motion detection */
+#define ACC_DRDY_PORT BOARD_PORT(ACC_DRDY)
+#define ACC_DRDY_PIN  BOARD_PIN(ACC_DRDY)
+
+/* number of samples in the ring buffer, must be a power of 2 */
+#define ACC_RING_SIZE 32
+
 
 typedef enum
 {
@@ -24,6 +33,16 @@ typedef enum
     ACC_RANGE_4G,
 } acc_range_t;
 
+typedef void (*acc_callback_t)(int32_t status, int8_t x, int8_t y, int8_t z);
+
+typedef struct
+{
+    uint32_t time;  /* ms tick at the DRDY edge */
+    int8_t x;
+    int8_t y;
+    int8_t z;
+} acc_sample_t;
+
 
 void acc_init (void);
 
@@ -33,6 +52,15 @@ void acc_setMode(acc_mode_t mode);
 void acc_config_mode_LEVEL(void);
 void acc_config_mode_PULSE(void);
 void acc_intClr(void);
+int acc_read_async(acc_callback_t done);
+
+void acc_startSampling(uint32_t (*getMsTicks)(void));
+void acc_stopSampling(void);
+void acc_startMotionDetect(acc_mode_t mode, uint8_t threshold,
+        int8_t x, int8_t y, int8_t z, void (*motion)(void));
+void acc_drdyHandler(void);
+uint32_t acc_getSample(acc_sample_t *sample);
+uint32_t acc_getOverruns(void);
 
 
 #endif /* end __LIGHT_H */
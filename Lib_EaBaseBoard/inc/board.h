@@ -0,0 +1,145 @@
+/*****************************************************************************
+ *   board.h:  Pin map of the LPCXpresso Base Board
+ *
+******************************************************************************/
+#ifndef __BOARD_H
+#define __BOARD_H
+
+/*
+ * Every pin in use is listed once in BOARD_PINS:
+ *
+ *   X(a, name, port, pin, function, direction, idle level, interrupt)
+ *
+ * The function is the PINSEL value (0 = GPIO). For GPIO pins the interrupt
+ * selects the GPIOINT edge, for EINT0..3 (P2.10 - P2.13, function 1) the
+ * EXTMODE/EXTPOLAR setting. Outputs are driven to their idle level before
+ * they are switched to output.
+ *
+ * The register values written by board_init are computed from the table
+ * at compile time, and a pin listed twice fails the build (board.c). Pins
+ * the board shares between two parts are listed once and get a second
+ * name with BOARD_ALIAS.
+ *
+ * BOARD_PORT(name), BOARD_PIN(name) and BOARD_MASK(name) are the pin's
+ * port, bit and mask.
+ */
+
+/* temperature sensor on P0.2 or P0.6, selected by jumper J25 */
+//#define TEMP_USE_P0_6
+#ifdef TEMP_USE_P0_6
+#define BOARD_TEMP_PIN 6
+#else
+#define BOARD_TEMP_PIN 2
+#endif
+
+#define BOARD_IN  0
+#define BOARD_OUT 1
+
+#define BOARD_IRQ_NONE 0
+#define BOARD_IRQ_RISE 1
+#define BOARD_IRQ_FALL 2
+
+#define BOARD_PINS(X, a) \
+    X(a, UART3_TXD,  0,  0, 2, BOARD_IN,  0, BOARD_IRQ_NONE) \
+    X(a, UART3_RXD,  0,  1, 2, BOARD_IN,  0, BOARD_IRQ_NONE) \
+    X(a, TEMP,       0, BOARD_TEMP_PIN, \
+                            0, BOARD_IN,  0, BOARD_IRQ_RISE) \
+    X(a, ACC_DRDY,   0,  3, 0, BOARD_IN,  0, BOARD_IRQ_RISE) \
+    X(a, OLED_CS,    0,  6, 0, BOARD_OUT, 1, BOARD_IRQ_NONE) \
+    X(a, SSP1_SCK,   0,  7, 2, BOARD_IN,  0, BOARD_IRQ_NONE) \
+    X(a, SSP1_MISO,  0,  8, 2, BOARD_IN,  0, BOARD_IRQ_NONE) \
+    X(a, SSP1_MOSI,  0,  9, 2, BOARD_IN,  0, BOARD_IRQ_NONE) \
+    X(a, I2C2_SDA,   0, 10, 2, BOARD_IN,  0, BOARD_IRQ_NONE) \
+    X(a, I2C2_SCL,   0, 11, 2, BOARD_IN,  0, BOARD_IRQ_NONE) \
+    X(a, JOY_DOWN,   0, 15, 0, BOARD_IN,  0, BOARD_IRQ_FALL) \
+    X(a, JOY_RIGHT,  0, 16, 0, BOARD_IN,  0, BOARD_IRQ_FALL) \
+    X(a, JOY_CENTER, 0, 17, 0, BOARD_IN,  0, BOARD_IRQ_FALL) \
+    X(a, ROTARY_A,   0, 24, 0, BOARD_IN,  0, BOARD_IRQ_RISE) \
+    X(a, ROTARY_B,   0, 25, 0, BOARD_IN,  0, BOARD_IRQ_NONE) \
+    X(a, RGB_BLUE,   0, 26, 0, BOARD_OUT, 0, BOARD_IRQ_NONE) \
+    X(a, SPK_CLK,    0, 27, 0, BOARD_OUT, 0, BOARD_IRQ_NONE) \
+    X(a, SPK_UPDN,   0, 28, 0, BOARD_OUT, 0, BOARD_IRQ_NONE) \
+    X(a, RGB_RED,    2,  0, 0, BOARD_OUT, 0, BOARD_IRQ_NONE) \
+    X(a, OLED_VCC,   2,  1, 0, BOARD_OUT, 0, BOARD_IRQ_NONE) \
+    X(a, LED7_CS,    2,  2, 0, BOARD_OUT, 1, BOARD_IRQ_NONE) \
+    X(a, JOY_UP,     2,  3, 0, BOARD_IN,  0, BOARD_IRQ_FALL) \
+    X(a, JOY_LEFT,   2,  4, 0, BOARD_IN,  0, BOARD_IRQ_FALL) \
+    X(a, LIGHT_INT,  2,  5, 0, BOARD_IN,  0, BOARD_IRQ_FALL) \
+    X(a, OLED_DC,    2,  7, 0, BOARD_OUT, 0, BOARD_IRQ_NONE) \
+    X(a, EXT_LED,    2,  8, 0, BOARD_OUT, 0, BOARD_IRQ_NONE) \
+    X(a, SW3,        2, 10, 1, BOARD_IN,  0, BOARD_IRQ_FALL) \
+    X(a, SW4,        2, 11, 1, BOARD_IN,  0, BOARD_IRQ_FALL) \
+    X(a, SPK_SHUTDN, 2, 13, 0, BOARD_OUT, 0, BOARD_IRQ_NONE)
+
+#define BOARD_PORT(name) BOARD_PORT_##name
+#define BOARD_PIN(name)  BOARD_PIN_##name
+#define BOARD_MASK(name) (1UL << BOARD_PIN_##name)
+
+#define BOARD_ENUM(a, name, port, pin, func, dir, idle, irq) \
+    BOARD_PORT_##name = (port), BOARD_PIN_##name = (pin),
+
+#define BOARD_ALIAS(name, other) \
+    BOARD_PORT_##name = BOARD_PORT_##other, \
+    BOARD_PIN_##name = BOARD_PIN_##other,
+
+enum
+{
+    BOARD_PINS(BOARD_ENUM, 0)
+
+    /* green LED and OLED supply (keep the green LED off) */
+    BOARD_ALIAS(RGB_GREEN, OLED_VCC)
+    /* the speaker is driven together with the blue LED */
+    BOARD_ALIAS(SPEAKER, RGB_BLUE)
+    /* the dataflash shares the chip select of the 7-segment display */
+    BOARD_ALIAS(FLASH_CS, LED7_CS)
+
+    BOARD_PIN_END
+};
+
+/*
+ * Register values. The macros expand to constant expressions with one
+ * term per pin.
+ */
+
+#define BOARD_BIT(cond, pin) ((cond) ? 1UL << (pin) : 0UL)
+
+#define BOARD_PINSEL_TERM(reg, name, port, pin, func, dir, idle, irq) \
+    | (((port) * 2 + (pin) / 16 == (reg)) \
+            ? (unsigned long)(func) << ((pin) % 16 * 2) : 0UL)
+#define BOARD_DIR_TERM(p, name, port, pin, func, dir, idle, irq) \
+    | BOARD_BIT((port) == (p) && (dir) == BOARD_OUT, pin)
+#define BOARD_IDLE_TERM(p, name, port, pin, func, dir, idle, irq) \
+    | BOARD_BIT((port) == (p) && (dir) == BOARD_OUT && (idle), pin)
+#define BOARD_INTR_TERM(p, name, port, pin, func, dir, idle, irq) \
+    | BOARD_BIT((port) == (p) && (func) == 0 && (irq) == BOARD_IRQ_RISE, pin)
+#define BOARD_INTF_TERM(p, name, port, pin, func, dir, idle, irq) \
+    | BOARD_BIT((port) == (p) && (func) == 0 && (irq) == BOARD_IRQ_FALL, pin)
+
+/* EINTn on P2.(10 + n) with function 1 */
+#define BOARD_EINT(port, pin, func) \
+    ((port) == 2 && (pin) >= 10 && (pin) <= 13 && (func) == 1)
+#define BOARD_EXTMODE_TERM(a, name, port, pin, func, dir, idle, irq) \
+    | BOARD_BIT(BOARD_EINT(port, pin, func) && (irq) != BOARD_IRQ_NONE, \
+            ((pin) - 10) & 31)
+#define BOARD_EXTPOLAR_TERM(a, name, port, pin, func, dir, idle, irq) \
+    | BOARD_BIT(BOARD_EINT(port, pin, func) && (irq) == BOARD_IRQ_RISE, \
+            ((pin) - 10) & 31)
+
+/* PINSEL0..PINSEL4, two registers per port */
+#define BOARD_PINSEL(reg) (0UL BOARD_PINS(BOARD_PINSEL_TERM, reg))
+#define BOARD_FIODIR(port) (0UL BOARD_PINS(BOARD_DIR_TERM, port))
+#define BOARD_FIOSET(port) (0UL BOARD_PINS(BOARD_IDLE_TERM, port))
+#define BOARD_INTENR(port) (0UL BOARD_PINS(BOARD_INTR_TERM, port))
+#define BOARD_INTENF(port) (0UL BOARD_PINS(BOARD_INTF_TERM, port))
+#define BOARD_EXTMODE (0UL BOARD_PINS(BOARD_EXTMODE_TERM, 0))
+#define BOARD_EXTPOLAR (0UL BOARD_PINS(BOARD_EXTPOLAR_TERM, 0))
+
+
+void board_init (void);
+void board_enableInterrupts(void);
+
+
+#endif /* end __BOARD_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -12,6 +12,11 @@
 void eeprom_init (void);
 int16_t eeprom_read(uint8_t* buf, uint16_t offset, uint16_t len);
 int16_t eeprom_write(uint8_t* buf, uint16_t offset, uint16_t len);
+int16_t eeprom_read_async(uint8_t* buf, uint16_t offset, uint16_t len,
+        void (*done)(int32_t status, void *arg), void *arg);
+int16_t eeprom_write_async(uint8_t* buf, uint16_t offset, uint16_t len,
+        void (*done)(int32_t status, void *arg), void *arg);
+uint8_t eeprom_isWriting(void);
 
 
 #endif /* end __EEPROM_H */
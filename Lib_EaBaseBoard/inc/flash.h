@@ -13,6 +13,9 @@
 uint32_t flash_init (void);
 uint32_t flash_write(uint8_t* buf, uint32_t offset, uint32_t len);
 uint32_t flash_read(uint8_t* buf, uint32_t offset, uint32_t len);
+uint32_t flash_writeAsync(uint8_t* buf, uint32_t offset, uint32_t len,
+        void (*done)(uint32_t written));
+uint32_t flash_isBusy(void);
 
 void flash_setToBinaryPageSize(void);
 uint16_t flash_getPageSize(void);
@@ -0,0 +1,33 @@
+/*****************************************************************************
+ *   fmt.h:  Header file for the integer and fixed-point text formatting
+ *
+******************************************************************************/
+#ifndef __FMT_H
+#define __FMT_H
+
+#include <stdint.h>
+
+/*
+ * Longest number without padding: sign, 10 digits, decimal point. A
+ * buffer must hold the larger of this and the field width, plus the NUL.
+ */
+#define FMT_NUM_LEN 12
+
+/* most decimals of fmt_fixed */
+#define FMT_MAX_DECIMALS 9
+
+/*
+ * width > 0 right aligns the number in width characters, width < 0 left
+ * aligns it in -width characters (padding with blanks after it, e.g. to
+ * cover a longer text drawn before), 0 writes the number only. Numbers
+ * longer than the width are written in full.
+ */
+uint8_t fmt_uint(char *buf, uint32_t value, int8_t width);
+uint8_t fmt_int(char *buf, int32_t value, int8_t width);
+uint8_t fmt_fixed(char *buf, int32_t value, uint8_t decimals, int8_t width);
+
+
+#endif /* end __FMT_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -9,6 +9,7 @@
 #define __FONT5x7_H
 
 extern const unsigned char font5x7[][8];
+extern const unsigned char font5x7_col[][6];
 
 
 #endif /* end __FONT5x7_H */
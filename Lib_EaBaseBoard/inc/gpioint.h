@@ -0,0 +1,52 @@
+/*****************************************************************************
+ *   gpioint.h:  Header file for the GPIO interrupt dispatcher (EINT3)
+ *
+******************************************************************************/
+#ifndef __GPIOINT_H
+#define __GPIOINT_H
+
+/* edges, see gpioint_pin_t */
+#define GPIOINT_RISE 0x01
+#define GPIOINT_FALL 0x02
+
+/* most pins in a table */
+#define GPIOINT_MAX_PINS 32
+
+/* number of queued events, must be a power of 2 */
+#define GPIOINT_QUEUE_SIZE 16
+
+/*
+ * One entry per interrupt pin. With a handler the edge is handled in the
+ * interrupt, otherwise it is queued as an event for gpioint_getEvent. An
+ * edge less than 'debounce' ms after the last accepted edge of the same
+ * pin is dropped.
+ */
+typedef struct
+{
+    uint8_t port;           /* 0 or 2 */
+    uint8_t pin;
+    uint8_t edges;          /* GPIOINT_RISE / GPIOINT_FALL */
+    uint16_t debounce;      /* ms, 0 for none */
+    void (*handler)(void);  /* NULL: queue the edge */
+} gpioint_pin_t;
+
+typedef struct
+{
+    uint8_t id;             /* index in the pin table */
+    uint8_t edge;           /* GPIOINT_RISE or GPIOINT_FALL */
+    uint32_t time;          /* ms */
+    uint32_t levels;        /* the port's pins (FIOPIN) at the interrupt */
+} gpioint_event_t;
+
+
+void gpioint_init (const gpioint_pin_t *pins, uint8_t numPins,
+        uint32_t (*getMsTicks)(void), void (*notify)(void));
+void gpioint_dispatch(void);
+int gpioint_getEvent(gpioint_event_t *event);
+uint32_t gpioint_getDropped(void);
+
+
+#endif /* end __GPIOINT_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -0,0 +1,56 @@
+/*****************************************************************************
+ *   i2c2.h:  Header file for the shared I2C2 transaction engine
+ *
+******************************************************************************/
+#ifndef __I2C2_H
+#define __I2C2_H
+
+/* number of transactions that can be queued, must be a power of 2 */
+#define I2C2_QUEUE_SIZE 16
+
+#define I2C2_XFER_OK     0
+#define I2C2_XFER_ERROR  (-1)
+
+typedef void (*i2c2_callback_t)(int32_t status, void *arg);
+
+/*
+ * Transaction descriptor. The tx bytes are written first, followed by a
+ * repeated start and the read of rx bytes. Either part may be empty
+ * (length 0).
+ *
+ * The descriptor and its buffers are owned by the engine from i2c2_submit
+ * until 'pending' has been cleared, which happens right before the
+ * callback is called.
+ */
+typedef struct i2c2_xact
+{
+    uint8_t  addr;      /* 7-bit slave address */
+
+    uint8_t *tx;
+    uint32_t txLen;
+    uint8_t *rx;
+    uint32_t rxLen;
+
+    i2c2_callback_t done;
+    void *arg;
+
+    volatile uint8_t pending;
+} i2c2_xact_t;
+
+
+void i2c2_init (void);
+int i2c2_submit(i2c2_xact_t *xact);
+int i2c2_read(uint8_t addr, uint8_t* buf, uint32_t len);
+int i2c2_write(uint8_t addr, uint8_t* buf, uint32_t len);
+int i2c2_writeRead(uint8_t addr, uint8_t* tx, uint32_t txLen,
+        uint8_t* rx, uint32_t rxLen);
+void i2c2_lock(void);
+void i2c2_unlock(void);
+uint8_t i2c2_isBusy(void);
+void i2c2_waitIdle(void);
+
+
+#endif /* end __I2C2_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -40,6 +40,8 @@ typedef enum
     LIGHT_CYCLE_16
 } light_cycle_t;
 
+typedef void (*light_callback_t)(int32_t status, uint32_t lux);
+
 
 void light_init (void);
 void light_enable (void);
@@ -54,6 +56,11 @@ uint8_t light_getIrqStatus(void);
 void light_clearIrqStatus(void);
 void light_shutdown(void);
 
+int light_read_async(light_callback_t done);
+int light_setHiThreshold_async(uint32_t luxTh);
+int light_setLoThreshold_async(uint32_t luxTh);
+int light_clearIrqStatus_async(void);
+
 
 #endif /* end __LIGHT_H */
 /****************************************************************************
@@ -10,6 +10,11 @@
 
 #define OLED_DISPLAY_WIDTH  96
 #define OLED_DISPLAY_HEIGHT 64
+#define OLED_DISPLAY_PAGES  (OLED_DISPLAY_HEIGHT >> 3)
+
+/* framebuffer: OLED_DISPLAY_PAGES pages of OLED_DISPLAY_WIDTH columns,
+   bit 0 of a column byte is the top pixel */
+#define OLED_FB_SIZE (OLED_DISPLAY_WIDTH * OLED_DISPLAY_PAGES)
 
 
 typedef enum
@@ -18,6 +23,12 @@ typedef enum
     OLED_COLOR_WHITE
 } oled_color_t;
 
+typedef enum
+{
+    OLED_FLUSH_IMMEDIATE, /* every drawing call is written to the display */
+    OLED_FLUSH_DEFERRED   /* drawing calls only update the framebuffer */
+} oled_flush_mode_t;
+
 
 void oled_init (void);
 void oled_putPixel(uint8_t x, uint8_t y, oled_color_t color);
@@ -33,6 +44,10 @@ uint8_t oled_putBigChar(uint8_t x, uint8_t y, uint8_t ch, oled_color_t fb, oled_
 void oled_putBigPixel(uint8_t x, uint8_t y, oled_color_t color, uint8_t size);
 void oled_putBigString(uint8_t x, uint8_t y, uint8_t *pStr, oled_color_t fb,
         oled_color_t bg, uint8_t size);
+void oled_setFlushMode(oled_flush_mode_t mode);
+void oled_flush(void);
+void oled_loadFramebuffer(const uint8_t *fb);
+const uint8_t *oled_getFramebuffer(void);
 
 
 #endif /* end __OLED_H */
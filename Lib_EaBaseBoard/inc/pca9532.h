@@ -52,6 +52,7 @@
 void pca9532_init (void);
 uint16_t pca9532_getLedState (uint32_t shadow);
 void pca9532_setLeds (uint16_t ledOnMask, uint16_t ledOffMask);
+void pca9532_setLeds_async (uint16_t ledOnMask, uint16_t ledOffMask);
 void pca9532_setBlink0Period(uint8_t period);
 void pca9532_setBlink0Duty(uint8_t duty);
 void pca9532_setBlink0Leds(uint16_t ledMask);
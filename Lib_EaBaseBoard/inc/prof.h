@@ -0,0 +1,85 @@
+/*****************************************************************************
+ *   prof.h:  Header file for the cycle counting profiler
+ *
+******************************************************************************/
+#ifndef __PROF_H
+#define __PROF_H
+
+#include <stdint.h>
+
+/* set to 0 to compile all zones out */
+#ifndef PROF_ENABLED
+#define PROF_ENABLED 1
+#endif
+
+/* power of two histogram buckets: bucket n counts durations < 2^(n+1) */
+#define PROF_HIST_BINS 20
+
+/* stimulus port the measurements are streamed on when ITM is enabled */
+#define PROF_ITM_PORT 1
+
+/* longest line produced by prof_formatZone */
+#define PROF_LINE_LEN 120
+
+/*
+ * Time source. On the target it is the DWT cycle counter (not described
+ * by CMSIS 1.30). Host builds define PROF_HOST and supply prof_port_ticks.
+ */
+#ifdef PROF_HOST
+uint32_t prof_port_ticks(void);
+#define PROF_TICKS() prof_port_ticks()
+#define PROF_TICK_UNIT "ns"
+#else
+#define PROF_DWT_CTRL   (*(volatile uint32_t *)0xE0001000)
+#define PROF_DWT_CYCCNT (*(volatile uint32_t *)0xE0001004)
+#define PROF_TICKS() (PROF_DWT_CYCCNT)
+#define PROF_TICK_UNIT "cyc"
+#endif
+
+typedef struct prof_zone
+{
+    const char *name;
+
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t hist[PROF_HIST_BINS];
+
+    uint8_t id;         /* 0 until the zone has been entered once */
+    struct prof_zone *next;
+} prof_zone_t;
+
+/*
+ * Zones are defined at file scope and measured with a BEGIN/END pair in
+ * the same block:
+ *
+ *   PROF_ZONE(flushZone, "oled_flush");
+ *   ...
+ *   PROF_BEGIN(flushZone);
+ *   ...
+ *   PROF_END(flushZone);
+ */
+#if PROF_ENABLED
+#define PROF_ZONE(zone, zname) static prof_zone_t zone = { .name = (zname) }
+#define PROF_BEGIN(zone) uint32_t zone##_t0 = PROF_TICKS()
+#define PROF_END(zone) prof_record(&(zone), PROF_TICKS() - zone##_t0)
+#else
+#define PROF_ZONE(zone, zname) typedef int zone##_unused
+#define PROF_BEGIN(zone) do {} while (0)
+#define PROF_END(zone) do {} while (0)
+#endif
+
+
+void prof_init (void);
+void prof_record(prof_zone_t *zone, uint32_t ticks);
+void prof_reset(void);
+uint32_t prof_numZones(void);
+int prof_formatZone(uint32_t index, char *buf, uint32_t len);
+uint32_t prof_getDropped(void);
+
+
+#endif /* end __PROF_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
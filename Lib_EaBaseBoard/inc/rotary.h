@@ -12,9 +12,14 @@
 #define ROTARY_RIGHT 1
 #define ROTARY_LEFT  2
 
+/* no step for this long and the velocity starts over at 0 */
+#define ROTARY_IDLE_MS 250
+
 
 void rotary_init (void);
 uint8_t rotary_read(void);
+int8_t rotary_decode(uint32_t levels, uint32_t time);
+int32_t rotary_getVelocity(uint32_t now);
 
 
 #endif /* end __ROTARY_H */
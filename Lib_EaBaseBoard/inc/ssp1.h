@@ -0,0 +1,62 @@
+/*****************************************************************************
+ *   ssp1.h:  Header file for the SSP1 bus manager
+ *
+******************************************************************************/
+#ifndef __SSP1_H
+#define __SSP1_H
+
+/* largest phase a single DMA request can handle */
+#define SSP1_MAX_XFER_LEN 4095
+
+/* number of transactions that can be queued, must be a power of 2 */
+#define SSP1_QUEUE_SIZE 16
+
+#define SSP1_XFER_OK     0
+#define SSP1_XFER_ERROR  (-1)
+
+typedef void (*ssp1_callback_t)(int32_t status, void *arg);
+
+/*
+ * Transaction descriptor. The chip select (active low) is asserted for the
+ * whole transaction. If dcMask is non-zero the D/C line is driven low during
+ * the command phase and high during the data phase. Either phase may be
+ * empty (length 0).
+ *
+ * The descriptor and its buffers are owned by the bus manager from
+ * ssp1_submit until 'pending' has been cleared, which happens right before
+ * the callback is called.
+ */
+typedef struct ssp1_xact
+{
+    uint8_t  csPort;
+    uint32_t csMask;
+    uint8_t  dcPort;
+    uint32_t dcMask;
+
+    uint8_t *cmd;
+    uint16_t cmdLen;
+
+    uint8_t *tx;        /* NULL to send 0xFF */
+    uint8_t *rx;        /* NULL to discard */
+    uint16_t len;
+
+    ssp1_callback_t done;
+    void *arg;
+
+    volatile uint8_t pending;
+} ssp1_xact_t;
+
+
+void ssp1_init (void);
+int ssp1_submit(ssp1_xact_t *xact);
+void ssp1_lock(void);
+void ssp1_unlock(void);
+uint8_t ssp1_isReady(void);
+uint8_t ssp1_isBusy(void);
+void ssp1_waitIdle(void);
+
+
+#endif /* end __SSP1_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -8,9 +8,21 @@
 #ifndef __TEMP_H
 #define __TEMP_H
 
+#include "board.h"
+
+/* P0.2 or P0.6 selected by jumper J25, see board.h */
+#define TEMP_PORT BOARD_PORT(TEMP)
+#define TEMP_PIN  BOARD_PIN(TEMP)
+
+/* returned by temp_read_latest until the first measurement has completed */
+#define TEMP_NO_READING ((int32_t)0x80000000)
+
 
 void temp_init (uint32_t (*getMsTick)(void));
 int32_t temp_read(void);
+int32_t temp_read_latest(void);
+uint32_t temp_getMeasurements(void);
+void temp_edgeHandler(void);
 
 
 #endif /* end __TEMP_H */
@@ -25,6 +25,8 @@ void uart2_sendString(uint8_t *string);
 uint32_t uart2_receive(uint8_t *buffer, uint32_t length, uint32_t blocking);
 uint8_t uart2_getModemStatus(void);
 void uart2_setModemStatus(uint8_t msr);
+int uart2_send_async(uint8_t *buffer, uint32_t length,
+        void (*done)(int32_t status, void *arg), void *arg);
 
 
 
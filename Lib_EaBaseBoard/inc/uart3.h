@@ -0,0 +1,25 @@
+/*****************************************************************************
+ *   uart3.h:  Header file for the interrupt driven UART3 transmitter
+ *
+******************************************************************************/
+#ifndef __UART3_H
+#define __UART3_H
+
+/* size of the transmit ring, must be a power of 2 */
+#define UART3_TX_SIZE 512
+
+
+void uart3_init (void);
+uint8_t *uart3_reserve(uint32_t len);
+void uart3_commit(uint32_t len);
+int uart3_send(const uint8_t *data, uint32_t len);
+int uart3_sendString(const char *string);
+uint32_t uart3_getDropped(void);
+uint8_t uart3_isBusy(void);
+void uart3_waitIdle(void);
+
+
+#endif /* end __UART3_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
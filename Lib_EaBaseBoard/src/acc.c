@@ -16,13 +16,12 @@
  *****************************************************************************/
 
 #include "lpc17xx_i2c.h"
+#include "i2c2.h"
 #include "acc.h"
 
 /******************************************************************************
  * Defines and typedefs
  *****************************************************************************/
-#define I2CDEV LPC_I2C2
-
 #define ACC_I2C_ADDR    (0x1D)
 
 #define ACC_ADDR_XOUTL  0x00
@@ -59,10 +58,26 @@
 #define ACC_MCTL_MODE(m) ((m) << 0)
 #define ACC_MCTL_GLVL(g) ((g) << 2)
 
+#define ACC_MCTL_DRPD    0x40    /* DRDY not routed to the INT1 pin */
+
+#define ACC_CTL1_INTREG(r) ((r) << 1)
+
+/* INTREG: INT1 detects level (INT2 pulse), or INT1 detects pulse */
+#define ACC_INTREG_LEVEL 0
+#define ACC_INTREG_PULSE 1
+
+/* pulse detection: longest pulse counted, 0.5 ms units */
+#define ACC_PULSE_WIDTH 0x0F
+
+/* offset drift registers: 1/128 g, i.e. 2 per count in the 2g range */
+#define ACC_OFFSET_PER_2G_COUNT 2
+
 #define ACC_STATUS_DRDY 0x01
 #define ACC_STATUS_DOVR 0x02
 #define ACC_STATUS_PERR 0x04
 
+#define ACC_RING_MASK (ACC_RING_SIZE - 1)
+
 /******************************************************************************
  * External global variables
  *****************************************************************************/
@@ -71,48 +86,46 @@
  * Local variables
  *****************************************************************************/
 
-static int I2CRead(uint8_t addr, uint8_t* buf, uint32_t len) {
-	I2C_M_SETUP_Type rxsetup;
-
-	rxsetup.sl_addr7bit = addr;
-	rxsetup.tx_data = NULL;	// Get address to read at writing address
-	rxsetup.tx_length = 0;
-	rxsetup.rx_data = buf;
-	rxsetup.rx_length = len;
-	rxsetup.retransmissions_max = 3;
+/* state of acc_read_async */
+static i2c2_xact_t readXact;
+static uint8_t readAddr = ACC_ADDR_XOUT8;
+static uint8_t readBuf[3];
+static acc_callback_t readCb = NULL;
 
-	if (I2C_MasterTransferData(I2CDEV, &rxsetup, I2C_TRANSFER_POLLING)
-			== SUCCESS) {
-		return (0);
-	} else {
-		return (-1);
-	}
-}
+/*
+ * DRDY triggered sampling. Burst reads are completed in the I2C interrupt
+ * which is the only writer of ringHead; acc_getSample is the only writer
+ * of ringTail.
+ */
+static uint32_t (*getTime)(void) = NULL;
+static i2c2_xact_t sampleXact;
+static uint8_t sampleAddr = ACC_ADDR_XOUT8;
+static uint8_t sampleBuf[3];
+static uint32_t sampleTime = 0;
+static volatile uint8_t sampling = 0;
+static volatile uint8_t drdyMissed = 0;
 
-static int I2CWrite(uint8_t addr, uint8_t* buf, uint32_t len) {
-	I2C_M_SETUP_Type txsetup;
+/*
+ * Motion detection (acc_startMotionDetect). The INT1 pin carries the
+ * level or pulse interrupt instead of DRDY, so acc_drdyHandler calls
+ * motionCb. measureMctl and zero offsets are restored when sampling
+ * starts again.
+ */
+static volatile uint8_t detecting = 0;
+static void (*motionCb)(void) = NULL;
+static uint8_t measureMctl = 0;
 
-	txsetup.sl_addr7bit = addr;
-	txsetup.tx_data = buf;
-	txsetup.tx_length = len;
-	txsetup.rx_data = NULL;
-	txsetup.rx_length = 0;
-	txsetup.retransmissions_max = 3;
-
-	if (I2C_MasterTransferData(I2CDEV, &txsetup, I2C_TRANSFER_POLLING)
-			== SUCCESS) {
-		return (0);
-	} else {
-		return (-1);
-	}
-}
+static acc_sample_t ring[ACC_RING_SIZE];
+static volatile uint32_t ringHead = 0;
+static volatile uint32_t ringTail = 0;
+static volatile uint32_t overruns = 0;
 
 static uint8_t getStatus(void) {
 	uint8_t buf[1];
 
 	buf[0] = ACC_ADDR_STATUS;
-	I2CWrite(ACC_I2C_ADDR, buf, 1);
-	I2CRead(ACC_I2C_ADDR, buf, 1);
+	i2c2_write(ACC_I2C_ADDR, buf, 1);
+	i2c2_read(ACC_I2C_ADDR, buf, 1);
 
 	return buf[0];
 }
@@ -121,8 +134,8 @@ static uint8_t getModeControl(void) {
 	uint8_t buf[1];
 
 	buf[0] = ACC_ADDR_MCTL;
-	I2CWrite(ACC_I2C_ADDR, buf, 1);
-	I2CRead(ACC_I2C_ADDR, buf, 1);
+	i2c2_write(ACC_I2C_ADDR, buf, 1);
+	i2c2_read(ACC_I2C_ADDR, buf, 1);
 
 	return buf[0];
 }
@@ -132,13 +145,116 @@ static void setModeControl(uint8_t mctl) {
 
 	buf[0] = ACC_ADDR_MCTL;
 	buf[1] = mctl;
-	I2CWrite(ACC_I2C_ADDR, buf, 2);
+	i2c2_write(ACC_I2C_ADDR, buf, 2);
+}
+
+static void setRegister(uint8_t addr, uint8_t value) {
+	uint8_t buf[2];
+
+	buf[0] = addr;
+	buf[1] = value;
+	i2c2_write(ACC_I2C_ADDR, buf, 2);
+}
+
+/* XOFF, YOFF and ZOFF, 11 bit signed, in one transfer */
+static void setOffsets(int16_t x, int16_t y, int16_t z) {
+	uint8_t buf[7];
+
+	buf[0] = ACC_ADDR_XOFFL;
+	buf[1] = x & 0xFF;
+	buf[2] = (x >> 8) & 0x07;
+	buf[3] = y & 0xFF;
+	buf[4] = (y >> 8) & 0x07;
+	buf[5] = z & 0xFF;
+	buf[6] = (z >> 8) & 0x07;
+	i2c2_write(ACC_I2C_ADDR, buf, 7);
 }
 
 /******************************************************************************
  * Local Functions
  *****************************************************************************/
 
+/* back to measurement mode with DRDY on INT1 */
+static void stopDetection(void) {
+	if (!detecting) {
+		return;
+	}
+
+	detecting = 0;
+	setOffsets(0, 0, 0);
+	setModeControl(measureMctl);
+	acc_intClr();
+}
+
+/*
+ * Burst read of XOUT8, YOUT8 and ZOUT8. The register address auto-increments
+ * only within one transfer, i.e. the address must be written followed by a
+ * repeated start (not a stop) before reading the three bytes.
+ */
+static int submitBurst(i2c2_xact_t *x, uint8_t *addr, uint8_t *buf,
+		i2c2_callback_t done) {
+	*addr = ACC_ADDR_XOUT8;
+
+	x->addr = ACC_I2C_ADDR;
+	x->tx = addr;
+	x->txLen = 1;
+	x->rx = buf;
+	x->rxLen = 3;
+	x->done = done;
+	x->arg = NULL;
+
+	return i2c2_submit(x);
+}
+
+static void readDone(int32_t status, void *arg) {
+	acc_callback_t cb = readCb;
+
+	readCb = NULL;
+
+	if (cb != NULL) {
+		cb(status, (int8_t) readBuf[0], (int8_t) readBuf[1],
+				(int8_t) readBuf[2]);
+	}
+}
+
+static void sampleDone(int32_t status, void *arg);
+
+static void startSample(void) {
+	sampleTime = (getTime != NULL ? getTime() : 0);
+
+	if (submitBurst(&sampleXact, &sampleAddr, sampleBuf, sampleDone) != 0) {
+		/* retried on the next DRDY edge or completion */
+		drdyMissed = 1;
+	}
+}
+
+static void sampleDone(int32_t status, void *arg) {
+	acc_sample_t *s;
+
+	if (status == I2C2_XFER_OK) {
+		if (ringHead - ringTail < ACC_RING_SIZE) {
+			s = &ring[ringHead & ACC_RING_MASK];
+			s->time = sampleTime;
+			s->x = (int8_t) sampleBuf[0];
+			s->y = (int8_t) sampleBuf[1];
+			s->z = (int8_t) sampleBuf[2];
+			ringHead++;
+		}
+		else {
+			overruns++;
+		}
+	}
+
+	/*
+	 * DRDY stays high until the data has been read. A DRDY edge seen while
+	 * the previous read was in progress would otherwise be lost for good.
+	 */
+	if (sampling && drdyMissed) {
+		drdyMissed = 0;
+		startSample();
+	}
+}
+
 /******************************************************************************
  * Public Functions
  *****************************************************************************/
@@ -170,33 +286,19 @@ void acc_init(void) {
  *
  *****************************************************************************/
 void acc_read(int8_t *x, int8_t *y, int8_t *z) {
-	uint8_t buf[1];
+	uint8_t buf[3];
 
 	/* wait for ready flag */
 	while ((getStatus() & ACC_STATUS_DRDY) == 0)
 		;
 
-	/*
-	 * Have experienced problems reading all registers
-	 * at once. Change to reading them one-by-one.
-	 */
+	/* burst read with repeated start, see submitBurst */
 	buf[0] = ACC_ADDR_XOUT8;
-	I2CWrite(ACC_I2C_ADDR, buf, 1);
-	I2CRead(ACC_I2C_ADDR, buf, 1);
+	i2c2_writeRead(ACC_I2C_ADDR, buf, 1, buf, 3);
 
 	*x = (int8_t) buf[0];
-
-	buf[0] = ACC_ADDR_YOUT8;
-	I2CWrite(ACC_I2C_ADDR, buf, 1);
-	I2CRead(ACC_I2C_ADDR, buf, 1);
-
-	*y = (int8_t) buf[0];
-
-	buf[0] = ACC_ADDR_ZOUT8;
-	I2CWrite(ACC_I2C_ADDR, buf, 1);
-	I2CRead(ACC_I2C_ADDR, buf, 1);
-
-	*z = (int8_t) buf[0];
+	*y = (int8_t) buf[1];
+	*z = (int8_t) buf[2];
 }
 
 /******************************************************************************
@@ -245,25 +347,25 @@ void acc_config_mode_LEVEL(void) {
 	// reg 18 THOPT = 0
 	// reg 18 INTREG[1:0] = 01 (level detection on int pin 2 == PIO1_8)
 	buf[0] = ACC_ADDR_CTL1;
-	I2CRead(ACC_I2C_ADDR, buf, 1);
+	i2c2_read(ACC_I2C_ADDR, buf, 1);
 
 	buf[1] = buf[0] |= 0x02;
 	buf[0] = ACC_ADDR_CTL1;
-	I2CWrite(ACC_I2C_ADDR, buf, 2);
+	i2c2_write(ACC_I2C_ADDR, buf, 2);
 
 	// reg 19 LDPL = 0 (level detect polarity +ve)
 	buf[0] = ACC_ADDR_CTL2;
-	I2CWrite(ACC_I2C_ADDR, buf, 1);
-	I2CRead(ACC_I2C_ADDR, buf, 1);
+	i2c2_write(ACC_I2C_ADDR, buf, 1);
+	i2c2_read(ACC_I2C_ADDR, buf, 1);
 
 	buf[1] = buf[0] & ~(0x01);
 	buf[0] = ACC_ADDR_CTL2;
-	I2CWrite(ACC_I2C_ADDR, buf, 2);
+	i2c2_write(ACC_I2C_ADDR, buf, 2);
 
 	// reg 1A LDTH = 2F (threshold)
 	buf[0] = ACC_ADDR_LDTH;
 	buf[1] = 0x2F;
-	I2CWrite(ACC_I2C_ADDR, buf, 2);
+	i2c2_write(ACC_I2C_ADDR, buf, 2);
 
 	acc_intClr();
 }
@@ -274,52 +376,234 @@ void acc_config_mode_PULSE(void) {
 	// reg 18 THOPT = 0
 	// reg 18 INTREG[1:0] = 10 - double pulse
 	buf[0] = ACC_ADDR_CTL1;
-	I2CRead(ACC_I2C_ADDR, buf, 1);
+	i2c2_read(ACC_I2C_ADDR, buf, 1);
 
 	buf[1] = buf[0] |= 0x00;
 	buf[0] = ACC_ADDR_CTL1;
-	I2CWrite(ACC_I2C_ADDR, buf, 2);
+	i2c2_write(ACC_I2C_ADDR, buf, 2);
 
 	// reg 19 LDPL = 0 (level detect polarity +ve)
 	buf[0] = ACC_ADDR_CTL2;
-	I2CWrite(ACC_I2C_ADDR, buf, 1);
-	I2CRead(ACC_I2C_ADDR, buf, 1);
+	i2c2_write(ACC_I2C_ADDR, buf, 1);
+	i2c2_read(ACC_I2C_ADDR, buf, 1);
 
 	buf[1] = buf[0] & ~(0x01);
 	buf[0] = ACC_ADDR_CTL2;
-	I2CWrite(ACC_I2C_ADDR, buf, 2);
+	i2c2_write(ACC_I2C_ADDR, buf, 2);
 
 	// reg 1B PDTH = 2F (threshold)
 	buf[0] = ACC_ADDR_PDTH;
 	buf[1] = 0x2F;
-	I2CWrite(ACC_I2C_ADDR, buf, 2);
+	i2c2_write(ACC_I2C_ADDR, buf, 2);
 
 	// reg 1C pulse dur
 	buf[0] = ACC_ADDR_PW;
 	buf[1] = 0x0F;
-	I2CWrite(ACC_I2C_ADDR, buf, 2);
+	i2c2_write(ACC_I2C_ADDR, buf, 2);
 
 //	// reg 1D time latency
 //	buf[0] = ACC_ADDR_LT ;
 //	buf[1] = 0x0F;
-//	I2CWrite(ACC_I2C_ADDR, buf, 2);
+//	i2c2_write(ACC_I2C_ADDR, buf, 2);
 //
 //	// reg 1E 2nd window time
 //	buf[0] = ACC_ADDR_TW ;
 //	buf[1] = 0x0F;
-//	I2CWrite(ACC_I2C_ADDR, buf, 2);
+//	i2c2_write(ACC_I2C_ADDR, buf, 2);
+
+	acc_intClr();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Start reading accelerometer data in the background. The callback is
+ *    called from the I2C interrupt when all three axes have been read.
+ *    Unlike acc_read this doesn't wait for the data ready flag.
+ *
+ * Params:
+ *   [in] done - callback receiving the status and the x, y, z values
+ *
+ * Returns:
+ *   0 if the read was started, -1 if a read is already in progress
+ *
+ *****************************************************************************/
+int acc_read_async(acc_callback_t done) {
+	if (readXact.pending || readCb != NULL) {
+		return (-1);
+	}
+
+	readCb = done;
+
+	if (submitBurst(&readXact, &readAddr, readBuf, readDone) != 0) {
+		readCb = NULL;
+		return (-1);
+	}
 
+	return (0);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Start sampling triggered by the DRDY output of the MMA7455. The
+ *    application must call acc_drdyHandler on each rising edge of the
+ *    DRDY pin (ACC_DRDY_PORT/ACC_DRDY_PIN). Samples are stored in a ring
+ *    buffer of ACC_RING_SIZE entries, see acc_getSample.
+ *
+ * Params:
+ *   [in] getMsTicks - callback function for retrieving number of elapsed
+ *                     ticks, used to timestamp the samples. May be NULL.
+ *
+ *****************************************************************************/
+void acc_startSampling(uint32_t (*getMsTicks)(void)) {
+	stopDetection();
+
+	getTime = getMsTicks;
+	ringTail = ringHead;
+	overruns = 0;
+	drdyMissed = 0;
+	sampling = 1;
+
+	/* reading clears DRDY so that the next sample gives a new edge */
+	acc_drdyHandler();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Stop DRDY triggered sampling and motion detection. Samples already
+ *    in the ring buffer can still be retrieved. Must not be called from
+ *    an interrupt handler.
+ *
+ *****************************************************************************/
+void acc_stopSampling(void) {
+	sampling = 0;
+	stopDetection();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Stop sampling and let the MMA7455 watch for motion by itself: level
+ *    or pulse detection on any axis, signalled on the INT1 pin instead of
+ *    DRDY. The resting acceleration (gravity) is cancelled with the offset
+ *    registers, so the threshold applies to the change from rest in
+ *    either direction. No I2C traffic until a detection. The callback is
+ *    called from acc_drdyHandler, i.e. interrupt context, on the first
+ *    detection; acc_startSampling or acc_stopSampling end the detection.
+ *
+ * Params:
+ *   [in] mode - ACC_MODE_LEVEL or ACC_MODE_PULSE
+ *   [in] threshold - change to detect, 0..127 counts in the 8g range
+ *                    (16 per g)
+ *   [in] x, y, z - resting acceleration, counts in the 2g range (64 per g)
+ *   [in] motion - called on detection
+ *
+ *****************************************************************************/
+void acc_startMotionDetect(acc_mode_t mode, uint8_t threshold,
+		int8_t x, int8_t y, int8_t z, void (*motion)(void)) {
+	uint8_t intreg = ACC_INTREG_LEVEL;
+
+	sampling = 0;
+	if (!detecting) {
+		measureMctl = getModeControl();
+	}
+	motionCb = motion;
+
+	if (mode == ACC_MODE_PULSE) {
+		intreg = ACC_INTREG_PULSE;
+		setRegister(ACC_ADDR_PDTH, threshold & 0x7F);
+		setRegister(ACC_ADDR_PW, ACC_PULSE_WIDTH);
+	} else {
+		mode = ACC_MODE_LEVEL;
+		setRegister(ACC_ADDR_LDTH, threshold & 0x7F);
+	}
+
+	/* absolute threshold, any of the axes (CTL2 LDPL = 0) */
+	setRegister(ACC_ADDR_CTL1, ACC_CTL1_INTREG(intreg));
+	setRegister(ACC_ADDR_CTL2, 0x00);
+	setOffsets(-ACC_OFFSET_PER_2G_COUNT * x, -ACC_OFFSET_PER_2G_COUNT * y,
+			-ACC_OFFSET_PER_2G_COUNT * z);
+
+	/* detection works in the 8g range */
+	setModeControl(ACC_MCTL_DRPD | ACC_MCTL_GLVL(ACC_RANGE_8G)
+			| ACC_MCTL_MODE(mode));
+
+	/* the latch raises INT1 again if the condition is already met */
+	detecting = 1;
 	acc_intClr();
 }
 
+/******************************************************************************
+ *
+ * Description:
+ *    Handle a rising edge on the DRDY pin. Queues a burst read of the new
+ *    sample, or reports motion while detecting (acc_startMotionDetect).
+ *    Called from interrupt context.
+ *
+ *****************************************************************************/
+void acc_drdyHandler(void) {
+	if (detecting) {
+		if (motionCb != NULL) {
+			motionCb();
+		}
+		return;
+	}
+
+	if (!sampling) {
+		return;
+	}
+
+	if (sampleXact.pending) {
+		drdyMissed = 1;
+		return;
+	}
+
+	startSample();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the oldest sample from the ring buffer
+ *
+ * Params:
+ *   [out] sample - the sample
+ *
+ * Returns:
+ *   TRUE if a sample was returned, FALSE if the ring buffer is empty
+ *
+ *****************************************************************************/
+uint32_t acc_getSample(acc_sample_t *sample) {
+	if (ringTail == ringHead) {
+		return FALSE;
+	}
+
+	*sample = ring[ringTail & ACC_RING_MASK];
+	ringTail++;
+
+	return TRUE;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of samples dropped because the ring buffer was full
+ *
+ *****************************************************************************/
+uint32_t acc_getOverruns(void) {
+	return overruns;
+}
+
 void acc_intClr() {
 	uint8_t buf[2];
 
 	buf[0] = ACC_ADDR_INTRST;
 	buf[1] = 0x03;
-	I2CWrite(ACC_I2C_ADDR, buf, 2);
+	i2c2_write(ACC_I2C_ADDR, buf, 2);
 
 	buf[0] = ACC_ADDR_INTRST;
 	buf[1] = 0x00;
-	I2CWrite(ACC_I2C_ADDR, buf, 2);
+	i2c2_write(ACC_I2C_ADDR, buf, 2);
 }
@@ -0,0 +1,92 @@
+/*****************************************************************************
+ *   board.c:  Pin setup of the LPCXpresso Base Board
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: board_init must be called before any of the drivers' init
+ * functions. The drivers don't set up their pins themselves.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "lpc17xx_gpio.h"
+#include "board.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define BOARD_USED_TERM(p, name, port, pin, func, dir, idle, irq) \
+    | ((port) == (p) ? 1ULL << (pin) : 0ULL)
+#define BOARD_SUM_TERM(p, name, port, pin, func, dir, idle, irq) \
+    + ((port) == (p) ? 1ULL << (pin) : 0ULL)
+#define BOARD_FUNC_TERM(a, name, port, pin, func, dir, idle, irq) \
+    | ((func) > 3)
+
+#define BOARD_USED(port) (0ULL BOARD_PINS(BOARD_USED_TERM, port))
+#define BOARD_SUM(port) (0ULL BOARD_PINS(BOARD_SUM_TERM, port))
+
+/* compile time checks, a negative array size fails the build */
+#define BOARD_CHECK(name, cond) typedef char board_check_##name[(cond) ? 1 : -1]
+
+/* a pin listed twice adds its bit twice */
+BOARD_CHECK(port0_pin_listed_twice, BOARD_SUM(0) == BOARD_USED(0));
+BOARD_CHECK(port2_pin_listed_twice, BOARD_SUM(2) == BOARD_USED(2));
+
+/* board_init only sets up ports 0 and 2 */
+BOARD_CHECK(unused_port, (BOARD_USED(1) | BOARD_USED(3) | BOARD_USED(4)) == 0);
+
+BOARD_CHECK(invalid_function, (0 BOARD_PINS(BOARD_FUNC_TERM, 0)) == 0);
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Set the pin functions and directions, one register write each.
+ *    Outputs start at their idle level (chip selects high). The EINT
+ *    edges are set as well, but no interrupt is enabled.
+ *
+ *****************************************************************************/
+void board_init (void)
+{
+    LPC_PINCON->PINSEL0 = BOARD_PINSEL(0);
+    LPC_PINCON->PINSEL1 = BOARD_PINSEL(1);
+    LPC_PINCON->PINSEL4 = BOARD_PINSEL(4);
+
+    GPIO_SetValue(0, BOARD_FIOSET(0));
+    GPIO_ClearValue(0, BOARD_FIODIR(0) & ~BOARD_FIOSET(0));
+    GPIO_SetDir(0, BOARD_FIODIR(0), 1);
+
+    GPIO_SetValue(2, BOARD_FIOSET(2));
+    GPIO_ClearValue(2, BOARD_FIODIR(2) & ~BOARD_FIOSET(2));
+    GPIO_SetDir(2, BOARD_FIODIR(2), 1);
+
+    LPC_SC->EXTMODE = BOARD_EXTMODE;
+    LPC_SC->EXTPOLAR = BOARD_EXTPOLAR;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Clear and enable the GPIO interrupts of the pin map and clear the
+ *    EINT flags. The NVIC is left to the application.
+ *
+ *****************************************************************************/
+void board_enableInterrupts(void)
+{
+    LPC_GPIOINT->IO0IntClr = BOARD_INTENR(0) | BOARD_INTENF(0);
+    LPC_GPIOINT->IO2IntClr = BOARD_INTENR(2) | BOARD_INTENF(2);
+
+    LPC_GPIOINT->IO0IntEnR = BOARD_INTENR(0);
+    LPC_GPIOINT->IO0IntEnF = BOARD_INTENF(0);
+    LPC_GPIOINT->IO2IntEnR = BOARD_INTENR(2);
+    LPC_GPIOINT->IO2IntEnF = BOARD_INTENF(2);
+
+    LPC_SC->EXTINT = BOARD_EXTMODE;
+}
@@ -16,6 +16,7 @@
  *****************************************************************************/
 
 #include "lpc17xx_i2c.h"
+#include "i2c2.h"
 #include "string.h"
 #include "stdio.h"
 #include "eeprom.h"
@@ -28,8 +29,6 @@
 #define MIN(x, y) ((x) < (y) ? (x) : (y))
 #endif
 
-#define I2CDEV LPC_I2C2
-
 #define EEPROM_I2C_ADDR1    (0x50)
 #define EEPROM_I2C_ADDR2    (0x51)
 #define EEPROM_I2C_ADDR3    (0x52)
@@ -39,6 +38,11 @@
 #define EEPROM_BLOCK_SIZE  256
 #define EEPROM_PAGE_SIZE    16
 
+/*
+ * The chip doesn't acknowledge its address while a write cycle (max 5 ms)
+ * is in progress. Each poll takes about 0.1 ms at 100 kHz.
+ */
+#define EEPROM_POLL_MAX    100
 
 /******************************************************************************
  * External global variables
@@ -48,53 +52,118 @@
  * Local variables
  *****************************************************************************/
 
+/* state of eeprom_read_async */
+static i2c2_xact_t readXact;
+static uint8_t readOff = 0;
+
+/* state of eeprom_write_async */
+static i2c2_xact_t writeXact;
+static uint8_t writePage[EEPROM_PAGE_SIZE + 1];
+static uint8_t* volatile writeBuf = NULL;
+static uint16_t writeOffset = 0;
+static uint16_t writeLen = 0;
+static uint16_t writeDone = 0;
+static uint16_t writePolls = 0;
+static uint8_t writePolling = 0;
+static void (*writeCallback)(int32_t status, void *arg) = NULL;
+static void *writeArg = NULL;
+
 
 /******************************************************************************
  * Local Functions
  *****************************************************************************/
 
-static int I2CRead(uint8_t addr, uint8_t* buf, uint32_t len)
+
+/* bytes from offset to the end of its page */
+static uint16_t pageSpace(uint16_t offset, uint16_t len)
 {
-	I2C_M_SETUP_Type rxsetup;
-
-	rxsetup.sl_addr7bit = addr;
-	rxsetup.tx_data = NULL;	// Get address to read at writing address
-	rxsetup.tx_length = 0;
-	rxsetup.rx_data = buf;
-	rxsetup.rx_length = len;
-	rxsetup.retransmissions_max = 3;
-
-	if (I2C_MasterTransferData(I2CDEV, &rxsetup, I2C_TRANSFER_POLLING) == SUCCESS){
-		return (0);
-	} else {
-		return (-1);
-	}
+    return MIN(EEPROM_PAGE_SIZE - (offset % EEPROM_PAGE_SIZE), len);
 }
 
-static int I2CWrite(uint8_t addr, uint8_t* buf, uint32_t len)
+/* wait for the end of a write cycle by polling for the address ACK */
+static int waitReady(uint8_t addr)
 {
-	I2C_M_SETUP_Type txsetup;
-
-	txsetup.sl_addr7bit = addr;
-	txsetup.tx_data = buf;
-	txsetup.tx_length = len;
-	txsetup.rx_data = NULL;
-	txsetup.rx_length = 0;
-	txsetup.retransmissions_max = 3;
-
-	if (I2C_MasterTransferData(I2CDEV, &txsetup, I2C_TRANSFER_POLLING) == SUCCESS){
-		return (0);
-	} else {
-		return (-1);
-	}
+    uint8_t off = 0;
+    int i = 0;
+
+    for (i = 0; i < EEPROM_POLL_MAX; i++) {
+        if (i2c2_write(addr, &off, 1) == 0) {
+            return 0;
+        }
+    }
+
+    return -1;
 }
 
+static int submitPage(void);
+
+static void finishWrite(int32_t status)
+{
+    void (*done)(int32_t status, void *arg) = writeCallback;
+
+    writeBuf = NULL;
+    if (done != NULL) {
+        done(status, writeArg);
+    }
+}
 
-static void eepromDelay(void)
+/* I2C2 interrupt: a page has been sent or an ACK poll has ended */
+static void writeStep(int32_t status, void *arg)
 {
-    volatile int i = 0;
+    uint16_t len = writeXact.txLen - 1;
+
+    if (!writePolling) {
+        if (status != I2C2_XFER_OK) {
+            finishWrite(-1);
+            return;
+        }
+
+        /* the page is being programmed, poll with the word address only */
+        writeDone += len;
+        writePolling = 1;
+        writePolls = 0;
+        writeXact.txLen = 1;
+        i2c2_submit(&writeXact);
+        return;
+    }
+
+    if (status != I2C2_XFER_OK) {
+        if (++writePolls >= EEPROM_POLL_MAX) {
+            finishWrite(-1);
+        } else {
+            i2c2_submit(&writeXact);
+        }
+        return;
+    }
+
+    if (writeDone == writeLen) {
+        finishWrite(writeDone);
+        return;
+    }
+
+    if (submitPage() != 0) {
+        finishWrite(-1);
+    }
+}
 
-    for (i = 0; i <0x20000; i++);
+static int submitPage(void)
+{
+    uint16_t offset = writeOffset + writeDone;
+    uint16_t len = pageSpace(offset, writeLen - writeDone);
+
+    writePage[0] = offset % EEPROM_BLOCK_SIZE;
+    memcpy(&writePage[1], &writeBuf[writeDone], len);
+
+    writePolling = 0;
+    writeXact.addr = EEPROM_I2C_ADDR1 + (offset/EEPROM_BLOCK_SIZE);
+    writeXact.tx = writePage;
+    writeXact.txLen = len + 1;
+    writeXact.rx = NULL;
+    writeXact.rxLen = 0;
+    writeXact.done = writeStep;
+    writeXact.arg = NULL;
+
+    return i2c2_submit(&writeXact);
 }
 
 /******************************************************************************
@@ -129,10 +198,9 @@ void eeprom_init (void)
 int16_t eeprom_read(uint8_t* buf, uint16_t offset, uint16_t len)
 {
     uint8_t addr = 0;
+    uint8_t off = 0;
     int i = 0;
 
-    uint16_t off = offset;
-
     if (len > EEPROM_TOTAL_SIZE || offset+len > EEPROM_TOTAL_SIZE) {
         return -1;
     }
@@ -140,12 +208,14 @@ int16_t eeprom_read(uint8_t* buf, uint16_t offset, uint16_t len)
     addr = EEPROM_I2C_ADDR1 + (offset/EEPROM_BLOCK_SIZE);
     off = offset % EEPROM_BLOCK_SIZE;
 
-    I2CWrite((addr), (uint8_t*)&off, 1);
-    for ( i = 0; i < 0x2000; i++);
-    I2CRead((addr), buf, len);
-
-    return len;
+    /* NACKed while a write cycle is in progress */
+    for (i = 0; i < EEPROM_POLL_MAX; i++) {
+        if (i2c2_writeRead(addr, &off, 1, buf, len) == 0) {
+            return len;
+        }
+    }
 
+    return -1;
 }
 
 /******************************************************************************
@@ -168,7 +238,7 @@ int16_t eeprom_write(uint8_t* buf, uint16_t offset, uint16_t len)
     int16_t written = 0;
     uint16_t wLen = 0;
     uint16_t off = offset;
-    uint8_t tmp[17];
+    uint8_t tmp[EEPROM_PAGE_SIZE + 1];
 
     if (len > EEPROM_TOTAL_SIZE || offset+len > EEPROM_TOTAL_SIZE) {
         return -1;
@@ -176,16 +246,19 @@ int16_t eeprom_write(uint8_t* buf, uint16_t offset, uint16_t len)
 
     addr = EEPROM_I2C_ADDR1 + (offset/EEPROM_BLOCK_SIZE);
     off = offset % EEPROM_BLOCK_SIZE;
-    wLen = ((((off >> 4) + 1) << 4) - off);
-    wLen = MIN(wLen, len);
+    wLen = pageSpace(off, len);
 
     while (len) {
         tmp[0] = off;
         memcpy(&tmp[1], (void*)&buf[written], wLen);
-        I2CWrite((addr), tmp, wLen+1);
+        if (i2c2_write((addr), tmp, wLen+1) != 0) {
+            return -1;
+        }
 
-        /* delay to wait for a write cycle */
-        eepromDelay();
+        /* wait for the write cycle */
+        if (waitReady(addr) != 0) {
+            return -1;
+        }
 
         len     -= wLen;
         written += wLen;
@@ -199,3 +272,108 @@ int16_t eeprom_write(uint8_t* buf, uint16_t offset, uint16_t len)
 
     return written;
 }
+
+/******************************************************************************
+ *
+ * Description:
+ *    Start reading from the EEPROM in the background. The word address is
+ *    written followed by a repeated start and the read. The callback is
+ *    called from the I2C interrupt when the data is available.
+ *
+ * Params:
+ *   [in] buf - read buffer, must stay valid until the callback is called
+ *   [in] offset - offset to start to read from
+ *   [in] len - number of bytes to read
+ *   [in] done - completion callback, may be NULL
+ *   [in] arg - argument passed to the callback
+ *
+ * Returns:
+ *   number of bytes that will be read or -1 in case of an error
+ *   (invalid parameters or a read already in progress)
+ *
+ *****************************************************************************/
+int16_t eeprom_read_async(uint8_t* buf, uint16_t offset, uint16_t len,
+        void (*done)(int32_t status, void *arg), void *arg)
+{
+    if (len == 0 || len > EEPROM_TOTAL_SIZE || offset+len > EEPROM_TOTAL_SIZE) {
+        return -1;
+    }
+
+    if (readXact.pending) {
+        return -1;
+    }
+
+    readOff = offset % EEPROM_BLOCK_SIZE;
+
+    readXact.addr = EEPROM_I2C_ADDR1 + (offset/EEPROM_BLOCK_SIZE);
+    readXact.tx = &readOff;
+    readXact.txLen = 1;
+    readXact.rx = buf;
+    readXact.rxLen = len;
+    readXact.done = done;
+    readXact.arg = arg;
+
+    if (i2c2_submit(&readXact) != 0) {
+        return -1;
+    }
+
+    return len;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Start writing to the EEPROM in the background. The data is written
+ *    one page at a time, the end of each write cycle is detected by ACK
+ *    polling from the I2C interrupt. The callback is called from the I2C
+ *    interrupt when all pages have been programmed.
+ *
+ * Params:
+ *   [in] buf - data to write, must stay valid until the callback is called
+ *   [in] offset - offset to start to write to
+ *   [in] len - number of bytes to write
+ *   [in] done - completion callback with the number of written bytes or
+ *               -1 in case of an error, may be NULL
+ *   [in] arg - argument passed to the callback
+ *
+ * Returns:
+ *   number of bytes that will be written or -1 in case of an error
+ *   (invalid parameters or a write already in progress)
+ *
+ *****************************************************************************/
+int16_t eeprom_write_async(uint8_t* buf, uint16_t offset, uint16_t len,
+        void (*done)(int32_t status, void *arg), void *arg)
+{
+    if (len == 0 || len > EEPROM_TOTAL_SIZE || offset+len > EEPROM_TOTAL_SIZE) {
+        return -1;
+    }
+
+    if (writeBuf != NULL) {
+        return -1;
+    }
+
+    writeBuf = buf;
+    writeOffset = offset;
+    writeLen = len;
+    writeDone = 0;
+    writeCallback = done;
+    writeArg = arg;
+
+    if (submitPage() != 0) {
+        writeBuf = NULL;
+        return -1;
+    }
+
+    return len;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Check if a background write is in progress
+ *
+ *****************************************************************************/
+uint8_t eeprom_isWriting(void)
+{
+    return writeBuf != NULL;
+}
@@ -18,7 +18,9 @@
 
 #include "lpc17xx_gpio.h"
 #include "lpc17xx_ssp.h"
+#include "board.h"
 #include "flash.h"
+#include "ssp1.h"
 
 /******************************************************************************
  * Defines and typedefs
@@ -28,8 +30,12 @@
 #define MIN(x, y) ((x) < (y) ? (x) : (y))
 #endif
 
-#define FLASH_CS_OFF() GPIO_SetValue(2, 1<<2);
-#define FLASH_CS_ON()  GPIO_ClearValue( 2, 1<<2 )
+/* polled transfers hold the SSP1 bus while the chip is selected */
+#define FLASH_CS_OFF() do { \
+        GPIO_SetValue(BOARD_PORT(FLASH_CS), BOARD_MASK(FLASH_CS)); \
+        ssp1_unlock(); } while (0)
+#define FLASH_CS_ON()  do { ssp1_lock(); \
+        GPIO_ClearValue(BOARD_PORT(FLASH_CS), BOARD_MASK(FLASH_CS)); } while (0)
 
 
 #define FLASH_CMD_RDID      0x9F        /* read device ID */
@@ -83,6 +89,11 @@ static uint8_t  pageIsPow2 = 0;
 static uint8_t  pageSizeChanged = FALSE;
 static uint32_t flashTotalSize = 0;
 
+/* state of the background page program started by flash_writeAsync */
+static ssp1_xact_t asyncXact;
+static uint8_t asyncAddr[4];
+static void (*asyncDone)(uint32_t written) = NULL;
+
 static struct _flash_info flash_devices[] = {
         {"AT45DB081D", 0x1F2500, 4096, 264, 9, 0},
         {"AT45DB081D", 0x1F2500, 4096, 256, 8, FLAG_IS_POW2},
@@ -176,7 +187,7 @@ static void setAddressBytes(uint8_t* addr, uint32_t offset)
 
         /* buffer address bits */
         addr[2] = (off & 0xff);
-        addr[1] = (off / pageSize);
+        addr[1] = (off >> 8);
 
         /* page address bits */
         addr[1] |= ((page & ((1 << (16-pageOffset))-1)) << (pageOffset-8));
@@ -191,6 +202,17 @@ static void setAddressBytes(uint8_t* addr, uint32_t offset)
     }
 }
 
+static void asyncSent(int32_t status, void *arg)
+{
+    void (*done)(uint32_t written) = asyncDone;
+
+    asyncDone = NULL;
+
+    if (done != NULL) {
+        done(status == SSP1_XFER_OK ? asyncXact.len : 0);
+    }
+}
+
 /******************************************************************************
  * Public Functions
  *****************************************************************************/
@@ -210,11 +232,7 @@ uint32_t flash_init (void)
     uint8_t status = 0;
     uint8_t flag   = 0;
     uint32_t id = 0;
-    int i = 0;
-
-
-    GPIO_SetDir(2, 1<<2, 1);
-    FLASH_CS_OFF();
+    uint32_t i = 0;
 
     exitDeepPowerDown();
     readDeviceId(deviceId);
@@ -391,3 +409,91 @@ void flash_setToBinaryPageSize(void)
 
     pageSizeChanged = (!pageIsPow2);
 }
+
+/******************************************************************************
+ *
+ * Description:
+ *    Start writing data to flash in the background. At most one page is
+ *    programmed per call, i.e. the write stops at the next page boundary.
+ *    The buffer must stay valid until the callback has been called.
+ *
+ *    The write is queued on the SSP1 bus manager and the callback is
+ *    called (from the DMA interrupt) when the data has been transferred to
+ *    the device. The device then programs the page internally; use
+ *    flash_isBusy to find out when it is done.
+ *
+ *    Like the other flash functions this must not be called from an
+ *    interrupt handler (including the callback) since the device status is
+ *    read with a polled transfer.
+ *
+ * Params:
+ *   [in] buf - data to write to flash
+ *   [in] offset - offset into the flash
+ *   [in] len - number of bytes to write
+ *   [in] done - completion callback with the number of written bytes
+ *               (0 on error). May be NULL.
+ *
+ * Returns:
+ *   number of bytes that will be written, 0 if the write couldn't be started
+ *   (invalid parameters or device busy)
+ *
+ *****************************************************************************/
+uint32_t flash_writeAsync(uint8_t* buf, uint32_t offset, uint32_t len,
+        void (*done)(uint32_t written))
+{
+    uint16_t wLen;
+
+    if (len == 0 || len > flashTotalSize || len+offset > flashTotalSize) {
+        return 0;
+    }
+
+    if (pageSizeChanged || flash_isBusy()) {
+        return 0;
+    }
+
+    /* write up to first page boundry */
+    wLen = pageSize - (offset%pageSize);
+    wLen = MIN(wLen, len);
+
+    asyncDone = done;
+
+    asyncAddr[0] = FLASH_CMD_PP_BUF;
+    setAddressBytes(&asyncAddr[1], offset);
+
+    asyncXact.csPort = BOARD_PORT(FLASH_CS);
+    asyncXact.csMask = BOARD_MASK(FLASH_CS);
+    asyncXact.dcMask = 0;
+    asyncXact.cmd = asyncAddr;
+    asyncXact.cmdLen = 4;
+    asyncXact.tx = buf;
+    asyncXact.rx = NULL;
+    asyncXact.len = wLen;
+    asyncXact.done = asyncSent;
+    asyncXact.arg = NULL;
+
+    if (ssp1_submit(&asyncXact) != 0) {
+        asyncDone = NULL;
+        return 0;
+    }
+
+    return wLen;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Check if the flash is busy with a background transfer or an internal
+ *    program/erase cycle
+ *
+ * Returns:
+ *   TRUE if busy, otherwise FALSE
+ *
+ *****************************************************************************/
+uint32_t flash_isBusy(void)
+{
+    if (asyncXact.pending) {
+        return TRUE;
+    }
+
+    return ((readStatus() & STATUS_RDY) == 0);
+}
@@ -0,0 +1,158 @@
+/*****************************************************************************
+ *   fmt.c:  Integer and fixed-point text formatting
+ *
+******************************************************************************/
+
+/*
+ * A replacement for sprintf on the display paths. Values are formatted
+ * from integers only: fixed-point values are scaled integers, e.g. a
+ * temperature in 0.1 C is fmt_fixed(buf, value, 1, width). No floating
+ * point (the Cortex-M3 has no FPU, "%f" pulls in soft double math and
+ * newlib's float printf), no varargs and no heap.
+ *
+ * The digits are produced from the right with a divide by 10, which the
+ * compiler turns into a multiply.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "fmt.h"
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+/*
+ * Write the digits of value ending at 'end', with a decimal point before
+ * the last 'decimals' digits and a leading '-' if negative. Returns the
+ * first character.
+ */
+static char *convert(char *end, uint32_t value, uint8_t negative,
+        uint8_t decimals)
+{
+    char *p = end;
+    uint8_t n = 0;
+
+    do {
+        *--p = '0' + (char)(value % 10);
+        value /= 10;
+        n++;
+        if (n == decimals) {
+            *--p = '.';
+        }
+    } while (value != 0 || n <= decimals);
+
+    if (negative) {
+        *--p = '-';
+    }
+
+    return p;
+}
+
+/* copy text to buf, padded to width (see fmt.h) */
+static uint8_t pad(char *buf, const char *text, uint8_t len, int8_t width)
+{
+    uint8_t size = (uint8_t)(width < 0 ? -width : width);
+    uint8_t fill = (size > len) ? size - len : 0;
+    uint8_t n = 0;
+    uint8_t i;
+
+    if (width > 0) {
+        for (i = 0; i < fill; i++) {
+            buf[n++] = ' ';
+        }
+    }
+    for (i = 0; i < len; i++) {
+        buf[n++] = text[i];
+    }
+    if (width < 0) {
+        for (i = 0; i < fill; i++) {
+            buf[n++] = ' ';
+        }
+    }
+    buf[n] = '\0';
+
+    return n;
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Format an unsigned integer
+ *
+ * Params:
+ *   [out] buf - the text, see FMT_NUM_LEN for the size
+ *   [in] value - the value
+ *   [in] width - field width, see fmt.h
+ *
+ * Returns:
+ *   length of the text without the NUL
+ *
+ *****************************************************************************/
+uint8_t fmt_uint(char *buf, uint32_t value, int8_t width)
+{
+    char text[FMT_NUM_LEN];
+    char *end = &text[FMT_NUM_LEN];
+    char *p = convert(end, value, 0, 0);
+
+    return pad(buf, p, (uint8_t)(end - p), width);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Format a signed integer
+ *
+ * Params:
+ *   [out] buf - the text, see FMT_NUM_LEN for the size
+ *   [in] value - the value
+ *   [in] width - field width, see fmt.h
+ *
+ * Returns:
+ *   length of the text without the NUL
+ *
+ *****************************************************************************/
+uint8_t fmt_int(char *buf, int32_t value, int8_t width)
+{
+    return fmt_fixed(buf, value, 0, width);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Format a fixed-point value, e.g. value 245 with 1 decimal is "24.5"
+ *    and -5 is "-0.5"
+ *
+ * Params:
+ *   [out] buf - the text, see FMT_NUM_LEN for the size
+ *   [in] value - the value in units of 10^-decimals
+ *   [in] decimals - number of decimals, up to FMT_MAX_DECIMALS
+ *   [in] width - field width, see fmt.h
+ *
+ * Returns:
+ *   length of the text without the NUL
+ *
+ *****************************************************************************/
+uint8_t fmt_fixed(char *buf, int32_t value, uint8_t decimals, int8_t width)
+{
+    char text[FMT_NUM_LEN];
+    char *end = &text[FMT_NUM_LEN];
+    uint32_t magnitude;
+    char *p;
+
+    if (decimals > FMT_MAX_DECIMALS) {
+        decimals = FMT_MAX_DECIMALS;
+    }
+
+    /* -INT32_MIN doesn't fit an int32_t, its magnitude fits a uint32_t */
+    magnitude = (value < 0) ? 0u - (uint32_t)value : (uint32_t)value;
+    p = convert(end, magnitude, value < 0, decimals);
+
+    return pad(buf, p, (uint8_t)(end - p), width);
+}
@@ -0,0 +1,232 @@
+/*****************************************************************************
+ *   gpioint.c:  Table driven dispatcher for the GPIO interrupts (EINT3)
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: the application must forward EINT3_IRQHandler to gpioint_dispatch.
+ * The GPIOINT edges are enabled by board_enableInterrupts.
+ *
+ * The four status registers are read once per interrupt and cleared with
+ * one write per port before the pins are handled, so an edge arriving
+ * meanwhile raises the interrupt again. The set bits are walked with CLZ
+ * and looked up in a per port table built by gpioint_init.
+ *
+ * Queued events carry the level of all pins of the port, read right after
+ * the status, so e.g. the other channel of an encoder can be decoded later.
+ *
+ * Queued events are written by the interrupt only and read by one task
+ * (gpioint_getEvent), so the queue needs no locking. The notify callback
+ * (e.g. posting the task) is called once per interrupt that queued events.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "lpc17xx_gpio.h"
+#include "gpioint.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define NO_PIN 0xFF
+
+#define QUEUE_MASK (GPIOINT_QUEUE_SIZE - 1)
+
+/* CMSIS 1.30 has no __CLZ, GCC emits the instruction */
+#define CLZ(x) __builtin_clz(x)
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static const gpioint_pin_t *table = NULL;
+static uint32_t (*getTicks)(void) = NULL;
+static void (*notifyTask)(void) = NULL;
+
+/* table index per port (0, 2) and pin */
+static uint8_t lookup[2][32];
+
+static uint32_t lastEdge[GPIOINT_MAX_PINS];
+
+static gpioint_event_t queue[GPIOINT_QUEUE_SIZE];
+static volatile uint32_t head = 0;
+static volatile uint32_t tail = 0;
+static uint32_t dropped = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+/* returns 1 if an event was queued */
+static uint8_t handlePins(uint8_t port, uint32_t bits, uint8_t edge,
+        uint32_t now, uint32_t levels)
+{
+    const gpioint_pin_t *p;
+    uint8_t queued = 0;
+    uint8_t pin;
+    uint8_t id;
+
+    while (bits != 0) {
+        pin = 31 - CLZ(bits);
+        bits &= ~(1UL << pin);
+
+        id = lookup[port >> 1][pin];
+        if (id == NO_PIN) {
+            continue;
+        }
+        p = &table[id];
+        if ((p->edges & edge) == 0) {
+            continue;
+        }
+
+        if (p->debounce != 0) {
+            if (now - lastEdge[id] < p->debounce) {
+                continue;
+            }
+            lastEdge[id] = now;
+        }
+
+        if (p->handler != NULL) {
+            p->handler();
+            continue;
+        }
+
+        if (head - tail == GPIOINT_QUEUE_SIZE) {
+            dropped++;
+            continue;
+        }
+        queue[head & QUEUE_MASK].id = id;
+        queue[head & QUEUE_MASK].edge = edge;
+        queue[head & QUEUE_MASK].time = now;
+        queue[head & QUEUE_MASK].levels = levels;
+        head++;
+        queued = 1;
+    }
+
+    return queued;
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Install the pin table
+ *
+ * Params:
+ *   [in] pins - pin table, must stay valid
+ *   [in] numPins - number of entries, up to GPIOINT_MAX_PINS
+ *   [in] getMsTicks - callback function for retrieving number of elapsed
+ *                     ticks in milliseconds
+ *   [in] notify - called from the interrupt when events were queued,
+ *                 may be NULL
+ *
+ *****************************************************************************/
+void gpioint_init (const gpioint_pin_t *pins, uint8_t numPins,
+        uint32_t (*getMsTicks)(void), void (*notify)(void))
+{
+    uint8_t i;
+    uint8_t j;
+
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < 32; j++) {
+            lookup[i][j] = NO_PIN;
+        }
+    }
+
+    for (i = 0; i < numPins && i < GPIOINT_MAX_PINS; i++) {
+        if (pins[i].port == 0 || pins[i].port == 2) {
+            lookup[pins[i].port >> 1][pins[i].pin & 31] = i;
+        }
+        lastEdge[i] = 0;
+    }
+
+    table = pins;
+    getTicks = getMsTicks;
+    notifyTask = notify;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Handle the pending GPIO interrupts, call from EINT3_IRQHandler
+ *
+ *****************************************************************************/
+void gpioint_dispatch(void)
+{
+    uint32_t rise0 = LPC_GPIOINT->IO0IntStatR;
+    uint32_t fall0 = LPC_GPIOINT->IO0IntStatF;
+    uint32_t rise2 = LPC_GPIOINT->IO2IntStatR;
+    uint32_t fall2 = LPC_GPIOINT->IO2IntStatF;
+    uint32_t now;
+    uint32_t levels;
+    uint8_t queued = 0;
+
+    if ((rise0 | fall0) != 0) {
+        LPC_GPIOINT->IO0IntClr = rise0 | fall0;
+    }
+    if ((rise2 | fall2) != 0) {
+        LPC_GPIOINT->IO2IntClr = rise2 | fall2;
+    }
+
+    if (table == NULL) {
+        return;
+    }
+
+    now = getTicks();
+
+    if ((rise0 | fall0) != 0) {
+        levels = GPIO_ReadValue(0);
+        queued |= handlePins(0, rise0, GPIOINT_RISE, now, levels);
+        queued |= handlePins(0, fall0, GPIOINT_FALL, now, levels);
+    }
+    if ((rise2 | fall2) != 0) {
+        levels = GPIO_ReadValue(2);
+        queued |= handlePins(2, rise2, GPIOINT_RISE, now, levels);
+        queued |= handlePins(2, fall2, GPIOINT_FALL, now, levels);
+    }
+
+    if (queued && notifyTask != NULL) {
+        notifyTask();
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the oldest queued event
+ *
+ * Params:
+ *   [out] event - the event
+ *
+ * Returns:
+ *   1 if an event was returned, 0 if the queue is empty
+ *
+ *****************************************************************************/
+int gpioint_getEvent(gpioint_event_t *event)
+{
+    if (tail == head) {
+        return 0;
+    }
+
+    *event = queue[tail & QUEUE_MASK];
+    tail++;
+
+    return 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of events dropped because the queue was full
+ *
+ *****************************************************************************/
+uint32_t gpioint_getDropped(void)
+{
+    return dropped;
+}
@@ -0,0 +1,390 @@
+/*****************************************************************************
+ *   i2c2.c:  Shared transaction engine for the I2C2 bus
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: I2C2 must have been initialized before calling any functions in
+ * this file. The application must forward I2C2_IRQHandler to
+ * I2C2_StdIntHandler().
+ *
+ * All devices on I2C2 (accelerometer, light sensor, LED dimmer, EEPROM,
+ * I2C UART) go through this module. Transactions are queued in a lock-free
+ * (LDREX/STREX) queue so they may be submitted from any context, including
+ * interrupt handlers, and are executed in order with the interrupt driven
+ * master mode of the I2C driver. Completion callbacks run in the I2C2
+ * interrupt and may submit further transactions.
+ *
+ * The polled helpers i2c2_read/i2c2_write hold the bus with
+ * i2c2_lock()/i2c2_unlock() for the duration of the transfer and must
+ * therefore not be called from an interrupt handler.
+ *
+ * Before i2c2_init has been called transactions are executed with polled
+ * transfers directly from i2c2_submit.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "lpc17xx_i2c.h"
+#include "i2c2.h"
+#include "prof.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define I2CDEV LPC_I2C2
+
+#define QUEUE_MASK (I2C2_QUEUE_SIZE - 1)
+
+#define I2C2_RETRANSMISSIONS 3
+
+/******************************************************************************
+ * External global variables
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static uint8_t initialized = 0;
+
+/*
+ * Producers claim a slot by incrementing head and publish the descriptor
+ * by writing a non-NULL pointer to it. The bus owner consumes slots at
+ * tail and stops at the first slot that hasn't been published yet.
+ */
+static i2c2_xact_t * volatile queue[I2C2_QUEUE_SIZE];
+static volatile uint32_t head = 0;
+static volatile uint32_t tail = 0;
+
+/* 1 while the bus is owned by the queue runner or a i2c2_lock() caller */
+static volatile uint32_t running = 0;
+
+static i2c2_xact_t *current = NULL;
+static I2C_M_SETUP_Type setup;
+
+PROF_ZONE(pollZone, "i2c2_poll");
+PROF_ZONE(xferDoneZone, "i2c2_xferDone");
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static void runQueue(void);
+
+static uint8_t claimBus(void)
+{
+    do {
+        if (__LDREXW((uint32_t *)&running) != 0) {
+            __CLREX();
+            return 0;
+        }
+    } while (__STREXW(1, (uint32_t *)&running) != 0);
+
+    return 1;
+}
+
+static void prepareSetup(uint8_t addr, uint8_t *tx, uint32_t txLen,
+        uint8_t *rx, uint32_t rxLen)
+{
+    setup.sl_addr7bit = addr;
+    setup.tx_data = tx;
+    setup.tx_length = txLen;
+    setup.rx_data = rx;
+    setup.rx_length = rxLen;
+    setup.retransmissions_max = I2C2_RETRANSMISSIONS;
+    setup.retransmissions_count = 0;
+    setup.callback = NULL;
+}
+
+static int polledTransfer(uint8_t addr, uint8_t *tx, uint32_t txLen,
+        uint8_t *rx, uint32_t rxLen)
+{
+    Status ret;
+    PROF_BEGIN(pollZone);
+
+    prepareSetup(addr, tx, txLen, rx, rxLen);
+    ret = I2C_MasterTransferData(I2CDEV, &setup, I2C_TRANSFER_POLLING);
+
+    PROF_END(pollZone);
+
+    if (ret == SUCCESS){
+        return (0);
+    } else {
+        return (-1);
+    }
+}
+
+static void completeXact(i2c2_xact_t *x, int32_t status)
+{
+    /* the owner may reuse the descriptor from its callback */
+    x->pending = 0;
+    if (x->done != NULL) {
+        x->done(status, x->arg);
+    }
+}
+
+/* called by the I2C driver (interrupt context) when a transfer has ended */
+static void xferDone(void)
+{
+    i2c2_xact_t *x = current;
+
+    if (x == NULL) {
+        return;
+    }
+
+    PROF_BEGIN(xferDoneZone);
+
+    current = NULL;
+
+    completeXact(x, (setup.status & I2C_SETUP_STATUS_DONE) != 0
+            ? I2C2_XFER_OK : I2C2_XFER_ERROR);
+
+    runQueue();
+
+    PROF_END(xferDoneZone);
+}
+
+/*
+ * Execute queued transactions. Must be called with the bus claimed.
+ * Returns when the queue is empty (bus released) or an interrupt driven
+ * transfer is in progress (bus still claimed, continued from xferDone).
+ */
+static void runQueue(void)
+{
+    i2c2_xact_t *x;
+
+    for (;;) {
+        x = queue[tail & QUEUE_MASK];
+
+        if (x == NULL) {
+            running = 0;
+
+            /* a producer may have published after the check above */
+            if (queue[tail & QUEUE_MASK] == NULL || !claimBus()) {
+                return;
+            }
+            continue;
+        }
+
+        queue[tail & QUEUE_MASK] = NULL;
+        tail++;
+
+        if (!initialized) {
+            completeXact(x, polledTransfer(x->addr, x->tx, x->txLen,
+                    x->rx, x->rxLen) == 0 ? I2C2_XFER_OK : I2C2_XFER_ERROR);
+            continue;
+        }
+
+        current = x;
+        prepareSetup(x->addr, x->tx, x->txLen, x->rx, x->rxLen);
+        setup.callback = xferDone;
+
+        if (I2C_MasterTransferData(I2CDEV, &setup, I2C_TRANSFER_INTERRUPT)
+                == SUCCESS) {
+            return;
+        }
+
+        current = NULL;
+        completeXact(x, I2C2_XFER_ERROR);
+    }
+}
+
+static void kickQueue(void)
+{
+    if (claimBus()) {
+        runQueue();
+    }
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the I2C2 transaction engine, i.e. start using interrupt
+ *    driven transfers
+ *
+ *****************************************************************************/
+void i2c2_init (void)
+{
+    i2c2_lock();
+    initialized = 1;
+    i2c2_unlock();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Queue a transaction. It is started right away if the bus is idle.
+ *    May be called from any context.
+ *
+ * Params:
+ *   [in] xact - transaction descriptor. Must not be pending.
+ *
+ * Returns:
+ *   0 if the transaction was queued, -1 if the queue is full or the
+ *   descriptor is invalid
+ *
+ *****************************************************************************/
+int i2c2_submit(i2c2_xact_t *xact)
+{
+    uint32_t h;
+
+    if (xact == NULL || xact->pending
+            || (xact->txLen == 0 && xact->rxLen == 0)) {
+        return (-1);
+    }
+
+    /* claim a slot */
+    do {
+        h = __LDREXW((uint32_t *)&head);
+        if (h - tail >= I2C2_QUEUE_SIZE) {
+            __CLREX();
+            return (-1);
+        }
+    } while (__STREXW(h + 1, (uint32_t *)&head) != 0);
+
+    xact->pending = 1;
+    queue[h & QUEUE_MASK] = xact;
+
+    kickQueue();
+
+    return (0);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Read from a device with a polled transfer. Waits for queued
+ *    transactions. Must not be called from an interrupt handler.
+ *
+ * Params:
+ *   [in] addr - 7-bit slave address
+ *   [in] buf - read buffer
+ *   [in] len - number of bytes to read
+ *
+ * Returns:
+ *   0 on success, -1 on error
+ *
+ *****************************************************************************/
+int i2c2_read(uint8_t addr, uint8_t* buf, uint32_t len)
+{
+    int ret;
+
+    i2c2_lock();
+    ret = polledTransfer(addr, NULL, 0, buf, len);
+    i2c2_unlock();
+
+    return ret;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Write to a device with a polled transfer. Waits for queued
+ *    transactions. Must not be called from an interrupt handler.
+ *
+ * Params:
+ *   [in] addr - 7-bit slave address
+ *   [in] buf - data to write
+ *   [in] len - number of bytes to write
+ *
+ * Returns:
+ *   0 on success, -1 on error
+ *
+ *****************************************************************************/
+int i2c2_write(uint8_t addr, uint8_t* buf, uint32_t len)
+{
+    int ret;
+
+    i2c2_lock();
+    ret = polledTransfer(addr, buf, len, NULL, 0);
+    i2c2_unlock();
+
+    return ret;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Write to and then read from a device with a repeated start in between,
+ *    using a polled transfer. Needed by devices that only auto-increment
+ *    the register address within a single transfer. Waits for queued
+ *    transactions. Must not be called from an interrupt handler.
+ *
+ * Params:
+ *   [in] addr - 7-bit slave address
+ *   [in] tx - data to write (typically the register address)
+ *   [in] txLen - number of bytes to write
+ *   [in] rx - read buffer
+ *   [in] rxLen - number of bytes to read
+ *
+ * Returns:
+ *   0 on success, -1 on error
+ *
+ *****************************************************************************/
+int i2c2_writeRead(uint8_t addr, uint8_t* tx, uint32_t txLen,
+        uint8_t* rx, uint32_t rxLen)
+{
+    int ret;
+
+    i2c2_lock();
+    ret = polledTransfer(addr, tx, txLen, rx, rxLen);
+    i2c2_unlock();
+
+    return ret;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Take the bus for polled transfers. Waits until queued transactions
+ *    have completed. Must not be called from an interrupt handler.
+ *
+ *****************************************************************************/
+void i2c2_lock(void)
+{
+    while (!claimBus());
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Release the bus taken by i2c2_lock and run transactions that were
+ *    queued meanwhile
+ *
+ *****************************************************************************/
+void i2c2_unlock(void)
+{
+    running = 0;
+    kickQueue();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Check if the bus is in use or transactions are queued
+ *
+ *****************************************************************************/
+uint8_t i2c2_isBusy(void)
+{
+    return (running != 0 || head != tail);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Wait for all queued transactions to complete. Must not be called
+ *    from an interrupt handler or while holding the bus.
+ *
+ *****************************************************************************/
+void i2c2_waitIdle(void)
+{
+    while (i2c2_isBusy());
+}
@@ -10,6 +10,10 @@
  * NOTE: SPI must have been initialized before calling any functions in
  * this file.
  *
+ * The display is written through the SSP1 bus manager so led7seg_setChar
+ * may be called from an interrupt handler (e.g. a timer) without corrupting
+ * other transfers on the bus. It must not be called from more than one
+ * context though.
  */
 
 /******************************************************************************
@@ -19,14 +23,16 @@
 
 #include "lpc17xx_gpio.h"
 #include "lpc17xx_ssp.h"
+#include "board.h"
 #include "led7seg.h"
+#include "ssp1.h"
 
 /******************************************************************************
  * Defines and typedefs
  *****************************************************************************/
 
-#define LED7_CS_OFF() GPIO_SetValue( 2, (1<<2) )
-#define LED7_CS_ON()  GPIO_ClearValue( 2, (1<<2) )
+#define LED7_CS_OFF() GPIO_SetValue( BOARD_PORT(LED7_CS), BOARD_MASK(LED7_CS) )
+#define LED7_CS_ON()  GPIO_ClearValue( BOARD_PORT(LED7_CS), BOARD_MASK(LED7_CS) )
 
 
 /******************************************************************************
@@ -67,10 +73,47 @@ static uint8_t chars[] = {
 };
 
 
+/*
+ * segment pattern being sent and the latest requested one. If setChar is
+ * called while a transfer is queued the latest pattern is sent when that
+ * transfer completes.
+ */
+static ssp1_xact_t xact;
+static uint8_t sentVal = 0xff;
+static volatile uint8_t nextVal = 0xff;
+
+
 /******************************************************************************
  * Local Functions
  *****************************************************************************/
 
+static void sendVal(void);
+
+static void xactDone(int32_t status, void *arg)
+{
+    if (nextVal != sentVal) {
+        sendVal();
+    }
+}
+
+static void sendVal(void)
+{
+    sentVal = nextVal;
+
+    xact.csPort = BOARD_PORT(LED7_CS);
+    xact.csMask = BOARD_MASK(LED7_CS);
+    xact.dcMask = 0;
+    xact.cmd = NULL;
+    xact.cmdLen = 0;
+    xact.tx = &sentVal;
+    xact.rx = NULL;
+    xact.len = 1;
+    xact.done = xactDone;
+    xact.arg = NULL;
+
+    ssp1_submit(&xact);
+}
+
 
 /******************************************************************************
  * Public Functions
@@ -84,8 +127,6 @@ static uint8_t chars[] = {
  *****************************************************************************/
 void led7seg_init (void)
 {
-    //GPIO_SetDir( 2, 2, 1 );
-	GPIO_SetDir( 2, (1<<2), 1 );
     LED7_CS_OFF();
 }
 
@@ -105,9 +146,6 @@ void led7seg_init (void)
 void led7seg_setChar(uint8_t ch, uint32_t rawMode)
 {
     uint8_t val = 0xff;
-    SSP_DATA_SETUP_Type xferConfig;
-
-   // LED7_CS_ON();
 
     if (ch >= '-' && ch <= '|') {
         val = chars[ch-'-'];
@@ -117,15 +155,10 @@ void led7seg_setChar(uint8_t ch, uint32_t rawMode)
         val = ch;
     }
 
-	xferConfig.tx_data = &val;
-	xferConfig.rx_data = NULL;
-	xferConfig.length = 1;
-
+    nextVal = val;
 
-    LED7_CS_ON();
-    //SSP_SendData(LPC_SSP1, val);
-    SSP_ReadWrite(LPC_SSP1, &xferConfig, SSP_TRANSFER_POLLING);
-
-    LED7_CS_OFF();
+    /* otherwise picked up when the queued transfer completes */
+    if (!xact.pending) {
+        sendVal();
+    }
 }
-
@@ -16,14 +16,13 @@
  *****************************************************************************/
 
 #include "lpc17xx_i2c.h"
+#include "i2c2.h"
 #include "light.h"
 
 /******************************************************************************
  * Defines and typedefs
  *****************************************************************************/
 
-#define I2CDEV LPC_I2C2
-
 #define LIGHT_I2C_ADDR    (0x44)
 
 #define ADDR_CMD        0x00
@@ -71,54 +70,32 @@
 static uint32_t range = RANGE_K1;
 static uint32_t width = WIDTH_16_VAL;
 
+/* state of the interrupt driven (async) operations */
+static i2c2_xact_t readXact;
+static uint8_t readAddr = 0;
+static uint8_t readBuf[2];
+static light_callback_t readCb = NULL;
+
+static i2c2_xact_t hiXact;
+static uint8_t hiBuf[2];
+static i2c2_xact_t loXact;
+static uint8_t loBuf[2];
+
+static i2c2_xact_t ctrlXact;
+static uint8_t ctrlBuf[2];
+
 /******************************************************************************
  * Local Functions
  *****************************************************************************/
 
-static int I2CRead(uint8_t addr, uint8_t* buf, uint32_t len)
-{
-	I2C_M_SETUP_Type rxsetup;
-
-	rxsetup.sl_addr7bit = addr;
-	rxsetup.tx_data = NULL;	// Get address to read at writing address
-	rxsetup.tx_length = 0;
-	rxsetup.rx_data = buf;
-	rxsetup.rx_length = len;
-	rxsetup.retransmissions_max = 3;
-
-	if (I2C_MasterTransferData(I2CDEV, &rxsetup, I2C_TRANSFER_POLLING) == SUCCESS){
-		return (0);
-	} else {
-		return (-1);
-	}
-}
-
-static int I2CWrite(uint8_t addr, uint8_t* buf, uint32_t len)
-{
-	I2C_M_SETUP_Type txsetup;
-
-	txsetup.sl_addr7bit = addr;
-	txsetup.tx_data = buf;
-	txsetup.tx_length = len;
-	txsetup.rx_data = NULL;
-	txsetup.rx_length = 0;
-	txsetup.retransmissions_max = 3;
-
-	if (I2C_MasterTransferData(I2CDEV, &txsetup, I2C_TRANSFER_POLLING) == SUCCESS){
-		return (0);
-	} else {
-		return (-1);
-	}
-}
-
 
 static uint8_t readCommandReg(void)
 {
     uint8_t buf[1];
     buf[0] = ADDR_CMD;
-    I2CWrite(LIGHT_I2C_ADDR, buf, 1);
+    i2c2_write(LIGHT_I2C_ADDR, buf, 1);
 
-    I2CRead(LIGHT_I2C_ADDR, buf, 1);
+    i2c2_read(LIGHT_I2C_ADDR, buf, 1);
 
     return buf[0];
 }
@@ -128,13 +105,86 @@ static uint8_t readControlReg(void)
 {
     uint8_t buf[1];
     buf[0] = ADDR_CTRL;
-    I2CWrite(LIGHT_I2C_ADDR, buf, 1);
+    i2c2_write(LIGHT_I2C_ADDR, buf, 1);
 
-    I2CRead(LIGHT_I2C_ADDR, buf, 1);
+    i2c2_read(LIGHT_I2C_ADDR, buf, 1);
 
     return buf[0];
 }
 
+static void setupXact(i2c2_xact_t *x, uint8_t *tx, uint32_t txLen,
+        uint8_t *rx, uint32_t rxLen, i2c2_callback_t done)
+{
+    x->addr = LIGHT_I2C_ADDR;
+    x->tx = tx;
+    x->txLen = txLen;
+    x->rx = rx;
+    x->rxLen = rxLen;
+    x->done = done;
+    x->arg = NULL;
+}
+
+static void readMsbDone(int32_t status, void *arg)
+{
+    light_callback_t cb = readCb;
+
+    readCb = NULL;
+
+    if (cb != NULL) {
+        cb(status, (range*(readBuf[1] << 8 | readBuf[0]) / width));
+    }
+}
+
+static void readLsbDone(int32_t status, void *arg)
+{
+    light_callback_t cb = readCb;
+
+    if (status == I2C2_XFER_OK) {
+        readAddr = ADDR_MSB_SENSOR;
+        setupXact(&readXact, &readAddr, 1, &readBuf[1], 1, readMsbDone);
+        if (i2c2_submit(&readXact) == 0) {
+            return;
+        }
+    }
+
+    readCb = NULL;
+
+    if (cb != NULL) {
+        cb(I2C2_XFER_ERROR, 0);
+    }
+}
+
+static void ctrlReadDone(int32_t status, void *arg)
+{
+    if (status != I2C2_XFER_OK) {
+        return;
+    }
+
+    /* clear irq */
+    ctrlBuf[1] = ctrlBuf[0] & ~(CTRL_IRQ_FLAG);
+    ctrlBuf[0] = (ADDR_CTRL | ADDR_CLAR_INT);
+
+    setupXact(&ctrlXact, ctrlBuf, 2, NULL, 0, NULL);
+    i2c2_submit(&ctrlXact);
+}
+
+static int writeThresholdAsync(i2c2_xact_t *x, uint8_t *buf, uint8_t reg,
+        uint32_t luxTh)
+{
+    uint32_t data = luxTh * width / range;
+
+    if (x->pending) {
+        return (-1);
+    }
+
+    buf[0] = reg;
+    buf[1] = ((data >> 8) & 0xff);
+
+    setupXact(x, buf, 2, NULL, 0, NULL);
+
+    return i2c2_submit(x);
+}
+
 /******************************************************************************
  * Public Functions
  *****************************************************************************/
@@ -161,7 +211,7 @@ void light_enable (void)
     uint8_t buf[2];
     buf[0] = ADDR_CMD;
     buf[1] = CMD_ENABLE;
-    I2CWrite(LIGHT_I2C_ADDR, buf, 2);
+    i2c2_write(LIGHT_I2C_ADDR, buf, 2);
 
     range = RANGE_K1;
     width = WIDTH_16_VAL;
@@ -182,14 +232,14 @@ uint32_t light_read(void)
     uint8_t buf[1];
 
     buf[0] = ADDR_LSB_SENSOR;
-    I2CWrite(LIGHT_I2C_ADDR, buf, 1);
-    I2CRead(LIGHT_I2C_ADDR, buf, 1);
+    i2c2_write(LIGHT_I2C_ADDR, buf, 1);
+    i2c2_read(LIGHT_I2C_ADDR, buf, 1);
 
     data = buf[0];
 
     buf[0] = ADDR_MSB_SENSOR;
-    I2CWrite(LIGHT_I2C_ADDR, buf, 1);
-    I2CRead(LIGHT_I2C_ADDR, buf, 1);
+    i2c2_write(LIGHT_I2C_ADDR, buf, 1);
+    i2c2_read(LIGHT_I2C_ADDR, buf, 1);
 
     data = (buf[0] << 8 | data);
 
@@ -221,7 +271,7 @@ void light_setMode(light_mode_t mode)
 
     buf[0] = ADDR_CMD;
     buf[1] = cmd;
-    I2CWrite(LIGHT_I2C_ADDR, buf, 2);
+    i2c2_write(LIGHT_I2C_ADDR, buf, 2);
 }
 
 /******************************************************************************
@@ -245,7 +295,7 @@ void light_setWidth(light_width_t newWidth)
 
     buf[0] = ADDR_CMD;
     buf[1] = cmd;
-    I2CWrite(LIGHT_I2C_ADDR, buf, 2);
+    i2c2_write(LIGHT_I2C_ADDR, buf, 2);
 
     switch(newWidth) {
     case LIGHT_WIDTH_16BITS:
@@ -284,7 +334,7 @@ void light_setRange(light_range_t newRange)
 
     buf[0] = ADDR_CTRL;
     buf[1] = ctrl;
-    I2CWrite(LIGHT_I2C_ADDR, buf, 2);
+    i2c2_write(LIGHT_I2C_ADDR, buf, 2);
 
     switch(newRange) {
     case LIGHT_RANGE_1000:
@@ -320,7 +370,7 @@ void light_setHiThreshold(uint32_t luxTh)
 
     buf[0] = ADDR_IRQTH_HI;
     buf[1] = ((data >> 8) & 0xff);
-    I2CWrite(LIGHT_I2C_ADDR, buf, 2);
+    i2c2_write(LIGHT_I2C_ADDR, buf, 2);
 }
 
 /******************************************************************************
@@ -341,7 +391,7 @@ void light_setLoThreshold(uint32_t luxTh)
 
     buf[0] = ADDR_IRQTH_LO;
     buf[1] = ((data >> 8) & 0xff);
-    I2CWrite(LIGHT_I2C_ADDR, buf, 2);
+    i2c2_write(LIGHT_I2C_ADDR, buf, 2);
 }
 
 /******************************************************************************
@@ -367,7 +417,7 @@ void light_setIrqInCycles(light_cycle_t cycles)
 
     buf[0] = ADDR_CTRL;
     buf[1] = ctrl;
-    I2CWrite(LIGHT_I2C_ADDR, buf, 2);
+    i2c2_write(LIGHT_I2C_ADDR, buf, 2);
 }
 
 /******************************************************************************
@@ -402,7 +452,7 @@ void light_clearIrqStatus(void)
 
     buf[0] = (ADDR_CTRL | ADDR_CLAR_INT);
     buf[1] = ctrl;
-    I2CWrite(LIGHT_I2C_ADDR, buf, 2);
+    i2c2_write(LIGHT_I2C_ADDR, buf, 2);
 }
 
 /******************************************************************************
@@ -422,11 +472,101 @@ void light_shutdown(void)
 
     buf[0] = ADDR_CMD;
     buf[1] = cmd;
-    I2CWrite(LIGHT_I2C_ADDR, buf, 2);
+    i2c2_write(LIGHT_I2C_ADDR, buf, 2);
 
     /* second power-down */
     cmd |= CMD_APDCP;
     buf[0] = ADDR_CMD;
     buf[1] = cmd;
-    I2CWrite(LIGHT_I2C_ADDR, buf, 2);
+    i2c2_write(LIGHT_I2C_ADDR, buf, 2);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Start reading the sensor value in the background. The callback is
+ *    called from the I2C interrupt when the value is available.
+ *
+ * Params:
+ *    [in]  done  - callback receiving the status and light value (Lux)
+ *
+ * Returns:
+ *    0 if the read was started, -1 if a read is already in progress
+ *
+ *****************************************************************************/
+int light_read_async(light_callback_t done)
+{
+    if (readXact.pending || readCb != NULL) {
+        return (-1);
+    }
+
+    readCb = done;
+    readAddr = ADDR_LSB_SENSOR;
+    setupXact(&readXact, &readAddr, 1, &readBuf[0], 1, readLsbDone);
+
+    if (i2c2_submit(&readXact) != 0) {
+        readCb = NULL;
+        return (-1);
+    }
+
+    return (0);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Queue a write of the high interrupt threshold. May be called from an
+ *    interrupt handler.
+ *
+ * Params:
+ *    [in]  luxTh  - the threshold in Lux
+ *
+ * Returns:
+ *    0 if queued, -1 if the previous write hasn't completed yet
+ *
+ *****************************************************************************/
+int light_setHiThreshold_async(uint32_t luxTh)
+{
+    return writeThresholdAsync(&hiXact, hiBuf, ADDR_IRQTH_HI, luxTh);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Queue a write of the low interrupt threshold. May be called from an
+ *    interrupt handler.
+ *
+ * Params:
+ *    [in]  luxTh  - the threshold in Lux
+ *
+ * Returns:
+ *    0 if queued, -1 if the previous write hasn't completed yet
+ *
+ *****************************************************************************/
+int light_setLoThreshold_async(uint32_t luxTh)
+{
+    return writeThresholdAsync(&loXact, loBuf, ADDR_IRQTH_LO, luxTh);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Queue clearing of the interrupt status flag. May be called from an
+ *    interrupt handler.
+ *
+ * Returns:
+ *    0 if queued, -1 if a previous clear hasn't completed yet
+ *
+ *****************************************************************************/
+int light_clearIrqStatus_async(void)
+{
+    if (ctrlXact.pending) {
+        return (-1);
+    }
+
+    /* read-modify-write, the write is queued by ctrlReadDone */
+    ctrlBuf[0] = ADDR_CTRL;
+    setupXact(&ctrlXact, ctrlBuf, 1, ctrlBuf, 1, ctrlReadDone);
+
+    return i2c2_submit(&ctrlXact);
 }
@@ -21,8 +21,11 @@
 #include "lpc17xx_gpio.h"
 #include "lpc17xx_i2c.h"
 #include "lpc17xx_ssp.h"
+#include "board.h"
 #include "oled.h"
 #include "font5x7.h"
+#include "ssp1.h"
+#include "prof.h"
 
 /******************************************************************************
  * Defines and typedefs
@@ -35,10 +38,10 @@
 #define OLED_I2C_ADDR (0x3c)
 #else
 
-#define OLED_CS_OFF() GPIO_SetValue( 0, (1<<6) )
-#define OLED_CS_ON()  GPIO_ClearValue( 0, (1<<6) )
-#define OLED_DATA()   GPIO_SetValue( 2, (1<<7) )
-#define OLED_CMD()    GPIO_ClearValue( 2, (1<<7) )
+#define OLED_CS_OFF() GPIO_SetValue( BOARD_PORT(OLED_CS), BOARD_MASK(OLED_CS) )
+#define OLED_CS_ON()  GPIO_ClearValue( BOARD_PORT(OLED_CS), BOARD_MASK(OLED_CS) )
+#define OLED_DATA()   GPIO_SetValue( BOARD_PORT(OLED_DC), BOARD_MASK(OLED_DC) )
+#define OLED_CMD()    GPIO_ClearValue( BOARD_PORT(OLED_DC), BOARD_MASK(OLED_DC) )
 
 #endif
 
@@ -48,7 +51,10 @@
  */
 #define X_OFFSET 18
 
-#define SHADOW_FB_SIZE (OLED_DISPLAY_WIDTH*OLED_DISPLAY_HEIGHT >> 3)
+#define SHADOW_FB_SIZE OLED_FB_SIZE
+
+#define GLYPH_COLUMNS 6
+#define GLYPH_MAX_SCALE 4
 
 #define setAddress(page,lowerAddr,higherAddr)\
     writeCommand(page);\
@@ -74,8 +80,70 @@
  */
 static uint8_t shadowFB[SHADOW_FB_SIZE];
 
+/*
+ * In deferred mode the drawing functions only update shadowFB. The range
+ * of modified columns is tracked per page and pushed to the display by
+ * oled_flush(). A page is clean when dirtyFirst > dirtyLast.
+ */
+static oled_flush_mode_t flushMode = OLED_FLUSH_IMMEDIATE;
+static uint8_t dirtyFirst[OLED_DISPLAY_PAGES];
+static uint8_t dirtyLast[OLED_DISPLAY_PAGES];
+
+/*
+ * What the display shows in deferred mode. oled_flush trims the dirty
+ * span to the columns that differ from it, so redrawing the same pixels
+ * (e.g. clear and redraw of a similar screen) costs no transfer. The
+ * spans are sent from this copy, drawing during a transfer doesn't touch
+ * the data in flight. A span is copied in only when its transfer has
+ * been queued or written.
+ */
+static uint8_t panelFB[SHADOW_FB_SIZE];
+
+#ifndef OLED_USE_I2C
+/*
+ * Background flush. oled_flush() queues one SSP1 transaction per dirty
+ * page: the page/column address as command phase followed by the column
+ * span of shadowFB as data phase.
+ */
+static ssp1_xact_t flushXact[OLED_DISPLAY_PAGES];
+static uint8_t flushCmd[OLED_DISPLAY_PAGES][3];
+/* pages whose transfer failed, resent by the next oled_flush() */
+static volatile uint8_t flushFailed[OLED_DISPLAY_PAGES];
+#endif
+
+PROF_ZONE(clearZone, "oled_clear");
+PROF_ZONE(flushZone, "oled_flush");
+
 static uint8_t const  font_mask[8] = {0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01};
 
+/*
+ * Scaled glyph rows for oled_putBigChar. A big character draws every font
+ * pixel as a size x size block with a pitch of size+1, so entry [size-1][n]
+ * is the vertical bit pattern of the four font rows in nibble n.
+ */
+static uint32_t const scale_nibble[GLYPH_MAX_SCALE][16] = {
+    /* size 1 */
+    {0x00000, 0x00001, 0x00004, 0x00005,
+     0x00010, 0x00011, 0x00014, 0x00015,
+     0x00040, 0x00041, 0x00044, 0x00045,
+     0x00050, 0x00051, 0x00054, 0x00055},
+    /* size 2 */
+    {0x00000, 0x00003, 0x00018, 0x0001b,
+     0x000c0, 0x000c3, 0x000d8, 0x000db,
+     0x00600, 0x00603, 0x00618, 0x0061b,
+     0x006c0, 0x006c3, 0x006d8, 0x006db},
+    /* size 3 */
+    {0x00000, 0x00007, 0x00070, 0x00077,
+     0x00700, 0x00707, 0x00770, 0x00777,
+     0x07000, 0x07007, 0x07070, 0x07077,
+     0x07700, 0x07707, 0x07770, 0x07777},
+    /* size 4 */
+    {0x00000, 0x0000f, 0x001e0, 0x001ef,
+     0x03c00, 0x03c0f, 0x03de0, 0x03def,
+     0x78000, 0x7800f, 0x781e0, 0x781ef,
+     0x7bc00, 0x7bc0f, 0x7bde0, 0x7bdef},
+};
+
 
 /******************************************************************************
  * Local Functions
@@ -124,6 +192,8 @@ writeCommand(uint8_t data)
 
 #else
     SSP_DATA_SETUP_Type xferConfig;
+
+    ssp1_lock();
     OLED_CMD();
     OLED_CS_ON();
 
@@ -135,6 +205,7 @@ writeCommand(uint8_t data)
     //SSPSend( (uint8_t *)&data, 1 );
 
     OLED_CS_OFF();
+    ssp1_unlock();
 #endif
 }
 
@@ -160,10 +231,9 @@ writeData(uint8_t data)
 
 
 #else
-//	// 7seg in timer2 uses SSP
-//	NVIC_DisableIRQ(TIMER2_IRQn);
-
     SSP_DATA_SETUP_Type xferConfig;
+
+    ssp1_lock();
     OLED_DATA();
     OLED_CS_ON();
 
@@ -175,7 +245,7 @@ writeData(uint8_t data)
     //SSPSend( (uint8_t *)&data, 1 );
 
     OLED_CS_OFF();
-//    NVIC_EnableIRQ(TIMER2_IRQn);
+    ssp1_unlock();
 #endif
 }
 
@@ -207,7 +277,7 @@ writeDataLen(unsigned char data, unsigned int len)
     I2CWrite(OLED_I2C_ADDR, buf, len+1);
 
 #else
-    int i;
+    unsigned int i;
     uint8_t buf[140];
     SSP_DATA_SETUP_Type xferConfig;
 
@@ -215,6 +285,8 @@ writeDataLen(unsigned char data, unsigned int len)
         buf[i] = data;
     }
 
+    ssp1_lock();
+
     OLED_DATA();
     OLED_CS_ON();
 
@@ -227,10 +299,331 @@ writeDataLen(unsigned char data, unsigned int len)
     //SSPSend( (uint8_t *)buf, len );
 
     OLED_CS_OFF();
+    ssp1_unlock();
 #endif
 }
 
 
+/******************************************************************************
+ *
+ * Description:
+ *    Write a buffer of data to the display in one transfer
+ *
+ * Params:
+ *   [in] buf - data (columns) to write to the display
+ *   [in] len - number of bytes to write
+ *
+ *****************************************************************************/
+static void
+writeDataBuf(uint8_t *buf, unsigned int len)
+{
+#ifdef OLED_USE_I2C
+    int i;
+    uint8_t tmp[OLED_DISPLAY_WIDTH+1];
+
+    tmp[0] = 0x40; // write Co & D/C bits
+
+    for (i = 0; i < len; i++) {
+        tmp[i+1] = buf[i];
+    }
+
+    I2CWrite(OLED_I2C_ADDR, tmp, len+1);
+
+#else
+    SSP_DATA_SETUP_Type xferConfig;
+
+    ssp1_lock();
+
+    OLED_DATA();
+    OLED_CS_ON();
+
+	xferConfig.tx_data = buf;
+	xferConfig.rx_data = NULL;
+	xferConfig.length  = len;
+
+    SSP_ReadWrite(LPC_SSP1, &xferConfig, SSP_TRANSFER_POLLING);
+
+    OLED_CS_OFF();
+    ssp1_unlock();
+#endif
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Mark a span of columns in a page as modified
+ *
+ * Params:
+ *   [in] page - page index (0-7)
+ *   [in] x0 - first modified column
+ *   [in] x1 - last modified column
+ *
+ *****************************************************************************/
+static void markDirty(uint8_t page, uint8_t x0, uint8_t x1)
+{
+    if (x0 < dirtyFirst[page])
+        dirtyFirst[page] = x0;
+    if (x1 > dirtyLast[page])
+        dirtyLast[page] = x1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Mark all pages as clean
+ *
+ *****************************************************************************/
+static void clearDirty(void)
+{
+    memset(dirtyFirst, 0xff, OLED_DISPLAY_PAGES);
+    memset(dirtyLast, 0x00, OLED_DISPLAY_PAGES);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Narrow the dirty span of a page to the columns that differ from the
+ *    display
+ *
+ * Params:
+ *   [in] page - page index (0-7)
+ *
+ * Returns:
+ *   1 if there is a span to send (dirtyFirst..dirtyLast), 0 if the page
+ *   is clean
+ *
+ *****************************************************************************/
+static uint8_t trimDirty(uint8_t page)
+{
+    uint8_t *fb = &shadowFB[page*OLED_DISPLAY_WIDTH];
+    uint8_t *panel = &panelFB[page*OLED_DISPLAY_WIDTH];
+    uint8_t x0 = dirtyFirst[page];
+    uint8_t x1 = dirtyLast[page];
+
+    while (x0 <= x1 && fb[x0] == panel[x0])
+        x0++;
+
+    if (x0 > x1) {
+        dirtyFirst[page] = 0xff;
+        dirtyLast[page] = 0x00;
+        return 0;
+    }
+
+    while (fb[x1] == panel[x1])
+        x1--;
+
+    dirtyFirst[page] = x0;
+    dirtyLast[page] = x1;
+
+    return 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Write a span of columns from the shadow framebuffer to the display
+ *
+ * Params:
+ *   [in] page - page index (0-7)
+ *   [in] x0 - first column
+ *   [in] x1 - last column
+ *
+ *****************************************************************************/
+static void writeSpan(uint8_t page, uint8_t x0, uint8_t x1)
+{
+    uint8_t add = x0 + X_OFFSET;
+
+    setAddress(0xB0 + page, 0x0F & add, 0x10 | (add >> 4));
+    writeDataBuf(&shadowFB[page*OLED_DISPLAY_WIDTH + x0], x1 - x0 + 1);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Publish a modified area of the shadow framebuffer. Written to the
+ *    display right away in immediate mode, otherwise marked dirty.
+ *
+ * Params:
+ *   [in] page0 - first page
+ *   [in] page1 - last page
+ *   [in] x0 - first column
+ *   [in] x1 - last column
+ *
+ *****************************************************************************/
+static void commitArea(uint8_t page0, uint8_t page1, uint8_t x0, uint8_t x1)
+{
+    for (; page0 <= page1; page0++) {
+        if (flushMode == OLED_FLUSH_DEFERRED) {
+            markDirty(page0, x0, x1);
+        }
+        else {
+            writeSpan(page0, x0, x1);
+        }
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Expand a font column to a big character column
+ *
+ * Params:
+ *   [in] col - font column, top row in bit 0
+ *   [in] size - scale factor (1-4)
+ *
+ *****************************************************************************/
+static uint64_t scaleColumn(uint8_t col, uint8_t size)
+{
+    uint32_t const *nibble = scale_nibble[size-1];
+
+    return nibble[col & 0x0F] | ((uint64_t)nibble[col >> 4] << (4*(size+1)));
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Draw a character one page column at a time. Pixels of a scaled
+ *    character are laid out exactly as oled_putBigPixel would draw them,
+ *    the gaps between the blocks are left untouched.
+ *
+ * Params:
+ *   [in] x - x position
+ *   [in] y - y position
+ *   [in] ch - font index (character - 0x20)
+ *   [in] fb - foreground color
+ *   [in] bg - background color
+ *   [in] size - 0 for the normal font, 1-4 for oled_putBigChar scaling
+ *
+ *****************************************************************************/
+static void blitGlyph(uint8_t x, uint8_t y, uint8_t ch, oled_color_t fb,
+        oled_color_t bg, uint8_t size)
+{
+    uint8_t const *glyph = font5x7_col[ch];
+    uint8_t pageMask[OLED_DISPLAY_PAGES];
+    uint8_t *column;
+    uint64_t mask = 0xFF;
+    uint64_t set = 0;
+    uint64_t on = 0;
+    uint8_t pitch = 1;
+    uint8_t width = 1;
+    uint8_t height = 8;
+    uint8_t page0 = y >> 3;
+    uint8_t pages = 0;
+    uint8_t lastX = x;
+    uint8_t lastY = 0;
+    uint8_t cx = 0;
+    uint8_t w, m, o;
+    uint8_t j, p, k;
+
+    if (size > 0) {
+        mask = scaleColumn(0xFF, size);
+        pitch = size + 1;
+        width = size;
+        height = 8*pitch - 1;
+    }
+
+    lastY = y + height - 1;
+    if (lastY >= OLED_DISPLAY_HEIGHT)
+        lastY = OLED_DISPLAY_HEIGHT - 1;
+
+    /* the glyph covers the same rows in every column */
+    pages = (lastY >> 3) - page0 + 1;
+    mask <<= (y & 0x07);
+    for (p = 0; p < pages; p++)
+        pageMask[p] = (uint8_t)(mask >> 8*p);
+
+    for (j = 0; j < GLYPH_COLUMNS; j++) {
+        cx = x + j*pitch;
+        if (cx >= OLED_DISPLAY_WIDTH)
+            break;
+
+        set = (size > 0) ? scaleColumn(glyph[j], size) : glyph[j];
+
+        on = 0;
+        if (fb != OLED_COLOR_BLACK)
+            on |= set;
+        if (bg != OLED_COLOR_BLACK)
+            on |= ~set;
+        on <<= (y & 0x07);
+
+        w = (width < OLED_DISPLAY_WIDTH - cx) ? width : OLED_DISPLAY_WIDTH - cx;
+        column = &shadowFB[page0*OLED_DISPLAY_WIDTH + cx];
+
+        for (p = 0; p < pages; p++) {
+            m = pageMask[p];
+            o = (uint8_t)(on >> 8*p) & m;
+            for (k = 0; k < w; k++)
+                column[k] = (column[k] & ~m) | o;
+            column += OLED_DISPLAY_WIDTH;
+        }
+
+        lastX = cx + w - 1;
+    }
+
+    commitArea(page0, lastY >> 3, x, lastX);
+}
+
+#ifndef OLED_USE_I2C
+/******************************************************************************
+ *
+ * Description:
+ *    Background flush: a page has been sent (interrupt context)
+ *
+ *****************************************************************************/
+static void flushPageDone(int32_t status, void *arg)
+{
+    if (status != SSP1_XFER_OK) {
+        flushFailed[(uintptr_t) arg] = 1;
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Background flush: queue the transfer of a span of a page
+ *
+ * Returns:
+ *   0 if queued, -1 if the queue is full
+ *
+ *****************************************************************************/
+static int flushQueuePage(uint8_t page, uint8_t x0, uint8_t x1)
+{
+    ssp1_xact_t *x = &flushXact[page];
+    uint8_t *panel = &panelFB[page*OLED_DISPLAY_WIDTH];
+    uint8_t old[OLED_DISPLAY_WIDTH];
+    uint8_t add = x0 + X_OFFSET;
+    uint8_t len = x1 - x0 + 1;
+
+    flushCmd[page][0] = 0xB0 + page;
+    flushCmd[page][1] = 0x0F & add;
+    flushCmd[page][2] = 0x10 | (add >> 4);
+
+    x->csPort = BOARD_PORT(OLED_CS);
+    x->csMask = BOARD_MASK(OLED_CS);
+    x->dcPort = BOARD_PORT(OLED_DC);
+    x->dcMask = BOARD_MASK(OLED_DC);
+    x->cmd = flushCmd[page];
+    x->cmdLen = 3;
+    x->tx = &panel[x0];
+    x->rx = NULL;
+    x->len = len;
+    x->done = flushPageDone;
+    x->arg = (void *) (uintptr_t) page;
+
+    /* the transfer may start within ssp1_submit, so the span is copied
+       first and taken back if it isn't queued */
+    memcpy(&old[x0], &panel[x0], len);
+    memcpy(&panel[x0], &shadowFB[page*OLED_DISPLAY_WIDTH + x0], len);
+
+    if (ssp1_submit(x) != 0) {
+        memcpy(&panel[x0], &old[x0], len);
+        return (-1);
+    }
+
+    return 0;
+}
+#endif
+
 /******************************************************************************
  *
  * Description:
@@ -360,17 +753,12 @@ void oled_init (void)
 {
     int i = 0;
 
-    //GPIO_SetDir(PORT0, 0, 1);
-    GPIO_SetDir(2, (1<<1), 1);
-    GPIO_SetDir(2, (1<<7), 1);
-    GPIO_SetDir(0, (1<<6), 1);
-
-    /* make sure power is off */
-    GPIO_ClearValue( 2, (1<<1) );
+    /* make sure power is off (the pins are outputs, see board_init) */
+    GPIO_ClearValue( BOARD_PORT(OLED_VCC), BOARD_MASK(OLED_VCC) );
 
 #ifdef OLED_USE_I2C
-    GPIO_ClearValue( 2, (1<<7)); // D/C#
-    GPIO_ClearValue( 0, (1<<6)); // CS#
+    GPIO_ClearValue( BOARD_PORT(OLED_DC), BOARD_MASK(OLED_DC)); // D/C#
+    GPIO_ClearValue( BOARD_PORT(OLED_CS), BOARD_MASK(OLED_CS)); // CS#
 #else
     OLED_CS_OFF();
 #endif
@@ -378,12 +766,13 @@ void oled_init (void)
     runInitSequence();
 
     memset(shadowFB, 0, SHADOW_FB_SIZE);
+    clearDirty();
 
     /* small delay before turning on power */
     for (i = 0; i < 0xffff; i++);
 
      /* power on */
-    GPIO_SetValue( 2, (1<<1) );
+    GPIO_SetValue( BOARD_PORT(OLED_VCC), BOARD_MASK(OLED_VCC) );
 }
 
 /******************************************************************************
@@ -405,43 +794,37 @@ void oled_putPixel(uint8_t x, uint8_t y, oled_color_t color) {
     uint8_t mask;
     uint32_t shadowPos = 0;
 
-    if (x > OLED_DISPLAY_WIDTH) {
+    if (x >= OLED_DISPLAY_WIDTH) {
         return;
     }
-    if (y > OLED_DISPLAY_HEIGHT) {
+    if (y >= OLED_DISPLAY_HEIGHT) {
         return;
     }
 
     /* page address */
-         if(y < 8)  page = 0xB0;
-    else if(y < 16) page = 0xB1;
-    else if(y < 24) page = 0xB2;
-    else if(y < 32) page = 0xB3;
-    else if(y < 40) page = 0xB4;
-    else if(y < 48) page = 0xB5;
-    else if(y < 56) page = 0xB6;
-    else            page = 0xB7;
-
-    add = x + X_OFFSET;
-    lAddr = 0x0F & add;             // Low address
-    hAddr = 0x10 | (add >> 4);      // High address
+    page = y >> 3;
 
-    // Calculate mask from rows basically do a y%8 and remainder is bit position
-    add = y>>3;                     // Divide by 8
-    add <<= 3;                      // Multiply by 8
-    add = y - add;                  // Calculate bit position
-    mask = 1 << add;                // Left shift 1 by bit position
+    // Remainder of y/8 is the bit position within the page
+    mask = 1 << (y & 0x07);
 
-    setAddress(page, lAddr, hAddr); // Set the address (sets the page,
-                                    // lower and higher column address pointers)
-
-    shadowPos = (page-0xB0)*OLED_DISPLAY_WIDTH+x;
+    shadowPos = page*OLED_DISPLAY_WIDTH+x;
 
     if(color > 0)
         shadowFB[shadowPos] |= mask;
     else
         shadowFB[shadowPos] &= ~mask;
 
+    if (flushMode == OLED_FLUSH_DEFERRED) {
+        markDirty(page, x, x);
+        return;
+    }
+
+    add = x + X_OFFSET;
+    lAddr = 0x0F & add;             // Low address
+    hAddr = 0x10 | (add >> 4);      // High address
+
+    setAddress(0xB0 + page, lAddr, hAddr); // Set the address (sets the page,
+                                           // lower and higher column address pointers)
 
     writeData(shadowFB[shadowPos]);
 }
@@ -772,27 +1155,158 @@ void oled_clearScreen(oled_color_t color)
 {
     uint8_t i;
     uint8_t c = 0;
+    PROF_BEGIN(clearZone);
 
     if (color == OLED_COLOR_WHITE)
         c = 0xff;
 
+    memset(shadowFB, c, SHADOW_FB_SIZE);
 
-    for(i=0xB0;i<0xB8;i++) {            // Go through all 8 pages
-        setAddress(i,0x00,0x10);
-        writeDataLen(c, 132);
+    if (flushMode == OLED_FLUSH_DEFERRED) {
+        for(i = 0; i < OLED_DISPLAY_PAGES; i++) {
+            markDirty(i, 0, OLED_DISPLAY_WIDTH-1);
+        }
+    }
+    else {
+        for(i=0xB0;i<0xB8;i++) {            // Go through all 8 pages
+            setAddress(i,0x00,0x10);
+            writeDataLen(c, 132);
+        }
     }
 
-    memset(shadowFB, c, SHADOW_FB_SIZE);
+    PROF_END(clearZone);
 }
 
-// fb == front, bg == background
-uint8_t oled_putChar(uint8_t x, uint8_t y, uint8_t ch, oled_color_t fb, oled_color_t bg)
+/******************************************************************************
+ *
+ * Description:
+ *    Replace the whole screen with a framebuffer image, e.g. a screen
+ *    rendered at build time
+ *
+ * Params:
+ *   [in] fb - OLED_FB_SIZE bytes in framebuffer format
+ *
+ *****************************************************************************/
+void oled_loadFramebuffer(const uint8_t *fb)
 {
-    unsigned char data = 0;
-    unsigned char i = 0, j = 0;
+    memcpy(shadowFB, fb, SHADOW_FB_SIZE);
+    commitArea(0, OLED_DISPLAY_PAGES-1, 0, OLED_DISPLAY_WIDTH-1);
+}
 
-    oled_color_t color = OLED_COLOR_BLACK;
+/******************************************************************************
+ *
+ * Description:
+ *    Get the framebuffer, OLED_FB_SIZE bytes. The drawing functions
+ *    update it in both flush modes.
+ *
+ *****************************************************************************/
+const uint8_t *oled_getFramebuffer(void)
+{
+    return shadowFB;
+}
 
+/******************************************************************************
+ *
+ * Description:
+ *    Select whether drawing functions update the display immediately or
+ *    only the shadow framebuffer. Switching back to immediate mode flushes
+ *    any pending changes.
+ *
+ * Params:
+ *   [in] mode - OLED_FLUSH_IMMEDIATE or OLED_FLUSH_DEFERRED
+ *
+ *****************************************************************************/
+void oled_setFlushMode(oled_flush_mode_t mode)
+{
+    if (mode == OLED_FLUSH_IMMEDIATE) {
+        oled_flush();
+    }
+    else if (flushMode == OLED_FLUSH_IMMEDIATE) {
+        clearDirty();
+        /* immediate mode keeps the display equal to shadowFB */
+        memcpy(panelFB, shadowFB, SHADOW_FB_SIZE);
+    }
+
+    flushMode = mode;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Push the modified columns of the shadow framebuffer to the display.
+ *    Each page with pending changes costs one address setup and a single
+ *    burst covering its dirty column span, trimmed to the columns that
+ *    differ from the display.
+ *
+ *    When the SSP1 DMA driver has been initialized (ssp1_init) the pages
+ *    are queued on the SSP1 bus manager and this function returns
+ *    immediately. Pages whose previous transfer is still queued keep their
+ *    changes until a later call.
+ *
+ *****************************************************************************/
+void oled_flush(void)
+{
+    uint8_t page;
+#ifndef OLED_USE_I2C
+    uint8_t i;
+#endif
+
+    if (flushMode != OLED_FLUSH_DEFERRED) {
+        return;
+    }
+
+    PROF_BEGIN(flushZone);
+
+#ifndef OLED_USE_I2C
+    if (ssp1_isReady()) {
+        for (page = 0; page < OLED_DISPLAY_PAGES; page++) {
+            if (flushFailed[page] && !flushXact[page].pending) {
+                flushFailed[page] = 0;
+                /* the display content is unknown, make every column
+                   differ from panelFB */
+                for (i = 0; i < OLED_DISPLAY_WIDTH; i++) {
+                    panelFB[page*OLED_DISPLAY_WIDTH + i] =
+                            ~shadowFB[page*OLED_DISPLAY_WIDTH + i];
+                }
+                markDirty(page, 0, OLED_DISPLAY_WIDTH-1);
+            }
+
+            if (flushXact[page].pending
+                    || dirtyFirst[page] > dirtyLast[page]
+                    || !trimDirty(page)) {
+                continue;
+            }
+
+            if (flushQueuePage(page, dirtyFirst[page], dirtyLast[page]) == 0) {
+                dirtyFirst[page] = 0xff;
+                dirtyLast[page] = 0x00;
+            }
+        }
+        PROF_END(flushZone);
+        return;
+    }
+#endif
+
+    for (page = 0; page < OLED_DISPLAY_PAGES; page++) {
+        if (dirtyFirst[page] > dirtyLast[page] || !trimDirty(page)) {
+            continue;
+        }
+
+        writeSpan(page, dirtyFirst[page], dirtyLast[page]);
+        memcpy(&panelFB[page*OLED_DISPLAY_WIDTH + dirtyFirst[page]],
+                &shadowFB[page*OLED_DISPLAY_WIDTH + dirtyFirst[page]],
+                dirtyLast[page] - dirtyFirst[page] + 1);
+
+        dirtyFirst[page] = 0xff;
+        dirtyLast[page] = 0x00;
+    }
+
+    PROF_END(flushZone);
+}
+
+// fb == front, bg == background
+uint8_t oled_putChar(uint8_t x, uint8_t y, uint8_t ch, oled_color_t fb, oled_color_t bg)
+{
     if((x >= (OLED_DISPLAY_WIDTH - 8)) || (y >= (OLED_DISPLAY_HEIGHT - 8)) )
     {
         return 0;
@@ -803,26 +1317,8 @@ uint8_t oled_putChar(uint8_t x, uint8_t y, uint8_t ch, oled_color_t fb, oled_col
         ch = 0x20;      /* unknown character will be set to blank */
     }
 
-    ch -= 0x20;
-    for(i=0; i<8; i++)
-    {
-        data = font5x7[ch][i];
-        for(j=0; j<6; j++)
-        {
-            if( (data&font_mask[j])==0 )
-            {
-                color = bg;
-            }
-            else
-            {
-                color = fb;
-            }
-            oled_putPixel(x, y, color);
-            x++;
-        }
-        y++;
-        x -= 6;
-    }
+    blitGlyph(x, y, ch - 0x20, fb, bg, 0);
+
     return( 1 );
 }
 
@@ -845,6 +1341,13 @@ uint8_t oled_putBigChar(uint8_t x, uint8_t y, uint8_t ch, oled_color_t fb, oled_
     }
 
     ch -= 0x20;
+
+    if (size > 0 && size <= GLYPH_MAX_SCALE)
+    {
+        blitGlyph(x, y, ch, fb, bg, size);
+        return( 1 );
+    }
+
     for(i=0; i<8; i++)
     {
         data = font5x7[ch][i];
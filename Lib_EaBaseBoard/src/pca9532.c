@@ -16,14 +16,13 @@
  *****************************************************************************/
 
 #include "lpc17xx_i2c.h"
+#include "i2c2.h"
 #include "pca9532.h"
 
 /******************************************************************************
  * Defines and typedefs
  *****************************************************************************/
 
-#define I2CDEV LPC_I2C2
-
 #define LS_MODE_ON     0x01
 #define LS_MODE_BLINK0 0x02
 #define LS_MODE_BLINK1 0x03
@@ -41,46 +40,15 @@ static uint16_t blink0Shadow = 0;
 static uint16_t blink1Shadow = 0;
 static uint16_t ledStateShadow = 0;
 
+/* state of pca9532_setLeds_async */
+static i2c2_xact_t lsXact;
+static uint8_t lsBuf[5];
+static volatile uint8_t lsDirty = 0;
+
 /******************************************************************************
  * Local Functions
  *****************************************************************************/
 
-static int I2CRead(uint8_t addr, uint8_t* buf, uint32_t len)
-{
-	I2C_M_SETUP_Type rxsetup;
-
-	rxsetup.sl_addr7bit = addr;
-	rxsetup.tx_data = NULL;	// Get address to read at writing address
-	rxsetup.tx_length = 0;
-	rxsetup.rx_data = buf;
-	rxsetup.rx_length = len;
-	rxsetup.retransmissions_max = 3;
-
-	if (I2C_MasterTransferData(I2CDEV, &rxsetup, I2C_TRANSFER_POLLING) == SUCCESS){
-		return (0);
-	} else {
-		return (-1);
-	}
-}
-
-static int I2CWrite(uint8_t addr, uint8_t* buf, uint32_t len)
-{
-	I2C_M_SETUP_Type txsetup;
-
-	txsetup.sl_addr7bit = addr;
-	txsetup.tx_data = buf;
-	txsetup.tx_length = len;
-	txsetup.rx_data = NULL;
-	txsetup.rx_length = 0;
-	txsetup.retransmissions_max = 3;
-
-	if (I2C_MasterTransferData(I2CDEV, &txsetup, I2C_TRANSFER_POLLING) == SUCCESS){
-		return (0);
-	} else {
-		return (-1);
-	}
-}
-
 static void setLsStates(uint16_t states, uint8_t* ls, uint8_t mode)
 {
 #define IS_LED_SET(bit, x) ( ( ((x) & (bit)) != 0 ) ? 1 : 0 )
@@ -98,9 +66,8 @@ static void setLsStates(uint16_t states, uint8_t* ls, uint8_t mode)
     }
 }
 
-static void setLeds(void)
+static void buildLs(uint8_t *buf)
 {
-    uint8_t buf[5];
     uint8_t ls[4] = {0,0,0,0};
     uint16_t states = ledStateShadow;
 
@@ -116,7 +83,40 @@ static void setLeds(void)
     buf[2] = ls[1];
     buf[3] = ls[2];
     buf[4] = ls[3];
-    I2CWrite(PCA9532_I2C_ADDR, buf, 5);
+}
+
+static void setLeds(void)
+{
+    uint8_t buf[5];
+
+    buildLs(buf);
+    i2c2_write(PCA9532_I2C_ADDR, buf, 5);
+}
+
+static void sendLsAsync(void);
+
+static void lsDone(int32_t status, void *arg)
+{
+    if (lsDirty) {
+        sendLsAsync();
+    }
+}
+
+static void sendLsAsync(void)
+{
+    lsDirty = 0;
+
+    buildLs(lsBuf);
+
+    lsXact.addr = PCA9532_I2C_ADDR;
+    lsXact.tx = lsBuf;
+    lsXact.txLen = 5;
+    lsXact.rx = NULL;
+    lsXact.rxLen = 0;
+    lsXact.done = lsDone;
+    lsXact.arg = NULL;
+
+    i2c2_submit(&lsXact);
 }
 
 /******************************************************************************
@@ -170,15 +170,15 @@ uint16_t pca9532_getLedState (uint32_t shadow)
          */
 
         buf[0] = PCA9532_INPUT0;
-        I2CWrite(PCA9532_I2C_ADDR, buf, 1);
+        i2c2_write(PCA9532_I2C_ADDR, buf, 1);
 
-        I2CRead(PCA9532_I2C_ADDR, buf, 1);
+        i2c2_read(PCA9532_I2C_ADDR, buf, 1);
         ret = buf[0];
 
         buf[0] = PCA9532_INPUT1;
-        I2CWrite(PCA9532_I2C_ADDR, buf, 1);
+        i2c2_write(PCA9532_I2C_ADDR, buf, 1);
 
-        I2CRead(PCA9532_I2C_ADDR, buf, 1);
+        i2c2_read(PCA9532_I2C_ADDR, buf, 1);
         ret |= (buf[0] << 8);
 
         /* invert since LEDs are active low */
@@ -215,6 +215,39 @@ void pca9532_setLeds (uint16_t ledOnMask, uint16_t ledOffMask)
     setLeds();
 }
 
+/******************************************************************************
+ *
+ * Description:
+ *    Same as pca9532_setLeds but the LED states are written in the
+ *    background. If called while a previous write is queued the latest
+ *    states are written when that write completes. Must not be called
+ *    from more than one context.
+ *
+ * Params:
+ *    [in]  ledOnMask  - The LEDs that should be turned on. This mask has
+ *                       priority over ledOffMask
+ *    [in]  ledOffMask - The LEDs that should be turned off.
+ *
+ *****************************************************************************/
+void pca9532_setLeds_async (uint16_t ledOnMask, uint16_t ledOffMask)
+{
+    /* turn off leds */
+    ledStateShadow &= (~(ledOffMask) & 0xffff);
+
+    /* ledOnMask has priority over ledOffMask */
+    ledStateShadow |= ledOnMask;
+
+    /* turn off blinking */
+    blink0Shadow &= (~(ledOffMask) & 0xffff);
+    blink1Shadow &= (~(ledOffMask) & 0xffff);
+
+    lsDirty = 1;
+
+    if (!lsXact.pending) {
+        sendLsAsync();
+    }
+}
+
 /******************************************************************************
  *
  * Description:
@@ -231,7 +264,7 @@ void pca9532_setBlink0Period(uint8_t period)
 
     buf[0] = PCA9532_PSC0;
     buf[1] = period;
-    I2CWrite(PCA9532_I2C_ADDR, buf, 2);
+    i2c2_write(PCA9532_I2C_ADDR, buf, 2);
 }
 
 /******************************************************************************
@@ -256,7 +289,7 @@ void pca9532_setBlink0Duty(uint8_t duty)
 
     buf[0] = PCA9532_PWM0;
     buf[1] = tmp;
-    I2CWrite(PCA9532_I2C_ADDR, buf, 2);
+    i2c2_write(PCA9532_I2C_ADDR, buf, 2);
 }
 
 /******************************************************************************
@@ -291,7 +324,7 @@ void pca9532_setBlink1Period(uint8_t period)
 
     buf[0] = PCA9532_PSC1;
     buf[1] = period;
-    I2CWrite(PCA9532_I2C_ADDR, buf, 2);
+    i2c2_write(PCA9532_I2C_ADDR, buf, 2);
 }
 
 /******************************************************************************
@@ -317,7 +350,7 @@ void pca9532_setBlink1Duty(uint8_t duty)
 
     buf[0] = PCA9532_PWM1;
     buf[1] = tmp;
-    I2CWrite(PCA9532_I2C_ADDR, buf, 2);
+    i2c2_write(PCA9532_I2C_ADDR, buf, 2);
 }
 
 /******************************************************************************
@@ -0,0 +1,290 @@
+/*****************************************************************************
+ *   prof.c:  Cycle counting profiler
+ *
+ ******************************************************************************/
+
+/*
+ * Code sections are wrapped in PROF_BEGIN/PROF_END pairs (see prof.h).
+ * Each zone keeps count, min, max, total and a power of two histogram of
+ * its durations in DWT cycles. A zone joins the zone list the first time
+ * it is recorded, so only zones that actually ran are reported.
+ *
+ * When the debugger has enabled ITM and the PROF_ITM_PORT stimulus port,
+ * every measurement is also streamed as one 32-bit word: zone id in the
+ * top 8 bits, duration (saturated) in the low 24 bits. Words are dropped
+ * rather than waited for when the ITM FIFO is full.
+ *
+ * prof_record may be called from any context.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stddef.h>
+#include "LPC17xx.h"
+#include "prof.h"
+#include "fmt.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define ITM_DURATION_MASK 0x00FFFFFF
+
+#define DWT_CTRL_CYCCNTENA 1
+
+/* width of the zone name in prof_formatZone */
+#define NAME_WIDTH 14
+
+/******************************************************************************
+ * External global variables
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static prof_zone_t *zones = NULL;
+static prof_zone_t **zonesTail = &zones;
+static uint8_t numZones = 0;
+
+static uint32_t dropped = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static void addZone(prof_zone_t *zone)
+{
+    zone->min = 0xFFFFFFFF;
+    zone->id = ++numZones;
+    zone->next = NULL;
+
+    *zonesTail = zone;
+    zonesTail = &zone->next;
+}
+
+static void clearZone(prof_zone_t *zone)
+{
+    uint32_t i;
+
+    zone->count = 0;
+    zone->min = 0xFFFFFFFF;
+    zone->max = 0;
+    zone->total = 0;
+    for (i = 0; i < PROF_HIST_BINS; i++) {
+        zone->hist[i] = 0;
+    }
+}
+
+/* append text to the n characters in buf, up to size - 1 in total */
+static int append(char *buf, int n, int size, const char *text)
+{
+    while (*text != '\0' && n < size - 1) {
+        buf[n++] = *text++;
+    }
+    buf[n] = '\0';
+
+    return n;
+}
+
+static int appendNum(char *buf, int n, int size, uint32_t value)
+{
+    char text[FMT_NUM_LEN + 1];
+
+    fmt_uint(text, value, 0);
+
+    return append(buf, n, size, text);
+}
+
+static void itmStream(prof_zone_t *zone, uint32_t ticks)
+{
+    if ((ITM->TCR & ITM_TCR_ITMENA_Msk) == 0
+            || (ITM->TER & (1UL << PROF_ITM_PORT)) == 0) {
+        return;
+    }
+
+    if (ITM->PORT[PROF_ITM_PORT].u32 == 0) {
+        dropped++;
+        return;
+    }
+
+    if (ticks > ITM_DURATION_MASK) {
+        ticks = ITM_DURATION_MASK;
+    }
+    ITM->PORT[PROF_ITM_PORT].u32 = ((uint32_t)zone->id << 24) | ticks;
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the profiler, i.e. start the DWT cycle counter
+ *
+ *****************************************************************************/
+void prof_init (void)
+{
+#ifndef PROF_HOST
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    PROF_DWT_CYCCNT = 0;
+    PROF_DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+#endif
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Add a measurement to a zone. Normally called through PROF_END.
+ *
+ * Params:
+ *   [in] zone - the zone
+ *   [in] ticks - duration in cycles
+ *
+ *****************************************************************************/
+void prof_record(prof_zone_t *zone, uint32_t ticks)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t bin;
+
+    __disable_irq();
+
+    if (zone->id == 0) {
+        addZone(zone);
+    }
+
+    zone->count++;
+    zone->total += ticks;
+    if (ticks < zone->min) {
+        zone->min = ticks;
+    }
+    if (ticks > zone->max) {
+        zone->max = ticks;
+    }
+
+    bin = (ticks < 2) ? 0 : 31 - __builtin_clz(ticks);
+    if (bin >= PROF_HIST_BINS) {
+        bin = PROF_HIST_BINS - 1;
+    }
+    zone->hist[bin]++;
+
+    itmStream(zone, ticks);
+
+    __set_PRIMASK(primask);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Clear the statistics of all zones
+ *
+ *****************************************************************************/
+void prof_reset(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    prof_zone_t *z;
+
+    __disable_irq();
+    for (z = zones; z != NULL; z = z->next) {
+        clearZone(z);
+    }
+    dropped = 0;
+    __set_PRIMASK(primask);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of zones that have been entered
+ *
+ *****************************************************************************/
+uint32_t prof_numZones(void)
+{
+    return numZones;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Format the statistics of a zone as one text line (CRLF terminated):
+ *    name, count, min/mean/max and the non-empty histogram buckets as
+ *    <log2 of the upper bound>:<count>
+ *
+ * Params:
+ *   [in] index - zone index, 0 .. prof_numZones() - 1
+ *   [out] buf - output buffer
+ *   [in] len - size of buf, PROF_LINE_LEN is always enough
+ *
+ * Returns:
+ *   Length of the line, 0 if there is no such zone
+ *
+ *****************************************************************************/
+int prof_formatZone(uint32_t index, char *buf, uint32_t len)
+{
+    prof_zone_t *z = zones;
+    prof_zone_t snap;
+    uint32_t primask;
+    uint32_t i;
+    int size;
+    int n;
+
+    while (z != NULL && index-- > 0) {
+        z = z->next;
+    }
+    if (z == NULL || len < 3) {
+        return 0;
+    }
+
+    /* consistent copy, the zone may be updated from an interrupt */
+    primask = __get_PRIMASK();
+    __disable_irq();
+    snap = *z;
+    __set_PRIMASK(primask);
+
+    /* CR LF and the NUL follow */
+    size = len - 2;
+
+    n = append(buf, 0, size, snap.name);
+    while (n < NAME_WIDTH && n < size - 1) {
+        buf[n++] = ' ';
+    }
+    n = append(buf, n, size, " n=");
+    n = appendNum(buf, n, size, snap.count);
+    n = append(buf, n, size, " " PROF_TICK_UNIT " min=");
+    n = appendNum(buf, n, size, snap.count ? snap.min : 0);
+    n = append(buf, n, size, " avg=");
+    n = appendNum(buf, n, size,
+            snap.count ? (uint32_t)(snap.total / snap.count) : 0);
+    n = append(buf, n, size, " max=");
+    n = appendNum(buf, n, size, snap.max);
+    n = append(buf, n, size, " |");
+
+    for (i = 0; i < PROF_HIST_BINS; i++) {
+        if (snap.hist[i] != 0) {
+            n = append(buf, n, size, " ");
+            n = appendNum(buf, n, size, i + 1);
+            n = append(buf, n, size, ":");
+            n = appendNum(buf, n, size, snap.hist[i]);
+        }
+    }
+
+    buf[n++] = '\r';
+    buf[n++] = '\n';
+    buf[n] = '\0';
+
+    return n;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of measurements that couldn't be streamed over ITM
+ *
+ *****************************************************************************/
+uint32_t prof_getDropped(void)
+{
+    return dropped;
+}
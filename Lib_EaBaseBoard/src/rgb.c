@@ -11,6 +11,7 @@
  *****************************************************************************/
 
 #include "lpc17xx_gpio.h"
+#include "board.h"
 #include "rgb.h"
 
 /******************************************************************************
@@ -41,10 +42,7 @@
  *****************************************************************************/
 void rgb_init (void)
 {
-    GPIO_SetDir( 2, (1<<0), 1 );
-    GPIO_SetDir( 0, (1<<26), 1 );
-    GPIO_SetDir( 2, (1<<1), 1 );
-
+    /* the pins are set up by board_init */
 }
 
 
@@ -60,17 +58,18 @@ void rgb_init (void)
 void rgb_setLeds (uint8_t ledMask)
 {
     if ((ledMask & RGB_RED) != 0) {
-        GPIO_SetValue( 2, (1<<0) );
+        GPIO_SetValue( BOARD_PORT(RGB_RED), BOARD_MASK(RGB_RED) );
     } else {
-        GPIO_ClearValue( 2, (1<<0) );
+        GPIO_ClearValue( BOARD_PORT(RGB_RED), BOARD_MASK(RGB_RED) );
     }
 
     if ((ledMask & RGB_BLUE) != 0) {
-        GPIO_SetValue( 0, (1<<26) );
+        GPIO_SetValue( BOARD_PORT(RGB_BLUE), BOARD_MASK(RGB_BLUE) );
     } else {
-        GPIO_ClearValue( 0, (1<<26) );
+        GPIO_ClearValue( BOARD_PORT(RGB_BLUE), BOARD_MASK(RGB_BLUE) );
     }
 
+    /* green shares its pin with the OLED supply (BOARD_ALIAS) */
 //    if ((ledMask & RGB_GREEN) != 0) {
 //        GPIO_SetValue( 2, (1<<1) );
 //    } else {
@@ -9,6 +9,18 @@
 /*
  * NOTE: GPIOInit must have been called before using any functions in this
  * file.
+ *
+ * rotary_decode is the interrupt driven alternative to rotary_read. The
+ * switch makes one full Gray code cycle of A (P0.24) and B (P0.25) per
+ * detent, from idle 11, A leading when turned clockwise:
+ *
+ *   B A:  11 -> 10 -> 00 -> 01 -> 11
+ *
+ * Only the rising edge of A has to interrupt (one interrupt per detent),
+ * and B's level at that edge sets the direction: low clockwise (00 -> 01),
+ * high anti-clockwise (10 -> 11). This is not a full Gray code decoder,
+ * the other edges are never seen. An edge read back with A low (a
+ * bounce) is no step and is ignored.
  */
 
 /******************************************************************************
@@ -17,6 +29,7 @@
 
 
 #include "lpc17xx_gpio.h"
+#include "board.h"
 #include "rotary.h"
 
 /******************************************************************************
@@ -35,6 +48,11 @@
 #define R_R2 5
 #define R_R3 6
 
+/* B << 1 | A */
+#define ROTARY_STATE(levels) \
+    ((((levels) >> BOARD_PIN(ROTARY_B)) & 1) << 1 \
+        | (((levels) >> BOARD_PIN(ROTARY_A)) & 1))
+
 /******************************************************************************
  * External global variables
  *****************************************************************************/
@@ -43,6 +61,10 @@
  * Local variables
  *****************************************************************************/
 
+static uint32_t lastStep = 0;
+static int8_t lastDir = 0;
+static int32_t velocity = 0;
+
 /******************************************************************************
  * Local Functions
  *****************************************************************************/
@@ -122,3 +144,64 @@ uint8_t rotary_read (void)
     return event;
 
 }
+
+/******************************************************************************
+ *
+ * Description:
+ *    Decode a rising edge of A (P0.24) and update the velocity estimate
+ *
+ * Params:
+ *   [in] levels - port 0 pins read at the edge (GPIO_ReadValue(0))
+ *   [in] time - time of the edge in ms
+ *
+ * Returns:
+ *   +1 for a detent clockwise, -1 anti-clockwise, 0 for no step
+ *
+ *****************************************************************************/
+int8_t rotary_decode(uint32_t levels, uint32_t time)
+{
+    uint8_t state = ROTARY_STATE(levels);
+    uint32_t dt = time - lastStep;
+    int32_t rate;
+    int8_t dir;
+
+    if (!(state & 0x01)) {
+        return 0;
+    }
+    dir = (state & 0x02) ? -1 : +1;
+
+    if (dir != lastDir || dt >= ROTARY_IDLE_MS) {
+        /* first step of a turn, the speed is unknown yet */
+        velocity = 0;
+    } else {
+        rate = dir * (int32_t)(1000 / (dt != 0 ? dt : 1));
+        /* average of the last and this step's rate */
+        velocity = (velocity == 0) ? rate : (velocity + rate) / 2;
+    }
+
+    lastStep = time;
+    lastDir = dir;
+
+    return dir;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the spin velocity of the current turn
+ *
+ * Params:
+ *   [in] now - current time in ms
+ *
+ * Returns:
+ *   detents per second, negative anti-clockwise, 0 when not turning
+ *
+ *****************************************************************************/
+int32_t rotary_getVelocity(uint32_t now)
+{
+    if (now - lastStep >= ROTARY_IDLE_MS) {
+        return 0;
+    }
+
+    return velocity;
+}
@@ -0,0 +1,460 @@
+/*****************************************************************************
+ *   ssp1.c:  DMA driven transfers on the SSP1 bus
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: SSP1 must have been initialized before calling any functions in
+ * this file. The application must forward DMA_IRQHandler to
+ * GPDMA_IntHandler().
+ *
+ * All devices on SSP1 (OLED, 7 segment display, SPI flash) submit
+ * transaction descriptors to a queue owned by this module. The queue is
+ * lock-free (LDREX/STREX) so transactions may be submitted from any
+ * context, including interrupt handlers. Transactions are executed in
+ * submission order by whoever claims the bus: the submitter if the bus is
+ * idle, otherwise the DMA completion chain.
+ *
+ * A phase always runs on two DMA channels, one feeding the TX FIFO and
+ * one draining the RX FIFO. Completion is signalled by the RX channel since
+ * the last byte has then been shifted out on the bus, which makes it safe
+ * to switch D/C or release the chip select.
+ *
+ * Drivers that still use polled transfers must hold the bus with
+ * ssp1_lock()/ssp1_unlock(). Transactions submitted meanwhile are queued
+ * and executed when the bus is unlocked.
+ *
+ * Before ssp1_init has been called transactions are executed with polled
+ * transfers directly from ssp1_submit.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "lpc17xx_gpdma.h"
+#include "lpc17xx_gpio.h"
+#include "lpc17xx_ssp.h"
+#include "ssp1.h"
+#include "prof.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+/* channel 0 has the highest priority, RX must win to avoid overruns */
+#define SSP1_RX_CHANNEL 0
+#define SSP1_TX_CHANNEL 1
+
+#define SSP1_RX_DMACH LPC_GPDMACH0
+#define SSP1_TX_DMACH LPC_GPDMACH1
+
+#define QUEUE_MASK (SSP1_QUEUE_SIZE - 1)
+
+typedef enum
+{
+    PHASE_IDLE = 0,
+    PHASE_CMD,
+    PHASE_DATA
+} phase_t;
+
+/******************************************************************************
+ * External global variables
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static uint8_t initialized = 0;
+
+/*
+ * Producers claim a slot by incrementing head and publish the descriptor
+ * by writing a non-NULL pointer to it. The bus owner consumes slots at
+ * tail and stops at the first slot that hasn't been published yet.
+ */
+static ssp1_xact_t * volatile queue[SSP1_QUEUE_SIZE];
+static volatile uint32_t head = 0;
+static volatile uint32_t tail = 0;
+
+/* 1 while the bus is owned by the queue runner or a ssp1_lock() caller */
+static volatile uint32_t running = 0;
+
+static ssp1_xact_t *current = NULL;
+static phase_t phase = PHASE_IDLE;
+
+/* used when a transaction doesn't supply a TX or RX buffer */
+static uint8_t dummyTx = 0xFF;
+static uint8_t dummyRx = 0;
+
+PROF_ZONE(pollZone, "ssp1_poll");
+PROF_ZONE(dmaDoneZone, "ssp1_dmaDone");
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static void rxChannelCb(uint32_t channelStatus);
+static void txChannelCb(uint32_t channelStatus);
+
+static uint8_t claimBus(void)
+{
+    do {
+        if (__LDREXW((uint32_t *)&running) != 0) {
+            __CLREX();
+            return 0;
+        }
+    } while (__STREXW(1, (uint32_t *)&running) != 0);
+
+    return 1;
+}
+
+static int startDma(uint8_t *tx, uint8_t *rx, uint32_t len)
+{
+    GPDMA_Channel_CFG_Type rxCfg;
+    GPDMA_Channel_CFG_Type txCfg;
+
+    /* drop anything left over from polled transfers */
+    while (LPC_SSP1->SR & SSP_SR_RNE) {
+        dummyRx = LPC_SSP1->DR;
+    }
+    LPC_SSP1->ICR = SSP_ICR_BITMASK;
+
+    rxCfg.ChannelNum = SSP1_RX_CHANNEL;
+    rxCfg.TransferSize = len;
+    rxCfg.TransferWidth = 0;
+    rxCfg.SrcMemAddr = 0;
+    rxCfg.DstMemAddr = (uint32_t) (uintptr_t) (rx != NULL ? rx : &dummyRx);
+    rxCfg.TransferType = GPDMA_TRANSFERTYPE_P2M;
+    rxCfg.SrcConn = GPDMA_CONN_SSP1_Rx;
+    rxCfg.DstConn = 0;
+    rxCfg.DMALLI = 0;
+
+    txCfg.ChannelNum = SSP1_TX_CHANNEL;
+    txCfg.TransferSize = len;
+    txCfg.TransferWidth = 0;
+    txCfg.SrcMemAddr = (uint32_t) (uintptr_t) (tx != NULL ? tx : &dummyTx);
+    txCfg.DstMemAddr = 0;
+    txCfg.TransferType = GPDMA_TRANSFERTYPE_M2P;
+    txCfg.SrcConn = 0;
+    txCfg.DstConn = GPDMA_CONN_SSP1_Tx;
+    txCfg.DMALLI = 0;
+
+    if (GPDMA_Setup(&rxCfg, rxChannelCb) != SUCCESS
+            || GPDMA_Setup(&txCfg, txChannelCb) != SUCCESS) {
+        return (-1);
+    }
+
+    /* keep reading from / writing to the same dummy byte */
+    if (rx == NULL) {
+        SSP1_RX_DMACH->DMACCControl &= ~GPDMA_DMACCxControl_DI;
+    }
+    if (tx == NULL) {
+        SSP1_TX_DMACH->DMACCControl &= ~GPDMA_DMACCxControl_SI;
+    }
+
+    SSP_DMACmd(LPC_SSP1, SSP_DMA_TX, ENABLE);
+    SSP_DMACmd(LPC_SSP1, SSP_DMA_RX, ENABLE);
+
+    GPDMA_ChannelCmd(SSP1_RX_CHANNEL, ENABLE);
+    GPDMA_ChannelCmd(SSP1_TX_CHANNEL, ENABLE);
+
+    return (0);
+}
+
+/*
+ * Advance the current transaction to its next phase. Returns 1 while
+ * waiting for a DMA phase to complete, 0 when the transaction is done.
+ */
+static uint8_t stepXact(int32_t status)
+{
+    ssp1_xact_t *x = current;
+
+    if (status == SSP1_XFER_OK && phase == PHASE_IDLE) {
+        if (x->dcMask != 0) {
+            GPIO_ClearValue(x->dcPort, x->dcMask);
+        }
+        GPIO_ClearValue(x->csPort, x->csMask);
+
+        phase = PHASE_CMD;
+        if (x->cmdLen > 0) {
+            if (startDma(x->cmd, NULL, x->cmdLen) == 0) {
+                return 1;
+            }
+            status = SSP1_XFER_ERROR;
+        }
+    }
+
+    if (status == SSP1_XFER_OK && phase == PHASE_CMD) {
+        phase = PHASE_DATA;
+        if (x->len > 0) {
+            if (x->dcMask != 0) {
+                GPIO_SetValue(x->dcPort, x->dcMask);
+            }
+            if (startDma(x->tx, x->rx, x->len) == 0) {
+                return 1;
+            }
+            status = SSP1_XFER_ERROR;
+        }
+    }
+
+    GPIO_SetValue(x->csPort, x->csMask);
+
+    phase = PHASE_IDLE;
+    current = NULL;
+
+    /* the owner may reuse the descriptor from its callback */
+    x->pending = 0;
+    if (x->done != NULL) {
+        x->done(status, x->arg);
+    }
+
+    return 0;
+}
+
+static void pollXact(ssp1_xact_t *x)
+{
+    SSP_DATA_SETUP_Type xferConfig;
+    int32_t status = SSP1_XFER_OK;
+    PROF_BEGIN(pollZone);
+
+    if (x->dcMask != 0) {
+        GPIO_ClearValue(x->dcPort, x->dcMask);
+    }
+    GPIO_ClearValue(x->csPort, x->csMask);
+
+    if (x->cmdLen > 0) {
+        xferConfig.tx_data = x->cmd;
+        xferConfig.rx_data = NULL;
+        xferConfig.length  = x->cmdLen;
+
+        if (SSP_ReadWrite(LPC_SSP1, &xferConfig, SSP_TRANSFER_POLLING) < 0) {
+            status = SSP1_XFER_ERROR;
+        }
+    }
+
+    if (status == SSP1_XFER_OK && x->len > 0) {
+        if (x->dcMask != 0) {
+            GPIO_SetValue(x->dcPort, x->dcMask);
+        }
+
+        xferConfig.tx_data = x->tx;
+        xferConfig.rx_data = x->rx;
+        xferConfig.length  = x->len;
+
+        if (SSP_ReadWrite(LPC_SSP1, &xferConfig, SSP_TRANSFER_POLLING) < 0) {
+            status = SSP1_XFER_ERROR;
+        }
+    }
+
+    GPIO_SetValue(x->csPort, x->csMask);
+
+    PROF_END(pollZone);
+
+    x->pending = 0;
+    if (x->done != NULL) {
+        x->done(status, x->arg);
+    }
+}
+
+/*
+ * Execute queued transactions. Must be called with the bus claimed.
+ * Returns when the queue is empty (bus released) or a DMA phase is in
+ * progress (bus still claimed, continued from the DMA interrupt).
+ */
+static void runQueue(void)
+{
+    ssp1_xact_t *x;
+
+    for (;;) {
+        x = queue[tail & QUEUE_MASK];
+
+        if (x == NULL) {
+            running = 0;
+
+            /* a producer may have published after the check above */
+            if (queue[tail & QUEUE_MASK] == NULL || !claimBus()) {
+                return;
+            }
+            continue;
+        }
+
+        queue[tail & QUEUE_MASK] = NULL;
+        tail++;
+
+        if (!initialized) {
+            pollXact(x);
+            continue;
+        }
+
+        current = x;
+        if (stepXact(SSP1_XFER_OK)) {
+            return;
+        }
+    }
+}
+
+static void kickQueue(void)
+{
+    if (claimBus()) {
+        runQueue();
+    }
+}
+
+static void finishDma(int32_t status)
+{
+    if (current == NULL) {
+        return;
+    }
+
+    PROF_BEGIN(dmaDoneZone);
+
+    GPDMA_ChannelCmd(SSP1_TX_CHANNEL, DISABLE);
+    GPDMA_ChannelCmd(SSP1_RX_CHANNEL, DISABLE);
+
+    SSP_DMACmd(LPC_SSP1, SSP_DMA_TX, DISABLE);
+    SSP_DMACmd(LPC_SSP1, SSP_DMA_RX, DISABLE);
+
+    if (!stepXact(status)) {
+        runQueue();
+    }
+
+    PROF_END(dmaDoneZone);
+}
+
+static void rxChannelCb(uint32_t channelStatus)
+{
+    if (channelStatus == GPDMA_STAT_INTTC) {
+        finishDma(SSP1_XFER_OK);
+    }
+    else {
+        finishDma(SSP1_XFER_ERROR);
+    }
+}
+
+static void txChannelCb(uint32_t channelStatus)
+{
+    /* TX terminal count is of no interest, the RX channel finishes last */
+    if (channelStatus == GPDMA_STAT_INTERR) {
+        finishDma(SSP1_XFER_ERROR);
+    }
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the SSP1 DMA driver
+ *
+ *****************************************************************************/
+void ssp1_init (void)
+{
+    GPDMA_Init();
+
+    NVIC_ClearPendingIRQ(DMA_IRQn);
+    NVIC_EnableIRQ(DMA_IRQn);
+
+    initialized = 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Queue a transaction. It is started right away if the bus is idle.
+ *    May be called from any context.
+ *
+ * Params:
+ *   [in] xact - transaction descriptor. Must not be pending.
+ *
+ * Returns:
+ *   0 if the transaction was queued, -1 if the queue is full or the
+ *   descriptor is invalid
+ *
+ *****************************************************************************/
+int ssp1_submit(ssp1_xact_t *xact)
+{
+    uint32_t h;
+
+    if (xact == NULL || xact->pending
+            || xact->cmdLen > SSP1_MAX_XFER_LEN || xact->len > SSP1_MAX_XFER_LEN) {
+        return (-1);
+    }
+
+    /* claim a slot */
+    do {
+        h = __LDREXW((uint32_t *)&head);
+        if (h - tail >= SSP1_QUEUE_SIZE) {
+            __CLREX();
+            return (-1);
+        }
+    } while (__STREXW(h + 1, (uint32_t *)&head) != 0);
+
+    xact->pending = 1;
+    queue[h & QUEUE_MASK] = xact;
+
+    kickQueue();
+
+    return (0);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Take the bus for polled transfers. Waits until queued transactions
+ *    have completed. Must not be called from an interrupt handler.
+ *
+ *****************************************************************************/
+void ssp1_lock(void)
+{
+    while (!claimBus());
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Release the bus taken by ssp1_lock and run transactions that were
+ *    queued meanwhile
+ *
+ *****************************************************************************/
+void ssp1_unlock(void)
+{
+    running = 0;
+    kickQueue();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Check if ssp1_init has been called, i.e. if DMA transfers can be used
+ *
+ *****************************************************************************/
+uint8_t ssp1_isReady(void)
+{
+    return initialized;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Check if the bus is in use or transactions are queued
+ *
+ *****************************************************************************/
+uint8_t ssp1_isBusy(void)
+{
+    return (running != 0 || head != tail);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Wait for all queued transactions to complete. Must not be called
+ *    from an interrupt handler or while holding the bus.
+ *
+ *****************************************************************************/
+void ssp1_waitIdle(void)
+{
+    while (ssp1_isBusy());
+}
@@ -8,7 +8,16 @@
 
 /*
  * NOTE: GPIOInit must have been called before using any functions in this
- * file.
+ * file. The application must enable the rising edge GPIO interrupt on
+ * TEMP_PORT/TEMP_PIN and call temp_edgeHandler() from EINT3_IRQHandler.
+ *
+ * The period of the MAX6576 output is measured in the background: every
+ * rising edge is timestamped with a free-running 1 us timer and the
+ * temperature is computed from the time spanned by TEMP_NUM_PERIODS
+ * periods. Neither P0.2 nor P0.6 is a timer capture input, hence the
+ * GPIO interrupt is used as capture trigger. The interrupt latency only
+ * affects the two edges bounding a window, so the error is spread over
+ * the whole window.
  */
 
 /******************************************************************************
@@ -16,6 +25,7 @@
  *****************************************************************************/
 
 #include "lpc17xx_gpio.h"
+#include "lpc17xx_timer.h"
 #include "temp.h"
 
 /******************************************************************************
@@ -28,12 +38,6 @@
 #define TEMP_TS1 0
 #define TEMP_TS0 0
 
-/*
- * Pin 0.2 or pin 1.5 can be used as input source for the temp sensor
- * Selected by jumper J25.
- */
-//#define TEMP_USE_P0_6
-
 #if TEMP_TS1 == 0 && TEMP_TS0 == 0
 #define TEMP_SCALAR_DIV10 1
 #define NUM_HALF_PERIODS 340
@@ -48,16 +52,22 @@
 #define NUM_HALF_PERIODS 10
 #endif
 
+/* free-running timer used to timestamp the edges */
+#define TEMP_TIMER LPC_TIM3
 
-#define P0_6_STATE ((GPIO_ReadValue(0) & (1 << 6)) != 0)
-#define P0_2_STATE ((GPIO_ReadValue(0) & (1 << 2)) != 0)
+/* full periods per measurement */
+#define TEMP_NUM_PERIODS (NUM_HALF_PERIODS / 2)
 
+/*
+ * Plausible period range (-55 to 150 C). A period outside of it means an
+ * edge was missed (or a glitch was seen) and the window is restarted.
+ */
+#define TEMP_MIN_PERIOD_US ((2731 - 550) * TEMP_SCALAR_DIV10)
+#define TEMP_MAX_PERIOD_US ((2731 + 1500) * TEMP_SCALAR_DIV10)
 
-#ifdef TEMP_USE_P0_6
-#define    GET_TEMP_STATE P0_6_STATE
-#else
-#define    GET_TEMP_STATE P0_2_STATE
-#endif
+/* longest a measurement window can take, in ms */
+#define TEMP_MAX_WINDOW_MS \
+    ((TEMP_NUM_PERIODS * TEMP_MAX_PERIOD_US) / 1000 + 1)
 
 
 /******************************************************************************
@@ -70,6 +80,15 @@
 
 static uint32_t (*getTicks)(void) = NULL;
 
+/* edge handler state (interrupt context only) */
+static uint8_t started = 0;
+static uint32_t lastEdge = 0;
+static uint32_t windowStart = 0;
+static uint32_t periods = 0;
+
+static volatile int32_t latest = TEMP_NO_READING;
+static volatile uint32_t measurements = 0;
+
 /******************************************************************************
  * Local Functions
  *****************************************************************************/
@@ -81,7 +100,7 @@ static uint32_t (*getTicks)(void) = NULL;
 /******************************************************************************
  *
  * Description:
- *    Initialize Temp Sensor driver
+ *    Initialize Temp Sensor driver and start the timestamp timer
  *
  * Params:
  *   [in] getMsTicks - callback function for retrieving number of elapsed ticks
@@ -90,58 +109,103 @@ static uint32_t (*getTicks)(void) = NULL;
  *****************************************************************************/
 void temp_init (uint32_t (*getMsTicks)(void))
 {
-#ifdef TEMP_USE_P0_6
-    GPIO_SetDir( 0, (1<<6), 0 );
-#else
-    GPIO_SetDir( 0, (1<<2), 0 );
-#endif
+    TIM_TIMERCFG_Type timerCfg;
+
     getTicks = getMsTicks;
+
+    timerCfg.PrescaleOption = TIM_PRESCALE_USVAL;
+    timerCfg.PrescaleValue = 1;
+    TIM_Init(TEMP_TIMER, TIM_TIMER_MODE, &timerCfg);
+    TIM_Cmd(TEMP_TIMER, ENABLE);
 }
 
 /******************************************************************************
  *
  * Description:
- *    Read temperature
- *
- * Returns:
- *    10 x T(c), i.e. 10 times the temperature in Celcius. Example:
- *    if the temperature is 22.4 degrees the returned value is 224.
+ *    Rising edge on the sensor output. Must be called from the GPIO
+ *    interrupt handler after the interrupt has been cleared.
  *
  *****************************************************************************/
-int32_t temp_read (void)
+void temp_edgeHandler(void)
 {
-    uint8_t state = 0;
-    uint32_t t1 = 0;
-    uint32_t t2 = 0;
-    int i = 0;
+    uint32_t now = TEMP_TIMER->TC;
+    uint32_t period = now - lastEdge;
+
+    lastEdge = now;
+
+    if (!started || period < TEMP_MIN_PERIOD_US
+            || period > TEMP_MAX_PERIOD_US) {
+        started = 1;
+        windowStart = now;
+        periods = 0;
+        return;
+    }
+
+    if (++periods < TEMP_NUM_PERIODS) {
+        return;
+    }
 
     /*
      * T(C) = ( period (us) / scalar ) - 273.15 K
      *
      * 10T(C) = (period (us) / scalar_div10) - 2731 K
      */
+    latest = (int32_t)((now - windowStart
+            + (TEMP_NUM_PERIODS*TEMP_SCALAR_DIV10) / 2)
+            / (TEMP_NUM_PERIODS*TEMP_SCALAR_DIV10)) - 2731;
+    measurements++;
 
-    state = GET_TEMP_STATE;
-
-    /* get next state change before measuring time */
-    while(GET_TEMP_STATE == state);
-    state = !state;
+    windowStart = now;
+    periods = 0;
+}
 
-    t1 = getTicks();
+/******************************************************************************
+ *
+ * Description:
+ *    Wait for the next measurement to complete and return it. Gives up
+ *    after twice the longest measurement time if the sensor doesn't toggle.
+ *    Must not be called from an interrupt handler.
+ *
+ * Returns:
+ *    10 x T(c), i.e. 10 times the temperature in Celcius. Example:
+ *    if the temperature is 22.4 degrees the returned value is 224.
+ *    TEMP_NO_READING if no measurement is available.
+ *
+ *****************************************************************************/
+int32_t temp_read (void)
+{
+    uint32_t count = measurements;
+    uint32_t t1 = getTicks();
 
-    for (i = 0; i < NUM_HALF_PERIODS; i++) {
-        while(GET_TEMP_STATE == state);
-        state = !state;
-    }
+    while (measurements == count
+            && getTicks() - t1 < 2 * TEMP_MAX_WINDOW_MS);
 
-    t2 = getTicks();
-    if (t2 > t1) {
-        t2 = t2-t1;
-    }
-    else {
-        t2 = (0xFFFFFFFF - t1 + 1) + t2;
-    }
+    return latest;
+}
 
+/******************************************************************************
+ *
+ * Description:
+ *    Get the most recent measurement without blocking
+ *
+ * Returns:
+ *    10 x T(c), see temp_read. TEMP_NO_READING if no measurement has
+ *    completed yet.
+ *
+ *****************************************************************************/
+int32_t temp_read_latest (void)
+{
+    return latest;
+}
 
-    return ( (2*1000*t2) / (NUM_HALF_PERIODS*TEMP_SCALAR_DIV10) - 2731 );
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of completed measurements, e.g. to tell a new
+ *    measurement from the one returned by the last temp_read_latest
+ *
+ *****************************************************************************/
+uint32_t temp_getMeasurements (void)
+{
+    return measurements;
 }
@@ -16,6 +16,7 @@
  *****************************************************************************/
 
 #include "lpc17xx_i2c.h"
+#include "i2c2.h"
 #include "lpc17xx_uart.h"
 #include "lpc17xx_gpio.h"
 #include "uart2.h"
@@ -24,8 +25,6 @@
  * Defines and typedefs
  *****************************************************************************/
 
-#define I2CDEV LPC_I2C2
-
 #define UART2_ADDR (0x48)
 
 #define R_RHR 0x00
@@ -61,53 +60,25 @@
 
 static uint8_t channel = 0;
 
+/* state of uart2_send_async */
+static i2c2_xact_t sendXact;
+static uint8_t sendBuf[2];
+static uint8_t *sendData = NULL;
+static uint32_t sendLen = 0;
+static void (*sendDone)(int32_t status, void *arg) = NULL;
+static void *sendArg = NULL;
+
 /******************************************************************************
  * Local Functions
  *****************************************************************************/
 
-static int I2CRead(uint8_t addr, uint8_t* buf, uint32_t len)
-{
-	I2C_M_SETUP_Type rxsetup;
-
-	rxsetup.sl_addr7bit = addr;
-	rxsetup.tx_data = NULL;	// Get address to read at writing address
-	rxsetup.tx_length = 0;
-	rxsetup.rx_data = buf;
-	rxsetup.rx_length = len;
-	rxsetup.retransmissions_max = 3;
-
-	if (I2C_MasterTransferData(I2CDEV, &rxsetup, I2C_TRANSFER_POLLING) == SUCCESS){
-		return (0);
-	} else {
-		return (-1);
-	}
-}
-
-static int I2CWrite(uint8_t addr, uint8_t* buf, uint32_t len)
-{
-	I2C_M_SETUP_Type txsetup;
-
-	txsetup.sl_addr7bit = addr;
-	txsetup.tx_data = buf;
-	txsetup.tx_length = len;
-	txsetup.rx_data = NULL;
-	txsetup.rx_length = 0;
-	txsetup.retransmissions_max = 3;
-
-	if (I2C_MasterTransferData(I2CDEV, &txsetup, I2C_TRANSFER_POLLING) == SUCCESS){
-		return (0);
-	} else {
-		return (-1);
-	}
-}
-
 static void writeReg(uint8_t reg, uint8_t data)
 {
     uint8_t buf[2];
 
     buf[0] = SUB_ADDR(channel, reg);
     buf[1] = data;
-    I2CWrite(UART2_ADDR, buf, 2);
+    i2c2_write(UART2_ADDR, buf, 2);
 }
 
 static uint8_t readReg(uint8_t reg)
@@ -115,13 +86,84 @@ static uint8_t readReg(uint8_t reg)
     uint8_t buf[1];
 
     buf[0] = SUB_ADDR(channel, reg);
-    I2CWrite(UART2_ADDR, buf, 1);
-    I2CRead(UART2_ADDR, buf, 1);
+    i2c2_write(UART2_ADDR, buf, 1);
+    i2c2_read(UART2_ADDR, buf, 1);
 
     return buf[0];
 }
 
 
+/*
+ * uart2_send_async alternates between reading LSR and, once THRE is set,
+ * writing the next byte to THR. Each step is queued from the completion
+ * callback of the previous one.
+ */
+static void sendStep(int32_t status, void *arg);
+
+static void sendFinish(int32_t status)
+{
+    void (*done)(int32_t status, void *arg) = sendDone;
+
+    sendDone = NULL;
+    sendData = NULL;
+
+    if (done != NULL) {
+        done(status, sendArg);
+    }
+}
+
+static void sendReadLsr(void)
+{
+    sendBuf[0] = SUB_ADDR(channel, R_LSR);
+
+    sendXact.addr = UART2_ADDR;
+    sendXact.tx = sendBuf;
+    sendXact.txLen = 1;
+    sendXact.rx = &sendBuf[1];
+    sendXact.rxLen = 1;
+    sendXact.done = sendStep;
+    sendXact.arg = (void *) R_LSR;
+
+    if (i2c2_submit(&sendXact) != 0) {
+        sendFinish(I2C2_XFER_ERROR);
+    }
+}
+
+static void sendStep(int32_t status, void *arg)
+{
+    if (status != I2C2_XFER_OK) {
+        sendFinish(status);
+        return;
+    }
+
+    if ((uint32_t) arg == R_THR) {
+        sendData++;
+        sendLen--;
+
+        if (sendLen == 0) {
+            sendFinish(I2C2_XFER_OK);
+            return;
+        }
+    }
+    else if (sendBuf[1] & LSR_THRE) {
+        /* THRE status, write next byte */
+        sendBuf[0] = SUB_ADDR(channel, R_THR);
+        sendBuf[1] = *sendData;
+
+        sendXact.txLen = 2;
+        sendXact.rx = NULL;
+        sendXact.rxLen = 0;
+        sendXact.arg = (void *) R_THR;
+
+        if (i2c2_submit(&sendXact) != 0) {
+            sendFinish(I2C2_XFER_ERROR);
+        }
+        return;
+    }
+
+    sendReadLsr();
+}
+
 /******************************************************************************
  * Public Functions
  *****************************************************************************/
@@ -290,6 +332,46 @@ uint32_t uart2_receive(uint8_t *buffer, uint32_t length, uint32_t blocking)
     return recvd;
 }
 
+/******************************************************************************
+ *
+ * Description:
+ *    Send data to UART in the background. The callback is called from the
+ *    I2C interrupt when all data has been written to the UART.
+ *
+ * Params:
+ *   [in] buffer - buffer with data, must stay valid until the callback
+ *                 is called
+ *   [in] length - number of bytes of data
+ *   [in] done - completion callback, may be NULL
+ *   [in] arg - argument passed to the callback
+ *
+ * Returns:
+ *   0 if started, -1 if invalid parameters or a send is in progress
+ *
+ *****************************************************************************/
+int uart2_send_async(uint8_t *buffer, uint32_t length,
+        void (*done)(int32_t status, void *arg), void *arg)
+{
+    if (!buffer || length == 0) {
+        /* error */
+        return (-1);
+    }
+
+    if (sendData != NULL || sendXact.pending) {
+        return (-1);
+    }
+
+    sendData = buffer;
+    sendLen = length;
+    sendDone = done;
+    sendArg = arg;
+
+    /* errors from here on are reported through the callback */
+    sendReadLsr();
+
+    return (0);
+}
+
 uint8_t uart2_getModemStatus(void)
 {
     return readReg(R_MSR);
@@ -0,0 +1,257 @@
+/*****************************************************************************
+ *   uart3.c:  Interrupt driven transmitter for UART3
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: UART3 must have been initialized (UART_Init, UART_TxCmd) and
+ * uart3_init must have been called before using any other function in
+ * this file. The application must forward UART3_IRQHandler to
+ * UART3_StdIntHandler().
+ *
+ * Data is queued in a single producer / single consumer ring that is
+ * drained by the THRE interrupt, 16 bytes (one TX FIFO) at a time. The
+ * producer side (all public functions) must only be used from one
+ * context, i.e. not from interrupt handlers.
+ *
+ * uart3_reserve returns contiguous space in the ring so a message can be
+ * formatted in place and then queued with uart3_commit. When the space at
+ * the end of the ring is too short the remainder is skipped (padding) and
+ * the space is taken from the start of the ring.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <string.h>
+#include "lpc17xx_uart.h"
+#include "uart3.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define UARTDEV LPC_UART3
+
+#define RING_MASK (UART3_TX_SIZE - 1)
+
+#define TX_FIFO_SIZE 16
+
+/******************************************************************************
+ * External global variables
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static uint8_t ring[UART3_TX_SIZE];
+
+/* free running indexes, head is written by the producer, tail by the ISR */
+static volatile uint32_t head = 0;
+static volatile uint32_t tail = 0;
+
+/* ring[padStart..padEnd) is padding to be skipped by the ISR */
+static volatile uint32_t padStart = 0;
+static volatile uint32_t padEnd = 0;
+
+/* length of the outstanding reservation */
+static uint32_t reserved = 0;
+
+/* 1 while the THRE interrupt is expected to refill the FIFO */
+static volatile uint8_t txActive = 0;
+
+static uint32_t dropped = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+/* fill the TX FIFO, must be called when the FIFO is empty */
+static void fillFifo(void)
+{
+    uint32_t t = tail;
+    uint32_t n = 0;
+
+    while (n < TX_FIFO_SIZE && t != head) {
+        if (t == padStart && t != padEnd) {
+            t = padEnd;
+            continue;
+        }
+        UART_SendData(UARTDEV, ring[t & RING_MASK]);
+        t++;
+        n++;
+    }
+
+    tail = t;
+    txActive = (n > 0);
+}
+
+/* THRE interrupt */
+static void txHandler(void)
+{
+    fillFifo();
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the interrupt driven transmitter
+ *
+ *****************************************************************************/
+void uart3_init (void)
+{
+    UART_SetupCbs(UARTDEV, 1, (void *)txHandler);
+    NVIC_EnableIRQ(UART3_IRQn);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Reserve contiguous space in the transmit ring. The data is not sent
+ *    until it has been committed with uart3_commit. Only one reservation
+ *    may be outstanding.
+ *
+ * Params:
+ *   [in] len - number of bytes to reserve
+ *
+ * Returns:
+ *   Pointer to the reserved space, NULL if the ring is too full
+ *
+ *****************************************************************************/
+uint8_t *uart3_reserve(uint32_t len)
+{
+    uint32_t h = head;
+    uint32_t contig = UART3_TX_SIZE - (h & RING_MASK);
+
+    if (len == 0 || len > UART3_TX_SIZE / 2) {
+        return NULL;
+    }
+
+    if (contig < len) {
+        /* skip the end of the ring */
+        if (h + contig + len - tail > UART3_TX_SIZE) {
+            dropped++;
+            return NULL;
+        }
+
+        padStart = h;
+        padEnd = h + contig;
+        head = padEnd;
+    } else if (h + len - tail > UART3_TX_SIZE) {
+        dropped++;
+        return NULL;
+    }
+
+    reserved = len;
+
+    return &ring[head & RING_MASK];
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Queue data written into space returned by uart3_reserve and start
+ *    transmitting if the transmitter is idle
+ *
+ * Params:
+ *   [in] len - number of bytes to send, at most the reserved length
+ *
+ *****************************************************************************/
+void uart3_commit(uint32_t len)
+{
+    if (len > reserved) {
+        len = reserved;
+    }
+    reserved = 0;
+
+    head += len;
+
+    /* keep the ISR out while checking if it is still running */
+    UART_IntConfig(UARTDEV, UART_INTCFG_THRE, DISABLE);
+    if (!txActive) {
+        fillFifo();
+    }
+    UART_IntConfig(UARTDEV, UART_INTCFG_THRE, ENABLE);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Queue data for transmission
+ *
+ * Params:
+ *   [in] data - data to send
+ *   [in] len - number of bytes to send
+ *
+ * Returns:
+ *   0 if the data was queued, -1 if the ring is too full (nothing queued)
+ *
+ *****************************************************************************/
+int uart3_send(const uint8_t *data, uint32_t len)
+{
+    uint8_t *p = uart3_reserve(len);
+
+    if (p == NULL) {
+        return (-1);
+    }
+
+    memcpy(p, data, len);
+    uart3_commit(len);
+
+    return (0);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Queue a null terminated string for transmission
+ *
+ * Returns:
+ *   0 if the string was queued, -1 if the ring is too full
+ *
+ *****************************************************************************/
+int uart3_sendString(const char *string)
+{
+    return uart3_send((const uint8_t *)string, strlen(string));
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of reservations that failed because the ring was full
+ *
+ *****************************************************************************/
+uint32_t uart3_getDropped(void)
+{
+    return dropped;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Check if queued data hasn't been handed to the UART yet
+ *
+ *****************************************************************************/
+uint8_t uart3_isBusy(void)
+{
+    uint32_t t = tail;
+
+    return (head != t && !(t == padStart && head == padEnd));
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Wait until all queued data has been handed to the UART
+ *
+ *****************************************************************************/
+void uart3_waitIdle(void)
+{
+    while (uart3_isBusy());
+}
@@ -121,9 +121,6 @@ static int32_t I2C_getNum(LPC_I2C_TypeDef *I2Cx){
  **********************************************************************/
 static uint32_t I2C_Start (LPC_I2C_TypeDef *I2Cx)
 {
-	// accel and light in EINT3 uses i2c
-	NVIC_DisableIRQ(EINT3_IRQn);
-
 	I2Cx->I2CONCLR = I2C_I2CONCLR_SIC;
 	I2Cx->I2CONSET = I2C_I2CONSET_STA;
 
@@ -151,8 +148,6 @@ static void I2C_Stop (LPC_I2C_TypeDef *I2Cx)
 	}
 	I2Cx->I2CONSET = I2C_I2CONSET_STO;
 	I2Cx->I2CONCLR = I2C_I2CONCLR_SIC;
-
-	NVIC_EnableIRQ(EINT3_IRQn);
 }
 
 
@@ -433,8 +428,10 @@ send_slar:
 retry:
 			// check if retransmission is available
 			if (txrx_setup->retransmissions_count < txrx_setup->retransmissions_max){
-				// Clear tx count
+				// Clear tx/rx count and restart with the write phase
 				txrx_setup->tx_count = 0;
+				txrx_setup->rx_count = 0;
+				i2cdat[tmp].dir = 0;
 				I2Cx->I2CONSET = I2C_I2CONSET_STA;
 				I2Cx->I2CONCLR = I2C_I2CONCLR_AAC | I2C_I2CONCLR_SIC;
 				txrx_setup->retransmissions_count++;
@@ -936,6 +933,7 @@ error:
 		i2cdat[tmp].inthandler = I2C_MasterHandler;
 		// Set direction phase, write first
 		i2cdat[tmp].dir = 0;
+		TransferCfg->retransmissions_count = 0;
 
 		/* First Start condition -------------------------------------------------------------- */
 		I2Cx->I2CONCLR = I2C_I2CONCLR_SIC;
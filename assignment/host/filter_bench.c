@@ -0,0 +1,220 @@
+/*****************************************************************************
+ *   filter_bench.c:  Host benchmark of the sensor filter stages
+ *
+ *   Checks the moving median against a sorted copy of the window, then
+ *   runs one hour of synthetic temperature measurements (noise and single
+ *   sample spikes, a real fire in the middle) through the firmware's
+ *   temperature alarm, raw and filtered, and reports the false alarms, the
+ *   detection delay and the cost per sample.
+ *
+ *     filter_bench [file]
+ *
+ *   With a file (one value in 0.1 C per line, e.g. a recorded trace) the
+ *   values are replayed through the filtered alarm instead, printing the
+ *   value, the filtered value and the alarm state per line.
+ *
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "filter.h"
+
+/* main.c: TEMP_HIGH_WARNING, TEMP_HYSTERESIS and tempFilter */
+#define WARNING 450
+#define HYSTERESIS 10
+
+/* one measurement about every 0.5 s */
+#define RUN_SAMPLES 7200UL
+#define FIRE_START 3600UL
+#define FIRE_END 3700UL
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static filter_stage_t tempFilter[] = {
+    FILTER_MEDIAN(3),
+    FILTER_EMA(FILTER_Q15(0.5)),
+};
+
+static uint32_t rnd(void)
+{
+    static uint32_t x = 2463534242u;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+static int cmp(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a;
+    int32_t y = *(const int32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static int checkMedian(uint8_t size)
+{
+    filter_median_t m;
+    int32_t window[FILTER_MEDIAN_MAX];
+    int32_t sorted[FILTER_MEDIAN_MAX];
+    int32_t x, got;
+    unsigned long i;
+    uint8_t j;
+
+    memset(&m, 0, sizeof(m));
+    m.size = size;
+
+    for (i = 0; i < 100000; i++) {
+        /* few distinct values, so duplicates are exercised */
+        x = (int32_t)(rnd() % 16) - 8;
+        got = filter_median(&m, x);
+
+        if (i == 0) {
+            for (j = 0; j < size; j++) {
+                window[j] = x;
+            }
+        } else {
+            memmove(window, window + 1, (size - 1) * sizeof(window[0]));
+            window[size - 1] = x;
+        }
+        memcpy(sorted, window, size * sizeof(window[0]));
+        qsort(sorted, size, sizeof(sorted[0]), cmp);
+
+        if (got != sorted[size / 2]) {
+            printf("  median of %u: %ld, expected %ld  <-- MISMATCH\n",
+                    size, (long)got, (long)sorted[size / 2]);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int32_t measurement(unsigned long i)
+{
+    int32_t t = (i >= FIRE_START && i < FIRE_END) ? 480 : 420;
+
+    t += (int32_t)(rnd() % 5) - 2;
+    /* a glitch every 500 measurements, e.g. a missed sensor edge */
+    if (rnd() % 500 == 0) {
+        t += 60;
+    }
+
+    return t;
+}
+
+static void run(void)
+{
+    static int32_t values[RUN_SAMPLES];
+    filter_hyst_t raw, filtered;
+    struct timespec t0, t1;
+    unsigned long rawFalse = 0, filtFalse = 0;
+    long rawDelay = -1, filtDelay = -1;
+    uint8_t rawOn = 0, filtOn = 0;
+    unsigned long i;
+    int32_t v;
+    double ns;
+
+    for (i = 0; i < RUN_SAMPLES; i++) {
+        values[i] = measurement(i);
+    }
+
+    filter_hystInit(&raw, WARNING, WARNING - HYSTERESIS);
+    filter_hystInit(&filtered, WARNING, WARNING - HYSTERESIS);
+    filter_reset(tempFilter, COUNT(tempFilter));
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < RUN_SAMPLES; i++) {
+        uint8_t on;
+
+        on = filter_hyst(&raw, values[i]);
+        if (on && !rawOn) {
+            if (i >= FIRE_START && i < FIRE_END) {
+                if (rawDelay < 0) {
+                    rawDelay = (long)(i - FIRE_START);
+                }
+            } else {
+                rawFalse++;
+            }
+        }
+        rawOn = on;
+
+        v = values[i];
+        filter_process(tempFilter, COUNT(tempFilter), &v);
+        on = filter_hyst(&filtered, v);
+        if (on && !filtOn) {
+            if (i >= FIRE_START && i < FIRE_END) {
+                if (filtDelay < 0) {
+                    filtDelay = (long)(i - FIRE_START);
+                }
+            } else {
+                filtFalse++;
+            }
+        }
+        filtOn = on;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+
+    printf("%lu measurements, warning at %d.%d C, fire from %lu to %lu\n",
+            RUN_SAMPLES, WARNING / 10, WARNING % 10, FIRE_START, FIRE_END);
+    printf("  raw      %3lu false alarms, fire after %ld measurements\n",
+            rawFalse, rawDelay);
+    printf("  filtered %3lu false alarms, fire after %ld measurements\n",
+            filtFalse, filtDelay);
+    printf("  %.1f ns per measurement (host, both paths)\n",
+            ns / RUN_SAMPLES);
+}
+
+static int replay(const char *name)
+{
+    filter_hyst_t alarm;
+    FILE *f = fopen(name, "r");
+    char line[64];
+    int32_t v;
+    long x;
+
+    if (f == NULL) {
+        perror(name);
+        return EXIT_FAILURE;
+    }
+
+    filter_hystInit(&alarm, WARNING, WARNING - HYSTERESIS);
+    filter_reset(tempFilter, COUNT(tempFilter));
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (sscanf(line, "%ld", &x) != 1) {
+            continue;
+        }
+        v = (int32_t)x;
+        filter_process(tempFilter, COUNT(tempFilter), &v);
+        printf("%ld %ld %u\n", x, (long)v, filter_hyst(&alarm, v));
+    }
+    fclose(f);
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    int ok = 1;
+    uint8_t size;
+
+    if (argc > 1) {
+        return replay(argv[1]);
+    }
+
+    for (size = 1; size <= FILTER_MEDIAN_MAX; size += 2) {
+        ok &= checkMedian(size);
+    }
+    printf("moving median %s\n", ok ? "matches a sorted window" : "differs");
+
+    run();
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,156 @@
+/*****************************************************************************
+ *   fmt_bench.c:  Host benchmark of the fmt library against sprintf
+ *
+ *   Checks fmt_uint, fmt_int and fmt_fixed against snprintf over edge
+ *   cases and random values in widths -14 .. 14, then times the OLED field
+ *   formatting of the firmware against the sprintf calls it replaced
+ *   ("%d    ", "%u    ", "%.2f   " of the temperature / 10.0).
+ *
+ *   The host has an FPU and a fast printf, so the speedup on the
+ *   Cortex-M3 (soft double math, newlib's float printf) is larger.
+ *
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "fmt.h"
+
+#define RUN_VALUES 1000000UL
+
+/* FIELD_WIDTH in main.c */
+#define FIELD_WIDTH 7
+
+static const int32_t edges[] = {
+    0, 1, -1, 9, -9, 10, -10, 99, -99, 245, -245, 1000, -1000,
+    65535, 2147483647, -2147483647 - 1,
+};
+
+static volatile uint32_t sink;
+
+static uint32_t rnd(void)
+{
+    static uint32_t x = 2463534242u;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+static int check(const char *what, int32_t value, int8_t width,
+        const char *got, const char *want)
+{
+    if (strcmp(got, want) == 0) {
+        return 1;
+    }
+    printf("  %s(%ld, %d): \"%s\", expected \"%s\"  <-- MISMATCH\n",
+            what, (long)value, width, got, want);
+    return 0;
+}
+
+static int checkValue(int32_t v)
+{
+    /* any int8_t width */
+    char got[160];
+    char want[160];
+    int ok = 1;
+    int8_t w;
+
+    for (w = -14; w <= 14; w++) {
+        fmt_int(got, v, w);
+        snprintf(want, sizeof(want), "%*ld", w, (long)v);
+        ok &= check("fmt_int", v, w, got, want);
+
+        fmt_uint(got, (uint32_t)v, w);
+        snprintf(want, sizeof(want), "%*lu", w, (unsigned long)(uint32_t)v);
+        ok &= check("fmt_uint", v, w, got, want);
+
+        fmt_fixed(got, v, 1, w);
+        snprintf(want, sizeof(want), "%*.1f", w, v / 10.0);
+        ok &= check("fmt_fixed", v, w, got, want);
+
+        fmt_fixed(got, v, 3, w);
+        snprintf(want, sizeof(want), "%*.3f", w, v / 1000.0);
+        ok &= check("fmt_fixed", v, w, got, want);
+    }
+
+    return ok;
+}
+
+static double elapsedNs(const struct timespec *t0, const struct timespec *t1)
+{
+    return (t1->tv_sec - t0->tv_sec) * 1e9 + (t1->tv_nsec - t0->tv_nsec);
+}
+
+/* one refresh of the main page: light, temperature, three axes */
+static void bench(void)
+{
+    static int32_t values[RUN_VALUES];
+    struct timespec t0, t1;
+    char text[32];
+    double nsPrintf, nsFmt;
+    unsigned long i;
+
+    for (i = 0; i < RUN_VALUES; i++) {
+        values[i] = (int32_t)(rnd() % 1200) - 200;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < RUN_VALUES; i++) {
+        sprintf(text, "%u    ", (uint32_t)(values[i] + 200));
+        sink += text[0];
+        sprintf(text, "%.2f   ", values[i] / 10.0);
+        sink += text[0];
+        sprintf(text, "%d    ", values[i] / 8);
+        sink += text[0];
+        sprintf(text, "%d    ", -values[i] / 8);
+        sink += text[0];
+        sprintf(text, "%d    ", values[i] / 16);
+        sink += text[0];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    nsPrintf = elapsedNs(&t0, &t1) / RUN_VALUES;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < RUN_VALUES; i++) {
+        fmt_uint(text, (uint32_t)(values[i] + 200), -FIELD_WIDTH);
+        sink += text[0];
+        fmt_fixed(text, values[i], 1, -FIELD_WIDTH);
+        sink += text[0];
+        fmt_int(text, values[i] / 8, -FIELD_WIDTH);
+        sink += text[0];
+        fmt_int(text, -values[i] / 8, -FIELD_WIDTH);
+        sink += text[0];
+        fmt_int(text, values[i] / 16, -FIELD_WIDTH);
+        sink += text[0];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    nsFmt = elapsedNs(&t0, &t1) / RUN_VALUES;
+
+    printf("main page refresh (5 fields), %lu runs\n", RUN_VALUES);
+    printf("  sprintf %7.1f ns\n", nsPrintf);
+    printf("  fmt     %7.1f ns (%.1fx)\n", nsFmt, nsPrintf / nsFmt);
+}
+
+int main(void)
+{
+    unsigned long i;
+    int ok = 1;
+
+    for (i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+        ok &= checkValue(edges[i]);
+    }
+    for (i = 0; i < 20000 && ok; i++) {
+        ok &= checkValue((int32_t)rnd());
+        ok &= checkValue((int32_t)(rnd() % 20001) - 10000);
+    }
+    printf("formatting %s\n", ok ? "matches snprintf" : "differs");
+
+    bench();
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
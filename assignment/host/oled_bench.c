@@ -0,0 +1,210 @@
+/*****************************************************************************
+ *   oled_bench.c:  Host benchmark of the OLED glyph renderer
+ *
+ *   Draws big strings at every y position with oled_putBigString and with
+ *   the per-pixel oled_putBigPixel path it replaced, checks that both
+ *   leave the same framebuffer (sizes 1-4) and compares their speed for
+ *   the temperature field of the large display (sizes 2 and 3).
+ *
+ *   Only the framebuffer is drawn (deferred flush mode), the display I/O
+ *   is stubbed out. Built with -Os like the firmware, fails if the glyph
+ *   path is less than MIN_SPEEDUP times faster.
+ *
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "oled.h"
+#include "font5x7.h"
+#include "lpc17xx_gpio.h"
+#include "lpc17xx_ssp.h"
+#include "ssp1.h"
+
+#define RUN_STRINGS 2000UL
+#define RUN_ROUNDS 25
+
+/* at least an order of magnitude faster */
+#define MIN_SPEEDUP 10.0
+
+static const char *texts[] = {
+    "24.5", "-3.0", "45.1C", "100", "0.25", "#%&@",
+};
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static volatile uint32_t sink;
+
+/* the display I/O of the OLED driver is never called */
+void GPIO_SetValue(uint8_t portNum, uint32_t bitValue) { }
+void GPIO_ClearValue(uint8_t portNum, uint32_t bitValue) { }
+int32_t SSP_ReadWrite(LPC_SSP_TypeDef *SSPx,
+        SSP_DATA_SETUP_Type *dataCfg, SSP_TRANSFER_Type xfType)
+{
+    return -1;
+}
+void ssp1_lock(void) { }
+void ssp1_unlock(void) { }
+uint8_t ssp1_isReady(void) { return 0; }
+int ssp1_submit(ssp1_xact_t *xact) { return -1; }
+
+/* oled_putBigChar before the glyph renderer, one oled_putBigPixel per
+   font pixel */
+static uint8_t pixelBigChar(uint8_t x, uint8_t y, uint8_t ch,
+        oled_color_t fb, oled_color_t bg, uint8_t size)
+{
+    static const uint8_t mask[6] = {0x80, 0x40, 0x20, 0x10, 0x08, 0x04};
+    uint8_t i, j;
+
+    if ((x >= (OLED_DISPLAY_WIDTH - 8)) || (y >= (OLED_DISPLAY_HEIGHT - 8))) {
+        return 0;
+    }
+    if ((ch < 0x20) || (ch > 0x7f)) {
+        ch = 0x20;
+    }
+    ch -= 0x20;
+
+    for (i = 0; i < 8; i++) {
+        for (j = 0; j < 6; j++) {
+            oled_putBigPixel(x + j + j*size, y + i + i*size,
+                    (font5x7[ch][i] & mask[j]) ? fb : bg, size);
+        }
+    }
+    return 1;
+}
+
+static void pixelBigString(uint8_t x, uint8_t y, const char *s,
+        oled_color_t fb, oled_color_t bg, uint8_t size)
+{
+    while (*s != '\0' && pixelBigChar(x, y, *s++, fb, bg, size)) {
+        x += 7*size;
+    }
+}
+
+static void glyphBigString(uint8_t x, uint8_t y, const char *s,
+        oled_color_t fb, oled_color_t bg, uint8_t size)
+{
+    oled_putBigString(x, y, (uint8_t *) s, fb, bg, size);
+}
+
+typedef void (*draw_t)(uint8_t x, uint8_t y, const char *s,
+        oled_color_t fb, oled_color_t bg, uint8_t size);
+
+/* every text at every position the glyphs fit the display */
+static void drawAll(draw_t draw, uint8_t size, oled_color_t fb,
+        oled_color_t bg)
+{
+    uint8_t y;
+    unsigned long i;
+
+    for (y = 0; y + 8*(size + 1) <= OLED_DISPLAY_HEIGHT; y++) {
+        for (i = 0; i < COUNT(texts); i++) {
+            draw(y % 5, y, texts[i], fb, bg, size);
+        }
+    }
+}
+
+static int check(uint8_t size)
+{
+    static const oled_color_t colors[][2] = {
+        {OLED_COLOR_WHITE, OLED_COLOR_BLACK},
+        {OLED_COLOR_BLACK, OLED_COLOR_WHITE},
+    };
+    uint8_t want[OLED_FB_SIZE];
+    unsigned long c;
+    uint8_t y;
+    int ok = 1;
+
+    for (c = 0; c < COUNT(colors); c++) {
+        for (y = 0; y + 8*(size + 1) <= OLED_DISPLAY_HEIGHT; y++) {
+            oled_clearScreen(colors[c][1]);
+            pixelBigString(y % 5, y, texts[y % COUNT(texts)],
+                    colors[c][0], colors[c][1], size);
+            memcpy(want, oled_getFramebuffer(), OLED_FB_SIZE);
+
+            oled_clearScreen(colors[c][1]);
+            glyphBigString(y % 5, y, texts[y % COUNT(texts)],
+                    colors[c][0], colors[c][1], size);
+
+            if (memcmp(want, oled_getFramebuffer(), OLED_FB_SIZE) != 0) {
+                printf("  size %u, y %u, \"%s\": framebuffer differs"
+                        "  <-- MISMATCH\n", size, y, texts[y % COUNT(texts)]);
+                ok = 0;
+            }
+        }
+    }
+
+    return ok;
+}
+
+static double elapsedNs(const struct timespec *t0, const struct timespec *t1)
+{
+    return (t1->tv_sec - t0->tv_sec) * 1e9 + (t1->tv_nsec - t0->tv_nsec);
+}
+
+static double timeDraw(draw_t draw, uint8_t size)
+{
+    struct timespec t0, t1;
+    unsigned long n = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    while (n < RUN_STRINGS) {
+        drawAll(draw, size, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
+        n += COUNT(texts) * (OLED_DISPLAY_HEIGHT - 8*(size + 1) + 1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    sink += oled_getFramebuffer()[0];
+
+    return elapsedNs(&t0, &t1) / n;
+}
+
+/* the rounds of both paths alternate and the fastest of each counts, the
+   host's timing noise is larger than the glyph path */
+static int bench(uint8_t size)
+{
+    double nsPixel = 0, nsGlyph = 0, ns;
+    int round;
+
+    for (round = 0; round < RUN_ROUNDS; round++) {
+        ns = timeDraw(pixelBigString, size);
+        if (round == 0 || ns < nsPixel) {
+            nsPixel = ns;
+        }
+        ns = timeDraw(glyphBigString, size);
+        if (round == 0 || ns < nsGlyph) {
+            nsGlyph = ns;
+        }
+    }
+
+    printf("size %u, best of %d rounds of %lu strings\n", size, RUN_ROUNDS,
+            RUN_STRINGS);
+    printf("  putBigPixel %8.1f ns\n", nsPixel);
+    printf("  glyph       %8.1f ns (%.1fx)\n", nsGlyph, nsPixel / nsGlyph);
+
+    if (nsPixel / nsGlyph < MIN_SPEEDUP) {
+        printf("  speedup below %.0fx  <-- TOO SLOW\n", MIN_SPEEDUP);
+        return 0;
+    }
+    return 1;
+}
+
+int main(void)
+{
+    uint8_t size;
+    int ok = 1;
+
+    oled_setFlushMode(OLED_FLUSH_DEFERRED);
+
+    for (size = 1; size <= 4; size++) {
+        ok &= check(size);
+    }
+    printf("glyphs %s\n", ok ? "match the per-pixel path" : "differ");
+
+    ok &= bench(2);
+    ok &= bench(3);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,95 @@
+/*****************************************************************************
+ *   sched_bench.c:  Host benchmark of the scheduler
+ *
+ *   Runs the monitor mode task set (1 s, 333 ms and 100 ms periodic tasks)
+ *   plus a burst of simulated button interrupts for one simulated hour and
+ *   reports the dispatch cost, the idle ratio and the run counts.
+ *
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "sched.h"
+#include "sched_host.h"
+
+#define RUN_MS (60UL * 60UL * 1000UL)
+
+/* simulated button press every 250 ms */
+#define EVENT_INTERVAL_MS 250
+
+static sched_task_t secondTask;
+static sched_task_t blinkTask;
+static sched_task_t sampleTask;
+static sched_task_t eventTask;
+
+static uint32_t runs[4];
+
+static void count_task(void *arg)
+{
+    runs[(size_t)arg]++;
+}
+
+static uint8_t raise_events(uint32_t now)
+{
+    if (now % EVENT_INTERVAL_MS == 0) {
+        sched_post(&eventTask);
+        return 1;
+    }
+    return 0;
+}
+
+static int check(const char *name, uint32_t got, uint32_t expected)
+{
+    int ok = got + 1 >= expected && got <= expected + 1;
+
+    printf("  %-8s %8lu runs (expected %lu)%s\n", name, (unsigned long)got,
+            (unsigned long)expected, ok ? "" : "  <-- MISMATCH");
+
+    return ok;
+}
+
+int main(void)
+{
+    struct timespec t0, t1;
+    uint32_t dispatches = 0;
+    uint32_t ran = 0;
+    double ns;
+    int ok = 1;
+
+    sched_init();
+    sched_addTask(&secondTask, count_task, (void *)0);
+    sched_addTask(&blinkTask, count_task, (void *)1);
+    sched_addTask(&sampleTask, count_task, (void *)2);
+    sched_addTask(&eventTask, count_task, (void *)3);
+    sched_host_setSleepHook(raise_events);
+
+    sched_start(&secondTask, 1000, 1000);
+    sched_start(&blinkTask, 333, 333);
+    sched_start(&sampleTask, 100, 100);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    while (sched_now() < RUN_MS) {
+        ran += sched_dispatch();
+        dispatches++;
+        sched_idle();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+
+    printf("simulated %lu ms\n", (unsigned long)RUN_MS);
+    printf("  %lu dispatch passes, %lu task runs, %lu sleeps\n",
+            (unsigned long)dispatches, (unsigned long)ran,
+            (unsigned long)sched_host_sleeps());
+    printf("  idle %.2f%%\n", 100.0 * sched_host_sleptMs() / RUN_MS);
+    printf("  %.1f ns per dispatch pass (host)\n", ns / dispatches);
+
+    ok &= check("1s", runs[0], RUN_MS / 1000);
+    ok &= check("333ms", runs[1], RUN_MS / 333);
+    ok &= check("100ms", runs[2], RUN_MS / 100);
+    ok &= check("events", runs[3], RUN_MS / EVENT_INTERVAL_MS);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
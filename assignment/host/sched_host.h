@@ -0,0 +1,25 @@
+/*****************************************************************************
+ *   sched_host.h:  Host port of the scheduler (simulated time)
+ *
+******************************************************************************/
+#ifndef __SCHED_HOST_H
+#define __SCHED_HOST_H
+
+#include <stdint.h>
+
+/*
+ * Called for every simulated ms of sleep, stands in for interrupts.
+ * Returns non-zero if an interrupt was raised, which ends the sleep.
+ */
+typedef uint8_t (*sched_host_hook_t)(uint32_t now);
+
+void sched_host_advance(uint32_t ms);
+void sched_host_setSleepHook(sched_host_hook_t hook);
+uint32_t sched_host_sleptMs(void);
+uint32_t sched_host_sleeps(void);
+
+
+#endif /* end __SCHED_HOST_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
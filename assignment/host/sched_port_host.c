@@ -0,0 +1,89 @@
+/*****************************************************************************
+ *   sched_port_host.c:  Scheduler port for host builds
+ *
+******************************************************************************/
+
+/*
+ * Time is simulated: it only moves when the scheduler sleeps or when
+ * sched_host_advance is called, so runs are fast and repeatable. A sleep
+ * hook stands in for interrupts; when it reports one the sleep ends, as
+ * WFI would on real hardware.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stddef.h>
+#include "sched.h"
+#include "sched_host.h"
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static uint32_t now = 0;
+static uint32_t slept = 0;
+static uint32_t sleeps = 0;
+static sched_host_hook_t hook = NULL;
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+void sched_port_init(void)
+{
+    now = 0;
+    slept = 0;
+    sleeps = 0;
+}
+
+uint32_t sched_port_now(void)
+{
+    return now;
+}
+
+/* wakes up at the timeout, or one ms in if the hook raised an event */
+void sched_port_sleep(uint32_t timeout)
+{
+    uint32_t ms;
+
+    sleeps++;
+
+    for (ms = 0; ms < timeout; ms++) {
+        now++;
+        slept++;
+        if (hook != NULL && hook(now)) {
+            break;
+        }
+    }
+}
+
+uint32_t sched_port_lock(void)
+{
+    return 0;
+}
+
+void sched_port_unlock(uint32_t key)
+{
+}
+
+void sched_host_advance(uint32_t ms)
+{
+    now += ms;
+}
+
+void sched_host_setSleepHook(sched_host_hook_t h)
+{
+    hook = h;
+}
+
+uint32_t sched_host_sleptMs(void)
+{
+    return slept;
+}
+
+uint32_t sched_host_sleeps(void)
+{
+    return sleeps;
+}
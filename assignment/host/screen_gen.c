@@ -0,0 +1,108 @@
+/*****************************************************************************
+ *   screen_gen.c:  Renders the static OLED screens into C arrays
+ *
+ *   Draws every layout of screenLayouts (screens.c) with the firmware's
+ *   own ui and OLED code into the framebuffer and writes the images as
+ *   screenImages, in the display's page format.
+ *
+ *     screen_gen [file]    (default: stdout)
+ *
+ *   The build runs it through the 'screens' target, which rewrites
+ *   assignment/src/screens_img.c.
+ *
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "oled.h"
+#include "ui.h"
+#include "screens.h"
+#include "lpc17xx_gpio.h"
+#include "lpc17xx_ssp.h"
+#include "ssp1.h"
+
+#define BYTES_PER_LINE 12
+
+static const char *names[NUM_PAGES] = {
+    [PAGE_MAIN] = "PAGE_MAIN",
+    [PAGE_TEMP] = "PAGE_TEMP",
+    [PAGE_LIGHT] = "PAGE_LIGHT",
+    [PAGE_ACCX] = "PAGE_ACCX",
+    [PAGE_ACCY] = "PAGE_ACCY",
+    [PAGE_ACCZ] = "PAGE_ACCZ",
+    [PAGE_FUNC] = "PAGE_FUNC",
+};
+
+/*
+ * Deferred drawing only touches the framebuffer, the display I/O of the
+ * OLED driver is never called.
+ */
+void GPIO_SetValue(uint8_t portNum, uint32_t bitValue) { }
+void GPIO_ClearValue(uint8_t portNum, uint32_t bitValue) { }
+int32_t SSP_ReadWrite(LPC_SSP_TypeDef *SSPx,
+        SSP_DATA_SETUP_Type *dataCfg, SSP_TRANSFER_Type xfType)
+{
+    return -1;
+}
+void ssp1_lock(void) { }
+void ssp1_unlock(void) { }
+uint8_t ssp1_isReady(void) { return 0; }
+int ssp1_submit(ssp1_xact_t *xact) { return -1; }
+
+static void printImage(FILE *out, uint8_t page, const uint8_t *fb)
+{
+    int i;
+
+    fprintf(out, "    [%s] = {", names[page]);
+    for (i = 0; i < OLED_FB_SIZE; i++) {
+        if (i % BYTES_PER_LINE == 0) {
+            fprintf(out, "\n       ");
+        }
+        fprintf(out, " 0x%02x,", fb[i]);
+    }
+    fprintf(out, "\n    },\n");
+}
+
+int main(int argc, char **argv)
+{
+    FILE *out = stdout;
+    uint8_t page;
+
+    if (argc > 1) {
+        out = fopen(argv[1], "w");
+        if (out == NULL) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    oled_setFlushMode(OLED_FLUSH_DEFERRED);
+
+    fprintf(out,
+        "/*****************************************************************************\n"
+        " *   screens_img.c:  Pre-rendered OLED screens\n"
+        " *\n"
+        " *   Generated by assignment/host/screen_gen from screens.c, do not edit.\n"
+        " *   Regenerate with: cmake --build build-host --target screens\n"
+        " *\n"
+        "******************************************************************************/\n"
+        "\n"
+        "#include \"screens.h\"\n"
+        "\n"
+        "const uint8_t screenImages[NUM_PAGES][OLED_FB_SIZE] = {\n");
+
+    for (page = 0; page < NUM_PAGES; page++) {
+        ui_drawLayout(&screenLayouts[page]);
+        printImage(out, page, oled_getFramebuffer());
+    }
+
+    fprintf(out, "};\n");
+
+    if (out != stdout && fclose(out) != 0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
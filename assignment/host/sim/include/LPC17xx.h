@@ -0,0 +1,91 @@
+/*****************************************************************************
+ *   LPC17xx.h:  Host simulation wrapper around the CMSIS device header
+ *
+ *   The real LPC17xx.h/core_cm3.h are used for all register definitions.
+ *   Peripheral address ranges are mapped into the process by the
+ *   simulator, so register accesses work as plain memory. The core
+ *   functions that need to reach the simulator (NVIC, interrupt masking,
+ *   exclusive access, WFI, SysTick) or that contain ARM assembly are
+ *   renamed out of the way and provided by sim_core.c instead.
+ *
+******************************************************************************/
+#ifndef __SIM_LPC17XX_H
+#define __SIM_LPC17XX_H
+
+#include <stdint.h>
+
+#define NVIC_EnableIRQ          __cm3_NVIC_EnableIRQ
+#define NVIC_DisableIRQ         __cm3_NVIC_DisableIRQ
+#define NVIC_GetPendingIRQ      __cm3_NVIC_GetPendingIRQ
+#define NVIC_SetPendingIRQ      __cm3_NVIC_SetPendingIRQ
+#define NVIC_ClearPendingIRQ    __cm3_NVIC_ClearPendingIRQ
+#define NVIC_GetActive          __cm3_NVIC_GetActive
+#define NVIC_SetPriority        __cm3_NVIC_SetPriority
+#define NVIC_GetPriority        __cm3_NVIC_GetPriority
+#define NVIC_SystemReset        __cm3_NVIC_SystemReset
+#define SysTick_Config          __cm3_SysTick_Config
+#define ITM_SendChar            __cm3_ITM_SendChar
+#define __enable_irq            __cm3_enable_irq
+#define __disable_irq           __cm3_disable_irq
+#define __enable_fault_irq      __cm3_enable_fault_irq
+#define __disable_fault_irq     __cm3_disable_fault_irq
+#define __NOP                   __cm3_NOP
+#define __WFI                   __cm3_WFI
+#define __WFE                   __cm3_WFE
+#define __SEV                   __cm3_SEV
+#define __ISB                   __cm3_ISB
+#define __DSB                   __cm3_DSB
+#define __DMB                   __cm3_DMB
+#define __CLREX                 __cm3_CLREX
+
+#include_next "LPC17xx.h"
+
+#undef NVIC_EnableIRQ
+#undef NVIC_DisableIRQ
+#undef NVIC_GetPendingIRQ
+#undef NVIC_SetPendingIRQ
+#undef NVIC_ClearPendingIRQ
+#undef NVIC_GetActive
+#undef NVIC_SetPriority
+#undef NVIC_GetPriority
+#undef NVIC_SystemReset
+#undef SysTick_Config
+#undef ITM_SendChar
+#undef __enable_irq
+#undef __disable_irq
+#undef __enable_fault_irq
+#undef __disable_fault_irq
+#undef __NOP
+#undef __WFI
+#undef __WFE
+#undef __SEV
+#undef __ISB
+#undef __DSB
+#undef __DMB
+#undef __CLREX
+
+void NVIC_EnableIRQ(IRQn_Type IRQn);
+void NVIC_DisableIRQ(IRQn_Type IRQn);
+uint32_t NVIC_GetPendingIRQ(IRQn_Type IRQn);
+void NVIC_SetPendingIRQ(IRQn_Type IRQn);
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+uint32_t NVIC_GetActive(IRQn_Type IRQn);
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority);
+uint32_t NVIC_GetPriority(IRQn_Type IRQn);
+void NVIC_SystemReset(void);
+uint32_t SysTick_Config(uint32_t ticks);
+uint32_t ITM_SendChar(uint32_t ch);
+void __enable_irq(void);
+void __disable_irq(void);
+void __enable_fault_irq(void);
+void __disable_fault_irq(void);
+void __NOP(void);
+void __WFI(void);
+void __WFE(void);
+void __SEV(void);
+void __ISB(void);
+void __DSB(void);
+void __DMB(void);
+void __CLREX(void);
+
+#endif /* __SIM_LPC17XX_H */
@@ -0,0 +1,171 @@
+/*****************************************************************************
+ *   sim.h:  Host simulation of the LPC1769 base board
+ *
+******************************************************************************/
+
+/*
+ * The firmware (main.c, the base board drivers and the scheduler) is
+ * compiled unchanged for the host. Register accesses hit peripheral memory
+ * mapped at the real addresses; the Lib_MCU drivers with side effects
+ * (GPIO, SSP, GPDMA, I2C, UART) are replaced by sim_mcu.c, which forwards
+ * to the device models.
+ *
+ * Time is simulated in microseconds. It advances while the firmware
+ * sleeps (sched_port_sleep / WFI) and while a bus transfer is in
+ * progress. Interrupts are delivered as soon as they are raised, unless
+ * masked or another handler is running; handlers don't nest.
+ */
+#ifndef __SIM_H
+#define __SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "LPC17xx.h"
+
+/******************************************************************************
+ * Time and events
+ *****************************************************************************/
+
+typedef struct sim_event
+{
+    uint64_t time;                      /* us */
+    void (*fire)(struct sim_event *ev);
+    void *arg;
+
+    uint8_t queued;
+    struct sim_event *next;
+} sim_event_t;
+
+uint64_t sim_now(void);
+void sim_schedule(sim_event_t *ev, uint64_t time);
+void sim_cancel(sim_event_t *ev);
+void sim_busy(uint32_t us);
+void sim_sleep(uint64_t us);
+
+/******************************************************************************
+ * Interrupts
+ *****************************************************************************/
+
+void sim_irqRaise(IRQn_Type irq);
+void sim_irqDispatch(void);
+uint8_t sim_irqMasked(void);
+
+/******************************************************************************
+ * GPIO
+ *****************************************************************************/
+
+typedef void (*sim_gpio_listener_t)(uint8_t port, uint32_t oldPins,
+        uint32_t newPins);
+
+void sim_gpioInit(void);
+void sim_gpioListen(sim_gpio_listener_t listener);
+void sim_gpioOutput(uint8_t port, uint32_t setMask, uint32_t clrMask);
+void sim_gpioInput(uint8_t port, uint8_t pin, uint8_t level);
+uint8_t sim_gpioGet(uint8_t port, uint8_t pin);
+void sim_gpioIntSync(void);
+uint8_t sim_gpioIntPending(void);
+
+/******************************************************************************
+ * Buses and devices
+ *****************************************************************************/
+
+/* SPI device, selected by an active low chip select */
+typedef struct sim_spi_dev
+{
+    const char *name;
+    uint8_t csPort;
+    uint8_t csPin;
+
+    uint8_t (*exchange)(struct sim_spi_dev *dev, uint8_t tx);
+    void (*select)(struct sim_spi_dev *dev, uint8_t selected);
+
+    struct sim_spi_dev *next;
+} sim_spi_dev_t;
+
+/* I2C device. Returns 0 on ACK, -1 on NACK. */
+typedef struct sim_i2c_dev
+{
+    const char *name;
+    uint8_t addr;
+    uint8_t addrMask;   /* address bits ignored when matching */
+
+    int (*transfer)(struct sim_i2c_dev *dev, uint8_t addr,
+            const uint8_t *tx, uint32_t txLen, uint8_t *rx, uint32_t rxLen);
+
+    uint32_t transfers;
+    struct sim_i2c_dev *next;
+} sim_i2c_dev_t;
+
+void sim_spiAttach(sim_spi_dev_t *dev);
+uint8_t sim_spiExchange(uint8_t tx);
+void sim_i2cAttach(sim_i2c_dev_t *dev);
+int sim_i2cTransfer(uint8_t addr, const uint8_t *tx, uint32_t txLen,
+        uint8_t *rx, uint32_t rxLen);
+uint32_t sim_i2cDuration(uint32_t txLen, uint32_t rxLen);
+uint32_t sim_sspDuration(uint32_t len);
+void sim_uartOut(uint8_t uart, uint8_t byte);
+
+/******************************************************************************
+ * Device models
+ *****************************************************************************/
+
+void sim_oledInit(void);
+void sim_oledDump(FILE *f);
+void sim_led7segInit(void);
+void sim_flashInit(void);
+void sim_flashImage(const char *path);
+void sim_flashSave(void);
+uint32_t sim_flashPrograms(void);
+void sim_mma7455Init(void);
+void sim_mma7455Set(double x, double y, double z);
+uint8_t sim_mma7455Sampling(void);
+void sim_isl29003Init(void);
+void sim_isl29003Set(uint32_t lux);
+void sim_pca9532Init(void);
+void sim_eepromInit(void);
+void sim_eepromImage(const char *path);
+void sim_eepromSave(void);
+uint32_t sim_eepromWrites(void);
+void sim_sc16is752Init(void);
+void sim_max6576Init(void);
+void sim_max6576Set(double celsius);
+
+void sim_inputButton(uint8_t sw);
+void sim_inputJoystick(const char *dir);
+void sim_inputRotary(int8_t steps, uint32_t stepMs);
+
+int sim_traceOpen(const char *path);
+uint32_t sim_traceFailures(void);
+
+/******************************************************************************
+ * Statistics
+ *****************************************************************************/
+
+typedef struct
+{
+    uint64_t sleepUs;
+    uint32_t wakeups;
+    uint64_t awakeNs;       /* host CPU time between sleeps */
+    uint64_t maxAwakeNs;
+
+    uint32_t irqCount[64];
+    uint64_t irqNs[64];
+
+    uint32_t i2cTransfers;
+    uint32_t i2cBytes;
+    uint32_t i2cNacks;
+    uint64_t i2cBusyUs;
+
+    uint32_t sspTransfers;
+    uint32_t sspBytes;
+    uint64_t sspBusyUs;
+
+    uint32_t uartBytes[4];
+} sim_stats_t;
+
+extern sim_stats_t sim_stats;
+
+void sim_report(FILE *f);
+void sim_finish(void);
+
+#endif /* __SIM_H */
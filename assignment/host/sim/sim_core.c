@@ -0,0 +1,671 @@
+/*****************************************************************************
+ *   sim_core.c:  Simulated time, interrupts and core peripherals
+ *
+******************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "sim.h"
+#include "prof.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+/* vector number = IRQn + 16, covers the core exceptions as well */
+#define VEC(irq) ((int)(irq) + 16)
+#define NUM_VECTORS 51
+
+/* give up on an interrupt source that is never cleared by its handler */
+#define MAX_REDELIVERIES 1000
+
+int firmware_main(void);
+
+sim_stats_t sim_stats;
+
+uint32_t SystemCoreClock = 100000000;
+
+/******************************************************************************
+ * Peripheral memory
+ *****************************************************************************/
+
+static const struct
+{
+    uintptr_t base;
+    size_t size;
+} regions[] = {
+    { 0x2009C000, 0x00004000 },     /* GPIO */
+    { 0x40000000, 0x00100000 },     /* APB0, APB1 */
+    { 0x50000000, 0x00200000 },     /* AHB */
+    { 0xE0000000, 0x00100000 },     /* private peripheral bus */
+};
+
+static void mapRegions(void)
+{
+    size_t i;
+    void *p;
+
+    for (i = 0; i < sizeof(regions) / sizeof(regions[0]); i++) {
+        p = mmap((void *)regions[i].base, regions[i].size,
+                PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+        if (p != (void *)regions[i].base) {
+            fprintf(stderr, "sim: cannot map peripheral memory at 0x%08lx\n",
+                    (unsigned long)regions[i].base);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/******************************************************************************
+ * Time and events
+ *****************************************************************************/
+
+static uint64_t now = 0;
+static uint64_t endTime = 60000000;
+static sim_event_t *events = NULL;
+static uint32_t advancing = 0;
+
+static uint64_t cpuNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+uint64_t sim_now(void)
+{
+    return now;
+}
+
+void sim_schedule(sim_event_t *ev, uint64_t time)
+{
+    sim_event_t **p = &events;
+
+    sim_cancel(ev);
+
+    ev->time = time;
+    while (*p != NULL && (*p)->time <= time) {
+        p = &(*p)->next;
+    }
+    ev->next = *p;
+    *p = ev;
+    ev->queued = 1;
+}
+
+void sim_cancel(sim_event_t *ev)
+{
+    sim_event_t **p = &events;
+
+    if (!ev->queued) {
+        return;
+    }
+    while (*p != NULL && *p != ev) {
+        p = &(*p)->next;
+    }
+    if (*p == ev) {
+        *p = ev->next;
+    }
+    ev->queued = 0;
+}
+
+static void checkEnd(void)
+{
+    if (now >= endTime) {
+        sim_finish();
+    }
+}
+
+/* fire the next event if it is due at or before 'target' */
+static uint8_t fireNext(uint64_t target)
+{
+    sim_event_t *ev = events;
+
+    if (ev == NULL || ev->time > target) {
+        return 0;
+    }
+
+    events = ev->next;
+    ev->queued = 0;
+    if (ev->time > now) {
+        now = ev->time;
+        checkEnd();
+    }
+    ev->fire(ev);
+
+    return 1;
+}
+
+static void advanceTo(uint64_t target)
+{
+    advancing++;
+    while (fireNext(target));
+    if (target > now) {
+        now = target;
+    }
+    advancing--;
+    checkEnd();
+}
+
+/******************************************************************************
+ * Interrupts
+ *****************************************************************************/
+
+static uint64_t enabled = 0;
+static uint64_t pending = 0;
+static uint8_t primask = 0;
+static int active = -1;
+
+/* handlers the firmware doesn't define do nothing */
+static void defaultHandler(void)
+{
+}
+
+#define HANDLER(name) \
+    void name(void) __attribute__((weak, alias("defaultHandler")));
+
+HANDLER(SysTick_Handler)
+HANDLER(WDT_IRQHandler)
+HANDLER(TIMER0_IRQHandler)
+HANDLER(TIMER1_IRQHandler)
+HANDLER(TIMER2_IRQHandler)
+HANDLER(TIMER3_IRQHandler)
+HANDLER(UART0_IRQHandler)
+HANDLER(UART1_IRQHandler)
+HANDLER(UART2_IRQHandler)
+HANDLER(UART3_IRQHandler)
+HANDLER(PWM1_IRQHandler)
+HANDLER(I2C0_IRQHandler)
+HANDLER(I2C1_IRQHandler)
+HANDLER(I2C2_IRQHandler)
+HANDLER(SPI_IRQHandler)
+HANDLER(SSP0_IRQHandler)
+HANDLER(SSP1_IRQHandler)
+HANDLER(PLL0_IRQHandler)
+HANDLER(RTC_IRQHandler)
+HANDLER(EINT0_IRQHandler)
+HANDLER(EINT1_IRQHandler)
+HANDLER(EINT2_IRQHandler)
+HANDLER(EINT3_IRQHandler)
+HANDLER(ADC_IRQHandler)
+HANDLER(BOD_IRQHandler)
+HANDLER(USB_IRQHandler)
+HANDLER(CAN_IRQHandler)
+HANDLER(DMA_IRQHandler)
+HANDLER(I2S_IRQHandler)
+HANDLER(ENET_IRQHandler)
+HANDLER(RIT_IRQHandler)
+HANDLER(MCPWM_IRQHandler)
+HANDLER(QEI_IRQHandler)
+HANDLER(PLL1_IRQHandler)
+HANDLER(USBActivity_IRQHandler)
+HANDLER(CANActivity_IRQHandler)
+
+static void (* const vectors[NUM_VECTORS])(void) = {
+    [VEC(SysTick_IRQn)] = SysTick_Handler,
+    WDT_IRQHandler, TIMER0_IRQHandler, TIMER1_IRQHandler,
+    TIMER2_IRQHandler, TIMER3_IRQHandler, UART0_IRQHandler,
+    UART1_IRQHandler, UART2_IRQHandler, UART3_IRQHandler,
+    PWM1_IRQHandler, I2C0_IRQHandler, I2C1_IRQHandler, I2C2_IRQHandler,
+    SPI_IRQHandler, SSP0_IRQHandler, SSP1_IRQHandler, PLL0_IRQHandler,
+    RTC_IRQHandler, EINT0_IRQHandler, EINT1_IRQHandler, EINT2_IRQHandler,
+    EINT3_IRQHandler, ADC_IRQHandler, BOD_IRQHandler, USB_IRQHandler,
+    CAN_IRQHandler, DMA_IRQHandler, I2S_IRQHandler, ENET_IRQHandler,
+    RIT_IRQHandler, MCPWM_IRQHandler, QEI_IRQHandler, PLL1_IRQHandler,
+    USBActivity_IRQHandler, CANActivity_IRQHandler,
+};
+
+static void refreshTimers(void);
+
+static uint8_t deliverable(void)
+{
+    return (pending & enabled) != 0;
+}
+
+void sim_irqRaise(IRQn_Type irq)
+{
+    pending |= 1ULL << VEC(irq);
+    sim_irqDispatch();
+}
+
+uint8_t sim_irqMasked(void)
+{
+    return primask || active >= 0 || advancing;
+}
+
+void sim_irqDispatch(void)
+{
+    uint64_t t0;
+    uint32_t redeliveries = 0;
+    int vec;
+
+    if (sim_irqMasked()) {
+        return;
+    }
+
+    while (deliverable()) {
+        vec = __builtin_ctzll(pending & enabled);
+        pending &= ~(1ULL << vec);
+
+        refreshTimers();
+
+        active = vec;
+        t0 = cpuNs();
+        if (vectors[vec] != NULL) {
+            vectors[vec]();
+        }
+        sim_stats.irqNs[vec] += cpuNs() - t0;
+        sim_stats.irqCount[vec]++;
+        active = -1;
+
+        /* apply write-1-to-clear registers, re-raise level sources */
+        sim_gpioIntSync();
+        if (sim_gpioIntPending()) {
+            if (++redeliveries > MAX_REDELIVERIES) {
+                fprintf(stderr, "sim: GPIO interrupt never cleared\n");
+                exit(EXIT_FAILURE);
+            }
+            pending |= 1ULL << VEC(EINT3_IRQn);
+        }
+    }
+}
+
+void NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+    enabled |= 1ULL << VEC(IRQn);
+    sim_irqDispatch();
+}
+
+void NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+    enabled &= ~(1ULL << VEC(IRQn));
+}
+
+uint32_t NVIC_GetPendingIRQ(IRQn_Type IRQn)
+{
+    return (pending >> VEC(IRQn)) & 1;
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type IRQn)
+{
+    sim_irqRaise(IRQn);
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn)
+{
+    pending &= ~(1ULL << VEC(IRQn));
+}
+
+uint32_t NVIC_GetActive(IRQn_Type IRQn)
+{
+    return active == VEC(IRQn);
+}
+
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority)
+{
+}
+
+uint32_t NVIC_GetPriority(IRQn_Type IRQn)
+{
+    return 0;
+}
+
+void NVIC_SystemReset(void)
+{
+    fprintf(stderr, "sim: system reset requested\n");
+    sim_finish();
+}
+
+void __enable_irq(void)
+{
+    primask = 0;
+    sim_irqDispatch();
+}
+
+void __disable_irq(void)
+{
+    primask = 1;
+}
+
+uint32_t __get_PRIMASK(void)
+{
+    return primask;
+}
+
+void __set_PRIMASK(uint32_t priMask)
+{
+    primask = priMask & 1;
+    sim_irqDispatch();
+}
+
+void __enable_fault_irq(void) {}
+void __disable_fault_irq(void) {}
+void __NOP(void) {}
+void __WFE(void) {}
+void __SEV(void) {}
+void __ISB(void) {}
+void __DSB(void) {}
+void __DMB(void) {}
+
+/*
+ * Handlers only run when thread code calls into the simulator, so
+ * exclusive accesses always succeed. They take a microsecond, which lets
+ * code spinning on a lock see the owner's transfer complete.
+ */
+uint32_t __LDREXW(uint32_t *addr)
+{
+    sim_busy(1);
+    return *addr;
+}
+
+uint32_t __STREXW(uint32_t value, uint32_t *addr)
+{
+    *addr = value;
+    return 0;
+}
+
+void __CLREX(void)
+{
+}
+
+/******************************************************************************
+ * Sleeping
+ *****************************************************************************/
+
+static uint64_t awakeSince = 0;
+
+void sim_sleep(uint64_t us)
+{
+    uint64_t start = now;
+    uint64_t target = now + us;
+    uint64_t t = cpuNs();
+    uint64_t awake = t - awakeSince;
+
+    sim_stats.awakeNs += awake;
+    if (awake > sim_stats.maxAwakeNs) {
+        sim_stats.maxAwakeNs = awake;
+    }
+    sim_stats.wakeups++;
+
+    /* like WFI: an enabled pending interrupt wakes up even if masked */
+    advancing++;
+    while (!deliverable() && fireNext(target));
+    if (!deliverable() && target > now) {
+        now = target;
+    }
+    sim_stats.sleepUs += now - start;
+    advancing--;
+    checkEnd();
+
+    awakeSince = cpuNs();
+    sim_irqDispatch();
+}
+
+void __WFI(void)
+{
+    sim_sleep(endTime - now);
+}
+
+/* a bus transfer keeps the caller busy for 'us' */
+void sim_busy(uint32_t us)
+{
+    advanceTo(now + us);
+    sim_irqDispatch();
+}
+
+/******************************************************************************
+ * Timers and SysTick
+ *****************************************************************************/
+
+static LPC_TIM_TypeDef * const timers[] = {
+    LPC_TIM0, LPC_TIM1, LPC_TIM2, LPC_TIM3
+};
+static uint64_t timerBase[4];
+static uint32_t timerTcBase[4];
+static uint8_t timerRunning[4];
+
+/*
+ * Timer counters are derived from the simulated time whenever the
+ * firmware may look at them. Match interrupts are not modelled.
+ */
+static void refreshTimers(void)
+{
+    uint32_t i;
+    uint64_t ticks;
+    uint32_t pclk = SystemCoreClock / 4;
+
+    for (i = 0; i < 4; i++) {
+        if (!(timers[i]->TCR & 1) || (timers[i]->TCR & 2)) {
+            timerRunning[i] = 0;
+            continue;
+        }
+        if (!timerRunning[i]) {
+            timerRunning[i] = 1;
+            timerBase[i] = now;
+            timerTcBase[i] = timers[i]->TC;
+        }
+        ticks = (now - timerBase[i]) * (pclk / 1000000)
+                / (timers[i]->PR + 1);
+        timers[i]->TC = timerTcBase[i] + (uint32_t)ticks;
+    }
+}
+
+static sim_event_t sysTickEvent;
+static uint32_t sysTickUs = 0;
+
+static void sysTickFire(sim_event_t *ev)
+{
+    sim_irqRaise(SysTick_IRQn);
+    sim_schedule(ev, now + sysTickUs);
+}
+
+uint32_t SysTick_Config(uint32_t ticks)
+{
+    sysTickUs = (uint32_t)((uint64_t)ticks * 1000000 / SystemCoreClock);
+    if (sysTickUs == 0) {
+        return 1;
+    }
+
+    enabled |= 1ULL << VEC(SysTick_IRQn);
+    sysTickEvent.fire = sysTickFire;
+    sim_schedule(&sysTickEvent, now + sysTickUs);
+
+    return 0;
+}
+
+uint32_t ITM_SendChar(uint32_t ch)
+{
+    fputc((int)ch, stderr);
+    return ch;
+}
+
+/* parameter check of the Lib_MCU drivers (DEBUG build) */
+void check_failed(uint8_t *file, uint32_t line)
+{
+    fprintf(stderr, "sim: driver parameter check failed at %s:%u\n",
+            (char *)file, line);
+    exit(EXIT_FAILURE);
+}
+
+/******************************************************************************
+ * Report
+ *****************************************************************************/
+
+static const char * const vectorNames[NUM_VECTORS] = {
+    [VEC(SysTick_IRQn)] = "SysTick",
+    [VEC(TIMER0_IRQn)] = "TIMER0", [VEC(TIMER1_IRQn)] = "TIMER1",
+    [VEC(TIMER2_IRQn)] = "TIMER2", [VEC(TIMER3_IRQn)] = "TIMER3",
+    [VEC(UART0_IRQn)] = "UART0", [VEC(UART1_IRQn)] = "UART1",
+    [VEC(UART2_IRQn)] = "UART2", [VEC(UART3_IRQn)] = "UART3",
+    [VEC(I2C0_IRQn)] = "I2C0", [VEC(I2C1_IRQn)] = "I2C1",
+    [VEC(I2C2_IRQn)] = "I2C2", [VEC(SSP0_IRQn)] = "SSP0",
+    [VEC(SSP1_IRQn)] = "SSP1", [VEC(EINT0_IRQn)] = "EINT0",
+    [VEC(EINT1_IRQn)] = "EINT1", [VEC(EINT2_IRQn)] = "EINT2",
+    [VEC(EINT3_IRQn)] = "EINT3", [VEC(DMA_IRQn)] = "DMA",
+    [VEC(RIT_IRQn)] = "RIT",
+};
+
+static FILE *oledOut = NULL;
+static uint8_t quiet = 0;
+
+void sim_report(FILE *f)
+{
+    int i;
+    double secs = now / 1e6;
+    char line[PROF_LINE_LEN];
+    int n;
+
+    fprintf(f, "\n=== simulated %.3f s ===\n", secs);
+    fprintf(f, "sleep        %6.2f %% of the time, %lu wake-ups\n",
+            secs > 0 ? 100.0 * sim_stats.sleepUs / now : 0.0,
+            (unsigned long)sim_stats.wakeups);
+    fprintf(f, "host CPU     %.3f ms awake, %.1f us per wake-up, %.1f us max\n",
+            sim_stats.awakeNs / 1e6,
+            sim_stats.wakeups ? sim_stats.awakeNs / 1e3 / sim_stats.wakeups : 0.0,
+            sim_stats.maxAwakeNs / 1e3);
+
+    fprintf(f, "interrupts\n");
+    for (i = 0; i < NUM_VECTORS; i++) {
+        if (sim_stats.irqCount[i] == 0) {
+            continue;
+        }
+        fprintf(f, "  %-8s %8lu  %.1f us avg host CPU\n",
+                vectorNames[i] ? vectorNames[i] : "?",
+                (unsigned long)sim_stats.irqCount[i],
+                sim_stats.irqNs[i] / 1e3 / sim_stats.irqCount[i]);
+    }
+
+    fprintf(f, "I2C2         %lu transfers, %lu bytes, %lu NACKs, "
+            "busy %.2f %%\n",
+            (unsigned long)sim_stats.i2cTransfers,
+            (unsigned long)sim_stats.i2cBytes,
+            (unsigned long)sim_stats.i2cNacks,
+            now ? 100.0 * sim_stats.i2cBusyUs / now : 0.0);
+    fprintf(f, "SSP1         %lu transfers, %lu bytes, busy %.2f %%\n",
+            (unsigned long)sim_stats.sspTransfers,
+            (unsigned long)sim_stats.sspBytes,
+            now ? 100.0 * sim_stats.sspBusyUs / now : 0.0);
+    fprintf(f, "dataflash    %lu page programs\n",
+            (unsigned long)sim_flashPrograms());
+    fprintf(f, "EEPROM       %lu page writes\n",
+            (unsigned long)sim_eepromWrites());
+    fprintf(f, "UART3        %lu bytes\n",
+            (unsigned long)sim_stats.uartBytes[3]);
+
+    fprintf(f, "profiler zones (host CPU time)\n");
+    for (i = 0; i < (int)prof_numZones(); i++) {
+        n = prof_formatZone(i, line, sizeof(line));
+        if (n > 2) {
+            line[n - 2] = '\0';      /* no CRLF */
+            fprintf(f, "  %s\n", line);
+        }
+    }
+}
+
+void sim_finish(void)
+{
+    fflush(stdout);
+    sim_flashSave();
+    sim_eepromSave();
+
+    if (!quiet) {
+        sim_report(stderr);
+    }
+    if (oledOut != NULL) {
+        sim_oledDump(oledOut);
+        if (oledOut != stderr) {
+            fclose(oledOut);
+        }
+    }
+
+    if (sim_traceFailures() > 0) {
+        fprintf(stderr, "sim: %u trace expectations failed\n",
+                sim_traceFailures());
+        exit(EXIT_FAILURE);
+    }
+    exit(EXIT_SUCCESS);
+}
+
+/******************************************************************************
+ * Entry point
+ *****************************************************************************/
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-d ms] [-t trace] [-o oled.txt] [-f flash.bin]\n"
+            "          [-e eeprom.bin] [-q]\n"
+            "  -d ms     simulated run time (default 60000)\n"
+            "  -t file   sensor/input trace to replay\n"
+            "  -o file   write the final OLED contents ('-' for stderr)\n"
+            "  -f file   dataflash contents, loaded at start, saved at the end\n"
+            "  -e file   EEPROM contents, likewise\n"
+            "  -q        no report\n"
+            "UART3 output is written to stdout.\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    const char *trace = NULL;
+
+    while ((opt = getopt(argc, argv, "d:t:o:f:e:qh")) != -1) {
+        switch (opt) {
+        case 'd':
+            endTime = strtoull(optarg, NULL, 0) * 1000;
+            break;
+        case 't':
+            trace = optarg;
+            break;
+        case 'o':
+            oledOut = strcmp(optarg, "-") == 0 ? stderr : fopen(optarg, "w");
+            if (oledOut == NULL) {
+                perror(optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'f':
+            sim_flashImage(optarg);
+            break;
+        case 'e':
+            sim_eepromImage(optarg);
+            break;
+        case 'q':
+            quiet = 1;
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    mapRegions();
+
+    sim_gpioInit();
+    sim_oledInit();
+    sim_led7segInit();
+    sim_flashInit();
+    sim_mma7455Init();
+    sim_isl29003Init();
+    sim_pca9532Init();
+    sim_eepromInit();
+    sim_sc16is752Init();
+    sim_max6576Init();
+
+    if (trace != NULL && sim_traceOpen(trace) != 0) {
+        perror(trace);
+        return EXIT_FAILURE;
+    }
+
+    awakeSince = cpuNs();
+    firmware_main();
+
+    sim_finish();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,522 @@
+/*****************************************************************************
+ *   sim_i2cdev.c:  I2C device models
+ *
+******************************************************************************/
+
+/*
+ * The register based devices keep their register pointer between
+ * transfers: the first byte written sets it, further bytes are written
+ * from there and reads continue from it, like on the real parts.
+ */
+
+#include <string.h>
+
+#include "board.h"
+#include "sim.h"
+
+/******************************************************************************
+ * MMA7455 accelerometer, 0x1D, DRDY on P0.3
+ *
+ * INT1 (the same pin) carries DRDY in measurement mode, or the latched
+ * level or pulse detection of X, Y and Z (absolute value against
+ * LDTH/PDTH in the 8g range, any axis), cleared by writing INTRST. The
+ * offset registers (1/128 g) are added to the outputs.
+ *****************************************************************************/
+
+#define ACC_REGS    0x20
+#define ACC_STATUS  0x09
+#define ACC_WHOAMI  0x0F
+#define ACC_I2CAD   0x0D
+#define ACC_XOFFL   0x10
+#define ACC_MCTL    0x16
+#define ACC_INTRST  0x17
+#define ACC_CTL1    0x18
+#define ACC_CTL2    0x19
+#define ACC_LDTH    0x1A
+#define ACC_PDTH    0x1B
+
+#define ACC_MCTL_DRPD  0x40
+#define ACC_CTL1_XDA   0x08
+#define ACC_CTL2_LDPL  0x01
+#define ACC_INTRST_CLR 0x01
+
+#define ACC_DRDY_PORT BOARD_PORT(ACC_DRDY)
+#define ACC_DRDY_PIN  BOARD_PIN(ACC_DRDY)
+
+/* 125 Hz output data rate */
+#define ACC_SAMPLE_US 8000
+
+static uint8_t accRegs[ACC_REGS];
+static uint8_t accPtr = 0;
+static double accG[3] = { 0.0, 0.0, 1.0 };
+static sim_event_t accEvent;
+static uint8_t accInt = 0;
+
+static int8_t accCount(double g, double lsbPerG)
+{
+    double v = g * lsbPerG;
+
+    if (v > 127) {
+        return 127;
+    }
+    if (v < -128) {
+        return -128;
+    }
+    return (int8_t)(v < 0 ? v - 0.5 : v + 0.5);
+}
+
+static double accLsbPerG(void)
+{
+    switch ((accRegs[ACC_MCTL] >> 2) & 3) {
+    case 1:
+        return 64;      /* 2g */
+    case 2:
+        return 32;      /* 4g */
+    default:
+        return 16;      /* 8g */
+    }
+}
+
+/* acceleration with the offset registers applied, g */
+static double accValue(uint32_t axis)
+{
+    int16_t off = accRegs[ACC_XOFFL + 2 * axis]
+            | ((accRegs[ACC_XOFFL + 2 * axis + 1] & 0x07) << 8);
+
+    /* 11 bit signed */
+    if (off & 0x400) {
+        off -= 0x800;
+    }
+    return accG[axis] + off / 128.0;
+}
+
+/* INT1: the detection latch, or DRDY in measurement mode */
+static void accPin(void)
+{
+    uint8_t drdy = (accRegs[ACC_MCTL] & 3) == 1
+            && !(accRegs[ACC_MCTL] & ACC_MCTL_DRPD)
+            && (accRegs[ACC_STATUS] & 1);
+
+    sim_gpioInput(ACC_DRDY_PORT, ACC_DRDY_PIN, accInt || drdy);
+}
+
+/* level (mode 2) or pulse (mode 3) detection */
+static uint8_t accDetect(uint8_t mode)
+{
+    uint8_t th = accRegs[mode == 2 ? ACC_LDTH : ACC_PDTH] & 0x7F;
+    uint8_t all = (accRegs[ACC_CTL2] & ACC_CTL2_LDPL) != 0;
+    uint8_t hits = 0, axes = 0;
+    int8_t v;
+    uint32_t i;
+
+    for (i = 0; i < 3; i++) {
+        if (accRegs[ACC_CTL1] & (ACC_CTL1_XDA << i)) {
+            continue;
+        }
+        axes++;
+        v = accCount(accValue(i), 16);
+        if ((v < 0 ? -v : v) >= th) {
+            hits++;
+        }
+    }
+
+    return all ? (axes > 0 && hits == axes) : (hits > 0);
+}
+
+static void accSample(sim_event_t *ev)
+{
+    uint32_t i;
+    int16_t v10;
+    uint8_t mode = accRegs[ACC_MCTL] & 3;
+
+    sim_schedule(ev, sim_now() + ACC_SAMPLE_US);
+
+    /* standby */
+    if (mode == 0) {
+        return;
+    }
+
+    for (i = 0; i < 3; i++) {
+        accRegs[6 + i] = (uint8_t)accCount(accValue(i), accLsbPerG());
+        v10 = (int16_t)(accValue(i) * 64);
+        accRegs[2 * i] = v10 & 0xFF;
+        accRegs[2 * i + 1] = (v10 >> 8) & 0x03;
+    }
+
+    if (mode != 1) {
+        if (!accInt && !(accRegs[ACC_INTRST] & ACC_INTRST_CLR)
+                && accDetect(mode)) {
+            accInt = 1;
+            accPin();
+        }
+        return;
+    }
+
+    if (accRegs[ACC_STATUS] & 1) {
+        accRegs[ACC_STATUS] |= 2;   /* DOVR */
+    }
+    accRegs[ACC_STATUS] |= 1;
+    accPin();
+}
+
+static int accTransfer(sim_i2c_dev_t *dev, uint8_t addr,
+        const uint8_t *tx, uint32_t txLen, uint8_t *rx, uint32_t rxLen)
+{
+    uint32_t i;
+    uint8_t readOutput = 0;
+
+    if (txLen > 0) {
+        accPtr = tx[0] % ACC_REGS;
+        for (i = 1; i < txLen; i++) {
+            if (accPtr != ACC_STATUS && accPtr != ACC_WHOAMI) {
+                accRegs[accPtr] = tx[i];
+            }
+            /* clears the detection latch */
+            if (accPtr == ACC_INTRST && (tx[i] & ACC_INTRST_CLR)) {
+                accInt = 0;
+            }
+            accPtr = (accPtr + 1) % ACC_REGS;
+        }
+        accPin();
+    }
+
+    for (i = 0; i < rxLen; i++) {
+        if (accPtr <= 0x08) {
+            readOutput = 1;
+        }
+        rx[i] = accRegs[accPtr];
+        accPtr = (accPtr + 1) % ACC_REGS;
+    }
+
+    /* reading the outputs clears DRDY */
+    if (readOutput) {
+        accRegs[ACC_STATUS] &= ~3;
+        accPin();
+    }
+
+    return 0;
+}
+
+static sim_i2c_dev_t acc = { "mma7455", 0x1D, 0, accTransfer, 0, NULL };
+
+void sim_mma7455Init(void)
+{
+    memset(accRegs, 0, sizeof(accRegs));
+    accInt = 0;
+    accRegs[ACC_WHOAMI] = 0x55;
+    accRegs[ACC_I2CAD] = 0x1D;
+
+    sim_gpioInput(ACC_DRDY_PORT, ACC_DRDY_PIN, 0);
+    sim_i2cAttach(&acc);
+
+    accEvent.fire = accSample;
+    sim_schedule(&accEvent, ACC_SAMPLE_US);
+}
+
+void sim_mma7455Set(double x, double y, double z)
+{
+    accG[0] = x;
+    accG[1] = y;
+    accG[2] = z;
+}
+
+/* 1 in measurement mode, i.e. while the firmware samples on DRDY */
+uint8_t sim_mma7455Sampling(void)
+{
+    return (accRegs[ACC_MCTL] & 3) == 1;
+}
+
+/******************************************************************************
+ * ISL29003 light sensor, 0x44, interrupt on P2.5 (active low)
+ *****************************************************************************/
+
+#define LIGHT_CMD       0x00
+#define LIGHT_CTRL      0x01
+#define LIGHT_TH_HI     0x02
+#define LIGHT_TH_LO     0x03
+#define LIGHT_LSB       0x04
+#define LIGHT_MSB       0x05
+#define LIGHT_CLEAR_INT 0x40
+
+#define LIGHT_INT_PORT BOARD_PORT(LIGHT_INT)
+#define LIGHT_INT_PIN  BOARD_PIN(LIGHT_INT)
+
+/* integration time with the internal 16 bit timing */
+#define LIGHT_CYCLE_US 100000
+
+static uint8_t lightRegs[8];
+static uint8_t lightPtr = 0;
+static uint32_t lightLux = 0;
+static uint32_t lightOutside = 0;
+static sim_event_t lightEvent;
+
+static void lightClearInt(void)
+{
+    lightRegs[LIGHT_CTRL] &= ~(1 << 5);
+    sim_gpioInput(LIGHT_INT_PORT, LIGHT_INT_PIN, 1);
+}
+
+static void lightCycle(sim_event_t *ev)
+{
+    static const uint32_t ranges[4] = { 973, 3892, 15568, 62272 };
+    static const uint8_t widths[4] = { 16, 12, 8, 4 };
+    static const uint8_t persist[4] = { 1, 4, 8, 16 };
+    uint32_t range = ranges[(lightRegs[LIGHT_CTRL] >> 2) & 3];
+    uint8_t width = widths[lightRegs[LIGHT_CMD] & 3];
+    uint64_t data;
+    uint8_t msb;
+
+    sim_schedule(ev, sim_now() + LIGHT_CYCLE_US);
+
+    if (!(lightRegs[LIGHT_CMD] & 0x80)) {
+        return;
+    }
+
+    data = ((uint64_t)lightLux << width) / range;
+    if (data > 0xFFFF) {
+        data = 0xFFFF;
+    }
+    lightRegs[LIGHT_LSB] = data & 0xFF;
+    lightRegs[LIGHT_MSB] = (data >> 8) & 0xFF;
+
+    /* thresholds are compared with the upper byte */
+    msb = lightRegs[LIGHT_MSB];
+    if (msb > lightRegs[LIGHT_TH_HI] || msb < lightRegs[LIGHT_TH_LO]) {
+        lightOutside++;
+    } else {
+        lightOutside = 0;
+    }
+
+    if (lightOutside >= persist[lightRegs[LIGHT_CTRL] & 3]) {
+        lightRegs[LIGHT_CTRL] |= 1 << 5;
+        sim_gpioInput(LIGHT_INT_PORT, LIGHT_INT_PIN, 0);
+    }
+}
+
+static int lightTransfer(sim_i2c_dev_t *dev, uint8_t addr,
+        const uint8_t *tx, uint32_t txLen, uint8_t *rx, uint32_t rxLen)
+{
+    uint32_t i;
+
+    if (txLen > 0) {
+        if (tx[0] & LIGHT_CLEAR_INT) {
+            lightClearInt();
+        }
+        lightPtr = tx[0] & 0x07;
+        for (i = 1; i < txLen; i++) {
+            if (lightPtr < LIGHT_LSB) {
+                lightRegs[lightPtr] = tx[i];
+            }
+            lightPtr = (lightPtr + 1) & 0x07;
+        }
+    }
+
+    for (i = 0; i < rxLen; i++) {
+        rx[i] = lightRegs[lightPtr];
+        lightPtr = (lightPtr + 1) & 0x07;
+    }
+
+    return 0;
+}
+
+static sim_i2c_dev_t light = { "isl29003", 0x44, 0, lightTransfer, 0, NULL };
+
+void sim_isl29003Init(void)
+{
+    memset(lightRegs, 0, sizeof(lightRegs));
+    lightRegs[LIGHT_TH_HI] = 0xFF;
+
+    sim_gpioInput(LIGHT_INT_PORT, LIGHT_INT_PIN, 1);
+    sim_i2cAttach(&light);
+
+    lightEvent.fire = lightCycle;
+    sim_schedule(&lightEvent, LIGHT_CYCLE_US);
+}
+
+void sim_isl29003Set(uint32_t lux)
+{
+    lightLux = lux;
+}
+
+/******************************************************************************
+ * PCA9532 LED dimmer, 0x60
+ *****************************************************************************/
+
+#define PCA_REGS    10
+#define PCA_AUTOINC 0x10
+
+static uint8_t pcaRegs[PCA_REGS];
+static uint8_t pcaPtr = 0;
+static uint8_t pcaAutoInc = 0;
+
+static void pcaNext(void)
+{
+    if (pcaAutoInc) {
+        pcaPtr = (pcaPtr + 1) % PCA_REGS;
+    }
+}
+
+static int pcaTransfer(sim_i2c_dev_t *dev, uint8_t addr,
+        const uint8_t *tx, uint32_t txLen, uint8_t *rx, uint32_t rxLen)
+{
+    uint32_t i;
+
+    if (txLen > 0) {
+        pcaAutoInc = (tx[0] & PCA_AUTOINC) != 0;
+        pcaPtr = (tx[0] & 0x0F) % PCA_REGS;
+        for (i = 1; i < txLen; i++) {
+            if (pcaPtr >= 2) {
+                pcaRegs[pcaPtr] = tx[i];
+            }
+            pcaNext();
+        }
+    }
+
+    for (i = 0; i < rxLen; i++) {
+        /* the inputs read back the LED pins, all high (off) */
+        rx[i] = pcaPtr < 2 ? 0xFF : pcaRegs[pcaPtr];
+        pcaNext();
+    }
+
+    return 0;
+}
+
+static sim_i2c_dev_t pca = { "pca9532", 0x60, 0, pcaTransfer, 0, NULL };
+
+void sim_pca9532Init(void)
+{
+    sim_i2cAttach(&pca);
+}
+
+/******************************************************************************
+ * 24LC08 EEPROM, 0x50 - 0x53 (one address per 256 byte block)
+ *
+ * A write starts a 5 ms write cycle during which the chip doesn't
+ * acknowledge its address. The contents can be kept in a file like the
+ * dataflash's (sim_eepromImage).
+ *****************************************************************************/
+
+#define EEPROM_SIZE  1024
+#define EEPROM_BLOCK 256
+#define EEPROM_PAGE  16
+
+/* write cycle time (tWC) */
+#define EEPROM_WRITE_US 5000
+
+static uint8_t eeprom[EEPROM_SIZE];
+static uint32_t eepromPtr = 0;
+static uint64_t eepromBusyUntil = 0;
+static uint32_t eepromWrites = 0;
+static const char *eepromImage = NULL;
+
+static int eepromTransfer(sim_i2c_dev_t *dev, uint8_t addr,
+        const uint8_t *tx, uint32_t txLen, uint8_t *rx, uint32_t rxLen)
+{
+    uint32_t block = (addr & 0x03) * EEPROM_BLOCK;
+    uint32_t page;
+    uint32_t i;
+
+    if (sim_now() < eepromBusyUntil) {
+        return -1;
+    }
+
+    if (txLen > 1) {
+        eepromBusyUntil = sim_now() + EEPROM_WRITE_US;
+        eepromWrites++;
+    }
+
+    if (txLen > 0) {
+        eepromPtr = block + tx[0];
+        page = eepromPtr & ~(EEPROM_PAGE - 1);
+        for (i = 1; i < txLen; i++) {
+            eeprom[eepromPtr] = tx[i];
+            /* writes wrap around within the page */
+            eepromPtr = page + ((eepromPtr + 1) & (EEPROM_PAGE - 1));
+        }
+    }
+
+    for (i = 0; i < rxLen; i++) {
+        rx[i] = eeprom[eepromPtr];
+        eepromPtr = (eepromPtr + 1) % EEPROM_SIZE;
+    }
+
+    return 0;
+}
+
+static sim_i2c_dev_t eepromDev = {
+    "eeprom", 0x50, 0x03, eepromTransfer, 0, NULL
+};
+
+void sim_eepromInit(void)
+{
+    FILE *f;
+
+    memset(eeprom, 0xFF, sizeof(eeprom));
+
+    if (eepromImage != NULL && (f = fopen(eepromImage, "rb")) != NULL) {
+        if (fread(eeprom, 1, EEPROM_SIZE, f) != EEPROM_SIZE) {
+            fprintf(stderr, "sim: %s is not an EEPROM image, erased\n",
+                    eepromImage);
+            memset(eeprom, 0xFF, sizeof(eeprom));
+        }
+        fclose(f);
+    }
+
+    sim_i2cAttach(&eepromDev);
+}
+
+void sim_eepromImage(const char *path)
+{
+    eepromImage = path;
+}
+
+void sim_eepromSave(void)
+{
+    FILE *f;
+
+    if (eepromImage == NULL) {
+        return;
+    }
+
+    f = fopen(eepromImage, "wb");
+    if (f == NULL || fwrite(eeprom, 1, EEPROM_SIZE, f) != EEPROM_SIZE) {
+        perror(eepromImage);
+    }
+    if (f != NULL) {
+        fclose(f);
+    }
+}
+
+uint32_t sim_eepromWrites(void)
+{
+    return eepromWrites;
+}
+
+/******************************************************************************
+ * SC16IS752 I2C UART, 0x48. Transmitter always empty, nothing received.
+ *****************************************************************************/
+
+#define SC16_LSR 0x05
+
+static int sc16Transfer(sim_i2c_dev_t *dev, uint8_t addr,
+        const uint8_t *tx, uint32_t txLen, uint8_t *rx, uint32_t rxLen)
+{
+    static uint8_t reg = 0;
+    uint32_t i;
+
+    if (txLen > 0) {
+        reg = (tx[0] >> 3) & 0x0F;
+    }
+    for (i = 0; i < rxLen; i++) {
+        rx[i] = reg == SC16_LSR ? 0x60 : 0x00;
+    }
+
+    return 0;
+}
+
+static sim_i2c_dev_t sc16 = { "sc16is752", 0x48, 0, sc16Transfer, 0, NULL };
+
+void sim_sc16is752Init(void)
+{
+    sim_i2cAttach(&sc16);
+}
@@ -0,0 +1,702 @@
+/*****************************************************************************
+ *   sim_mcu.c:  Simulated Lib_MCU drivers (GPIO, SSP, GPDMA, I2C, UART)
+ *
+******************************************************************************/
+
+/*
+ * These replace the Lib_MCU drivers whose behaviour depends on the
+ * hardware reacting to register writes. They keep the driver API and
+ * forward the traffic to the device models attached with sim_spiAttach /
+ * sim_i2cAttach. Transfers started in interrupt mode (DMA, I2C interrupt
+ * mode, UART THRE) complete after the time the bus would need and then
+ * raise the peripheral interrupt.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lpc17xx_gpio.h"
+#include "lpc17xx_ssp.h"
+#include "lpc17xx_gpdma.h"
+#include "lpc17xx_i2c.h"
+#include "lpc17xx_uart.h"
+
+#include "sim.h"
+
+#define NUM_PORTS 5
+#define MAX_LISTENERS 8
+
+#define NUM_DMA_CHANNELS 8
+
+#define UART_BYTE_US(baud) (10 * 1000000 / (baud))
+#define UART_FIFO_SIZE 16
+
+/* write access to registers that are read-only for the firmware */
+#define HW(reg) (*(volatile uint32_t *)&(reg))
+
+/******************************************************************************
+ * GPIO
+ *****************************************************************************/
+
+static LPC_GPIO_TypeDef * const ports[NUM_PORTS] = {
+    LPC_GPIO0, LPC_GPIO1, LPC_GPIO2, LPC_GPIO3, LPC_GPIO4
+};
+
+static uint32_t latch[NUM_PORTS];
+static uint32_t external[NUM_PORTS];
+
+static sim_gpio_listener_t listeners[MAX_LISTENERS];
+static uint32_t numListeners = 0;
+
+void sim_gpioInit(void)
+{
+    uint32_t i;
+
+    /* undriven inputs read high (pull-ups) */
+    for (i = 0; i < NUM_PORTS; i++) {
+        external[i] = 0xFFFFFFFF;
+        ports[i]->FIOPIN = external[i];
+    }
+}
+
+void sim_gpioListen(sim_gpio_listener_t listener)
+{
+    if (numListeners < MAX_LISTENERS) {
+        listeners[numListeners++] = listener;
+    }
+}
+
+void sim_gpioIntSync(void)
+{
+    HW(LPC_GPIOINT->IO0IntStatR) &= ~LPC_GPIOINT->IO0IntClr;
+    HW(LPC_GPIOINT->IO0IntStatF) &= ~LPC_GPIOINT->IO0IntClr;
+    LPC_GPIOINT->IO0IntClr = 0;
+    HW(LPC_GPIOINT->IO2IntStatR) &= ~LPC_GPIOINT->IO2IntClr;
+    HW(LPC_GPIOINT->IO2IntStatF) &= ~LPC_GPIOINT->IO2IntClr;
+    LPC_GPIOINT->IO2IntClr = 0;
+
+    HW(LPC_GPIOINT->IntStatus) =
+            ((LPC_GPIOINT->IO0IntStatR | LPC_GPIOINT->IO0IntStatF) ? 1 : 0)
+          | ((LPC_GPIOINT->IO2IntStatR | LPC_GPIOINT->IO2IntStatF) ? 4 : 0);
+}
+
+uint8_t sim_gpioIntPending(void)
+{
+    return LPC_GPIOINT->IntStatus != 0;
+}
+
+static void edges(uint8_t port, uint32_t oldPins, uint32_t newPins)
+{
+    uint32_t rising = ~oldPins & newPins;
+    uint32_t falling = oldPins & ~newPins;
+    uint32_t hit = 0;
+
+    sim_gpioIntSync();
+
+    if (port == 0) {
+        hit = (rising & LPC_GPIOINT->IO0IntEnR)
+                | (falling & LPC_GPIOINT->IO0IntEnF);
+        HW(LPC_GPIOINT->IO0IntStatR) |= rising & LPC_GPIOINT->IO0IntEnR;
+        HW(LPC_GPIOINT->IO0IntStatF) |= falling & LPC_GPIOINT->IO0IntEnF;
+    } else if (port == 2) {
+        hit = (rising & LPC_GPIOINT->IO2IntEnR)
+                | (falling & LPC_GPIOINT->IO2IntEnF);
+        HW(LPC_GPIOINT->IO2IntStatR) |= rising & LPC_GPIOINT->IO2IntEnR;
+        HW(LPC_GPIOINT->IO2IntStatF) |= falling & LPC_GPIOINT->IO2IntEnF;
+    }
+
+    if (hit != 0) {
+        sim_gpioIntSync();
+        sim_irqRaise(EINT3_IRQn);
+    }
+}
+
+static void update(uint8_t port)
+{
+    uint32_t dir = ports[port]->FIODIR;
+    uint32_t oldPins = ports[port]->FIOPIN;
+    uint32_t newPins = (latch[port] & dir) | (external[port] & ~dir);
+    uint32_t i;
+
+    if (newPins == oldPins) {
+        return;
+    }
+    ports[port]->FIOPIN = newPins;
+
+    for (i = 0; i < numListeners; i++) {
+        listeners[i](port, oldPins, newPins);
+    }
+    edges(port, oldPins, newPins);
+}
+
+void sim_gpioOutput(uint8_t port, uint32_t setMask, uint32_t clrMask)
+{
+    latch[port] = (latch[port] | setMask) & ~clrMask;
+    update(port);
+}
+
+void sim_gpioInput(uint8_t port, uint8_t pin, uint8_t level)
+{
+    if (level) {
+        external[port] |= 1UL << pin;
+    } else {
+        external[port] &= ~(1UL << pin);
+    }
+    update(port);
+}
+
+uint8_t sim_gpioGet(uint8_t port, uint8_t pin)
+{
+    return (ports[port]->FIOPIN >> pin) & 1;
+}
+
+void GPIO_SetDir(uint8_t portNum, uint32_t bitValue, uint8_t dir)
+{
+    if (portNum >= NUM_PORTS) {
+        return;
+    }
+    if (dir) {
+        ports[portNum]->FIODIR |= bitValue;
+    } else {
+        ports[portNum]->FIODIR &= ~bitValue;
+    }
+    update(portNum);
+}
+
+void GPIO_SetValue(uint8_t portNum, uint32_t bitValue)
+{
+    if (portNum < NUM_PORTS) {
+        sim_gpioOutput(portNum, bitValue, 0);
+    }
+}
+
+void GPIO_ClearValue(uint8_t portNum, uint32_t bitValue)
+{
+    if (portNum < NUM_PORTS) {
+        sim_gpioOutput(portNum, 0, bitValue);
+    }
+}
+
+uint32_t GPIO_ReadValue(uint8_t portNum)
+{
+    return portNum < NUM_PORTS ? ports[portNum]->FIOPIN : 0;
+}
+
+/******************************************************************************
+ * SPI (SSP1)
+ *****************************************************************************/
+
+static sim_spi_dev_t *spiDevs = NULL;
+static uint32_t sspClock = 1000000;
+static uint8_t sspDmaEnabled = 0;
+
+static void csListener(uint8_t port, uint32_t oldPins, uint32_t newPins)
+{
+    sim_spi_dev_t *d;
+    uint32_t mask;
+
+    for (d = spiDevs; d != NULL; d = d->next) {
+        mask = 1UL << d->csPin;
+        if (d->csPort == port && ((oldPins ^ newPins) & mask)
+                && d->select != NULL) {
+            d->select(d, (newPins & mask) == 0);
+        }
+    }
+}
+
+void sim_spiAttach(sim_spi_dev_t *dev)
+{
+    if (spiDevs == NULL) {
+        sim_gpioListen(csListener);
+    }
+    dev->next = spiDevs;
+    spiDevs = dev;
+}
+
+/* devices sharing a chip select all see the byte, MISO is wired-AND */
+uint8_t sim_spiExchange(uint8_t tx)
+{
+    sim_spi_dev_t *d;
+    uint8_t rx = 0xFF;
+
+    for (d = spiDevs; d != NULL; d = d->next) {
+        if (!sim_gpioGet(d->csPort, d->csPin)) {
+            rx &= d->exchange(d, tx);
+        }
+    }
+
+    return rx;
+}
+
+uint32_t sim_sspDuration(uint32_t len)
+{
+    return (uint32_t)((uint64_t)len * 8 * 1000000 / sspClock) + 1;
+}
+
+void SSP_ConfigStructInit(SSP_CFG_Type *SSP_InitStruct)
+{
+    SSP_InitStruct->CPHA = SSP_CPHA_FIRST;
+    SSP_InitStruct->CPOL = SSP_CPOL_HI;
+    SSP_InitStruct->ClockRate = 1000000;
+    SSP_InitStruct->Databit = SSP_DATABIT_8;
+    SSP_InitStruct->Mode = SSP_MASTER_MODE;
+    SSP_InitStruct->FrameFormat = SSP_FRAME_SPI;
+}
+
+void SSP_Init(LPC_SSP_TypeDef *SSPx, SSP_CFG_Type *SSP_ConfigStruct)
+{
+    if (SSPx == LPC_SSP1 && SSP_ConfigStruct->ClockRate != 0) {
+        sspClock = SSP_ConfigStruct->ClockRate;
+    }
+}
+
+void SSP_Cmd(LPC_SSP_TypeDef* SSPx, FunctionalState NewState)
+{
+}
+
+void SSP_DMACmd(LPC_SSP_TypeDef *SSPx, uint32_t DMAMode,
+        FunctionalState NewState)
+{
+    if (SSPx != LPC_SSP1) {
+        return;
+    }
+    if (NewState == ENABLE) {
+        sspDmaEnabled |= DMAMode;
+    } else {
+        sspDmaEnabled &= ~DMAMode;
+    }
+}
+
+int32_t SSP_ReadWrite(LPC_SSP_TypeDef *SSPx, SSP_DATA_SETUP_Type *dataCfg,
+        SSP_TRANSFER_Type xfType)
+{
+    uint8_t *tx = (uint8_t *)dataCfg->tx_data;
+    uint8_t *rx = (uint8_t *)dataCfg->rx_data;
+    uint32_t i;
+    uint8_t b;
+
+    for (i = 0; i < dataCfg->length; i++) {
+        b = sim_spiExchange(tx != NULL ? tx[i] : 0xFF);
+        if (rx != NULL) {
+            rx[i] = b;
+        }
+    }
+
+    dataCfg->tx_cnt = dataCfg->length;
+    dataCfg->rx_cnt = dataCfg->length;
+    dataCfg->status = SSP_STAT_DONE;
+
+    sim_stats.sspTransfers++;
+    sim_stats.sspBytes += dataCfg->length;
+    sim_stats.sspBusyUs += sim_sspDuration(dataCfg->length);
+    sim_busy(sim_sspDuration(dataCfg->length));
+
+    return dataCfg->length;
+}
+
+/******************************************************************************
+ * GPDMA
+ *****************************************************************************/
+
+static LPC_GPDMACH_TypeDef * const dmaChannels[NUM_DMA_CHANNELS] = {
+    LPC_GPDMACH0, LPC_GPDMACH1, LPC_GPDMACH2, LPC_GPDMACH3,
+    LPC_GPDMACH4, LPC_GPDMACH5, LPC_GPDMACH6, LPC_GPDMACH7
+};
+
+static struct
+{
+    GPDMA_Channel_CFG_Type cfg;
+    fnGPDMACbs_Type *cb;
+    uint8_t enabled;
+} dma[NUM_DMA_CHANNELS];
+
+static uint8_t dmaTc = 0;
+static sim_event_t sspDmaEvent;
+static int sspTxCh = -1;
+static int sspRxCh = -1;
+
+static uint8_t *dmaPtr(uint32_t addr)
+{
+    return (uint8_t *)(uintptr_t)addr;
+}
+
+/* both SSP1 channels ran to completion */
+static void sspDmaDone(sim_event_t *ev)
+{
+    uint32_t len = dma[sspTxCh].cfg.TransferSize;
+    uint32_t txCtrl = dmaChannels[sspTxCh]->DMACCControl;
+    uint32_t rxCtrl = dmaChannels[sspRxCh]->DMACCControl;
+    uint8_t *src = dmaPtr(dma[sspTxCh].cfg.SrcMemAddr);
+    uint8_t *dst = dmaPtr(dma[sspRxCh].cfg.DstMemAddr);
+    uint32_t i;
+    uint8_t b;
+
+    for (i = 0; i < len; i++) {
+        b = sim_spiExchange(*src);
+        *dst = b;
+        if (txCtrl & GPDMA_DMACCxControl_SI) {
+            src++;
+        }
+        if (rxCtrl & GPDMA_DMACCxControl_DI) {
+            dst++;
+        }
+    }
+
+    sim_stats.sspTransfers++;
+    sim_stats.sspBytes += len;
+
+    dmaTc |= (1 << sspTxCh) | (1 << sspRxCh);
+    sim_irqRaise(DMA_IRQn);
+}
+
+static void sspDmaStart(void)
+{
+    uint32_t us;
+
+    if (sspTxCh < 0 || sspRxCh < 0 || !dma[sspTxCh].enabled
+            || !dma[sspRxCh].enabled
+            || sspDmaEnabled != (SSP_DMA_TX | SSP_DMA_RX)) {
+        return;
+    }
+    if (dma[sspTxCh].cfg.TransferSize != dma[sspRxCh].cfg.TransferSize) {
+        fprintf(stderr, "sim: SSP1 DMA channels have different lengths\n");
+        exit(EXIT_FAILURE);
+    }
+
+    us = sim_sspDuration(dma[sspTxCh].cfg.TransferSize);
+    sim_stats.sspBusyUs += us;
+    sspDmaEvent.fire = sspDmaDone;
+    sim_schedule(&sspDmaEvent, sim_now() + us);
+}
+
+void GPDMA_Init(void)
+{
+    memset(dma, 0, sizeof(dma));
+    dmaTc = 0;
+}
+
+Status GPDMA_Setup(GPDMA_Channel_CFG_Type *GPDMAChannelConfig,
+        fnGPDMACbs_Type *pfnGPDMACbs)
+{
+    uint32_t ch = GPDMAChannelConfig->ChannelNum;
+    uint32_t ctrl;
+
+    if (ch >= NUM_DMA_CHANNELS || dma[ch].enabled) {
+        return ERROR;
+    }
+
+    dma[ch].cfg = *GPDMAChannelConfig;
+    dma[ch].cb = pfnGPDMACbs;
+    dmaTc &= ~(1 << ch);
+
+    ctrl = GPDMA_DMACCxControl_TransferSize(GPDMAChannelConfig->TransferSize);
+    switch (GPDMAChannelConfig->TransferType) {
+    case GPDMA_TRANSFERTYPE_M2M:
+        ctrl |= GPDMA_DMACCxControl_SI | GPDMA_DMACCxControl_DI;
+        break;
+    case GPDMA_TRANSFERTYPE_M2P:
+        ctrl |= GPDMA_DMACCxControl_SI;
+        if (GPDMAChannelConfig->DstConn == GPDMA_CONN_SSP1_Tx) {
+            sspTxCh = ch;
+        }
+        break;
+    case GPDMA_TRANSFERTYPE_P2M:
+        ctrl |= GPDMA_DMACCxControl_DI;
+        if (GPDMAChannelConfig->SrcConn == GPDMA_CONN_SSP1_Rx) {
+            sspRxCh = ch;
+        }
+        break;
+    }
+    dmaChannels[ch]->DMACCControl = ctrl;
+
+    return SUCCESS;
+}
+
+void GPDMA_ChannelCmd(uint8_t channelNum, FunctionalState NewState)
+{
+    if (channelNum >= NUM_DMA_CHANNELS) {
+        return;
+    }
+
+    dma[channelNum].enabled = (NewState == ENABLE);
+
+    if (NewState == ENABLE) {
+        sspDmaStart();
+    } else if ((int)channelNum == sspTxCh || (int)channelNum == sspRxCh) {
+        sim_cancel(&sspDmaEvent);
+    }
+}
+
+void GPDMA_IntHandler(void)
+{
+    uint32_t ch;
+
+    for (ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        if (dmaTc & (1 << ch)) {
+            dmaTc &= ~(1 << ch);
+            dma[ch].enabled = 0;
+            if (dma[ch].cb != NULL) {
+                dma[ch].cb(GPDMA_STAT_INTTC);
+            }
+        }
+    }
+}
+
+/******************************************************************************
+ * I2C (I2C2)
+ *****************************************************************************/
+
+static sim_i2c_dev_t *i2cDevs = NULL;
+static uint32_t i2cClock = 100000;
+
+static I2C_M_SETUP_Type *i2cSetup = NULL;
+static uint8_t i2cDone = 0;
+static sim_event_t i2cEvent;
+
+void sim_i2cAttach(sim_i2c_dev_t *dev)
+{
+    dev->next = i2cDevs;
+    i2cDevs = dev;
+}
+
+int sim_i2cTransfer(uint8_t addr, const uint8_t *tx, uint32_t txLen,
+        uint8_t *rx, uint32_t rxLen)
+{
+    sim_i2c_dev_t *d;
+
+    sim_stats.i2cTransfers++;
+    sim_stats.i2cBytes += txLen + rxLen;
+    sim_stats.i2cBusyUs += sim_i2cDuration(txLen, rxLen);
+
+    for (d = i2cDevs; d != NULL; d = d->next) {
+        if ((addr & ~d->addrMask) == d->addr) {
+            d->transfers++;
+            if (d->transfer(d, addr, tx, txLen, rx, rxLen) == 0) {
+                return 0;
+            }
+            break;
+        }
+    }
+
+    sim_stats.i2cNacks++;
+    return -1;
+}
+
+/* start, address and 9 clocks per byte, repeated start before the read */
+uint32_t sim_i2cDuration(uint32_t txLen, uint32_t rxLen)
+{
+    uint32_t bytes = (txLen > 0 ? 1 + txLen : 0) + (rxLen > 0 ? 1 + rxLen : 0);
+
+    return (uint32_t)((uint64_t)bytes * 9 * 1000000 / i2cClock) + 1;
+}
+
+static Status runSetup(I2C_M_SETUP_Type *s)
+{
+    if (sim_i2cTransfer(s->sl_addr7bit, s->tx_data, s->tx_length,
+            s->rx_data, s->rx_length) != 0) {
+        s->status = I2C_SETUP_STATUS_NOACKF;
+        return ERROR;
+    }
+
+    s->tx_count = s->tx_length;
+    s->rx_count = s->rx_length;
+    s->status = I2C_SETUP_STATUS_DONE;
+
+    return SUCCESS;
+}
+
+static void i2cFire(sim_event_t *ev)
+{
+    runSetup(i2cSetup);
+    i2cDone = 1;
+    sim_irqRaise(I2C2_IRQn);
+}
+
+void I2C_Init(LPC_I2C_TypeDef *I2Cx, uint32_t clockrate)
+{
+    if (I2Cx == LPC_I2C2 && clockrate != 0) {
+        i2cClock = clockrate;
+    }
+}
+
+void I2C_Cmd(LPC_I2C_TypeDef* I2Cx, FunctionalState NewState)
+{
+}
+
+Status I2C_MasterTransferData(LPC_I2C_TypeDef *I2Cx,
+        I2C_M_SETUP_Type *TransferCfg, I2C_TRANSFER_OPT_Type Opt)
+{
+    uint32_t us = sim_i2cDuration(TransferCfg->tx_length,
+            TransferCfg->rx_length);
+    Status ret;
+
+    if (I2Cx != LPC_I2C2) {
+        return ERROR;
+    }
+
+    TransferCfg->status = 0;
+    TransferCfg->tx_count = 0;
+    TransferCfg->rx_count = 0;
+
+    if (Opt == I2C_TRANSFER_POLLING) {
+        ret = runSetup(TransferCfg);
+        sim_busy(us);
+        return ret;
+    }
+
+    if (i2cEvent.queued || i2cDone) {
+        return ERROR;
+    }
+
+    /* like the driver, the interrupt is enabled for the transfer only */
+    i2cSetup = TransferCfg;
+    i2cEvent.fire = i2cFire;
+    sim_schedule(&i2cEvent, sim_now() + us);
+    NVIC_EnableIRQ(I2C2_IRQn);
+
+    return SUCCESS;
+}
+
+void I2C2_StdIntHandler(void)
+{
+    I2C_M_SETUP_Type *s = i2cSetup;
+
+    if (!i2cDone) {
+        return;
+    }
+    i2cDone = 0;
+    NVIC_DisableIRQ(I2C2_IRQn);
+
+    if (s->callback != NULL) {
+        s->callback();
+    }
+}
+
+/******************************************************************************
+ * UART (UART3)
+ *****************************************************************************/
+
+static uint32_t uartBaud = 115200;
+static fnTxCbs_Type *uartTxCb = NULL;
+static uint32_t uartFifo = 0;
+static uint8_t uartThre = 0;
+static sim_event_t uartEvent;
+
+static uint8_t uartNum(LPC_UART_TypeDef *UARTx)
+{
+    if ((void *)UARTx == (void *)LPC_UART0) return 0;
+    if ((void *)UARTx == (void *)LPC_UART1) return 1;
+    if ((void *)UARTx == (void *)LPC_UART2) return 2;
+    return 3;
+}
+
+static void uartThreCheck(void)
+{
+    if (uartThre && (LPC_UART3->IER & UART_IER_THREINT_EN)) {
+        sim_irqRaise(UART3_IRQn);
+    }
+}
+
+/* one character has left the transmit FIFO */
+static void uartShift(sim_event_t *ev)
+{
+    if (--uartFifo > 0) {
+        sim_schedule(ev, sim_now() + UART_BYTE_US(uartBaud));
+        return;
+    }
+
+    uartThre = 1;
+    uartThreCheck();
+}
+
+void sim_uartOut(uint8_t uart, uint8_t byte)
+{
+    sim_stats.uartBytes[uart & 3]++;
+    if (uart == 3) {
+        fputc(byte, stdout);
+    }
+}
+
+void UART_Init(LPC_UART_TypeDef *UARTx, UART_CFG_Type *UART_ConfigStruct)
+{
+    if (uartNum(UARTx) == 3) {
+        uartBaud = UART_ConfigStruct->Baud_rate;
+        uartThre = 1;
+    }
+}
+
+void UART_TxCmd(LPC_UART_TypeDef *UARTx, FunctionalState NewState)
+{
+}
+
+void UART_SetupCbs(LPC_UART_TypeDef *UARTx, uint8_t CbType, void *pfnCbs)
+{
+    if (uartNum(UARTx) == 3 && CbType == 1) {
+        uartTxCb = (fnTxCbs_Type *)pfnCbs;
+    }
+}
+
+void UART_IntConfig(LPC_UART_TypeDef *UARTx, UART_INT_Type UARTIntCfg,
+        FunctionalState NewState)
+{
+    if (uartNum(UARTx) != 3 || UARTIntCfg != UART_INTCFG_THRE) {
+        return;
+    }
+
+    if (NewState == ENABLE) {
+        LPC_UART3->IER |= UART_IER_THREINT_EN;
+        uartThreCheck();
+    } else {
+        LPC_UART3->IER &= ~UART_IER_THREINT_EN;
+    }
+}
+
+void UART_SendData(LPC_UART_TypeDef* UARTx, uint8_t Data)
+{
+    uint8_t n = uartNum(UARTx);
+
+    sim_uartOut(n, Data);
+    if (n != 3) {
+        return;
+    }
+
+    if (uartFifo >= UART_FIFO_SIZE) {
+        fprintf(stderr, "sim: UART3 transmit FIFO overrun\n");
+    }
+
+    uartThre = 0;
+    if (uartFifo++ == 0) {
+        uartEvent.fire = uartShift;
+        sim_schedule(&uartEvent, sim_now() + UART_BYTE_US(uartBaud));
+    }
+}
+
+uint32_t UART_Send(LPC_UART_TypeDef *UARTx, uint8_t *txbuf,
+        uint32_t buflen, TRANSFER_BLOCK_Type flag)
+{
+    uint32_t i;
+
+    for (i = 0; i < buflen; i++) {
+        sim_uartOut(uartNum(UARTx), txbuf[i]);
+    }
+    sim_busy(buflen * UART_BYTE_US(uartBaud));
+
+    return buflen;
+}
+
+uint32_t UART_SendString(LPC_UART_TypeDef *UARTx, uint8_t *txbuf)
+{
+    return UART_Send(UARTx, txbuf, strlen((char *)txbuf), BLOCKING);
+}
+
+void UART3_StdIntHandler(void)
+{
+    if (!uartThre || !(LPC_UART3->IER & UART_IER_THREINT_EN)) {
+        return;
+    }
+    uartThre = 0;
+
+    if (uartTxCb != NULL) {
+        uartTxCb();
+    }
+}
@@ -0,0 +1,23 @@
+/*****************************************************************************
+ *   sim_prof_port.c:  Profiler time source for the simulated board
+ *
+******************************************************************************/
+
+/*
+ * The simulated board has no cycle counter. Zones are measured in host
+ * CPU time of the firmware thread instead, so the numbers compare code
+ * paths with each other rather than predict target cycles.
+ */
+
+#include <time.h>
+#include "prof.h"
+
+uint32_t prof_port_ticks(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+    /* wraps after 4.29 s, durations are taken as differences */
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec);
+}
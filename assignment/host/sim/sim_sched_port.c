@@ -0,0 +1,55 @@
+/*****************************************************************************
+ *   sim_sched_port.c:  Scheduler port for the simulated board
+ *
+******************************************************************************/
+
+/*
+ * Replaces sched_port.c. The time base is the simulated clock instead of
+ * the RIT, and sleeping advances it. Reading the time costs a microsecond
+ * so that code polling sched_now() makes progress.
+ */
+
+#include "sched.h"
+#include "sim.h"
+
+void sched_port_init(void)
+{
+}
+
+uint32_t sched_port_now(void)
+{
+    sim_busy(1);
+    return (uint32_t)(sim_now() / 1000);
+}
+
+void sched_port_sleep(uint32_t ms)
+{
+    uint64_t now = sim_now();
+    uint64_t target;
+
+    if (ms == SCHED_FOREVER) {
+        sim_sleep(~0ULL >> 1);
+        return;
+    }
+
+    /* wake at the start of the requested millisecond */
+    target = (now / 1000 + ms) * 1000;
+    sim_sleep(target > now ? target - now : 0);
+}
+
+uint32_t sched_port_lock(void)
+{
+    uint32_t key = __get_PRIMASK();
+
+    __disable_irq();
+    return key;
+}
+
+void sched_port_unlock(uint32_t key)
+{
+    __set_PRIMASK(key);
+}
+
+void sched_ritHandler(void)
+{
+}
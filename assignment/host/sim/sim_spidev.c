@@ -0,0 +1,287 @@
+/*****************************************************************************
+ *   sim_spidev.c:  SPI device models (OLED, 7 segment display, dataflash)
+ *
+******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+#include "sim.h"
+
+/******************************************************************************
+ * SSD1305 OLED, CS on P0.6, D/C on P2.7
+ *****************************************************************************/
+
+#define OLED_COLUMNS 132
+#define OLED_PAGES   8
+
+/* visible area, the panel starts at column 18 */
+#define OLED_X_OFFSET 18
+#define OLED_WIDTH    96
+#define OLED_HEIGHT   64
+
+static uint8_t oledFb[OLED_PAGES][OLED_COLUMNS];
+static uint8_t oledPage = 0;
+static uint8_t oledColumn = 0;
+static uint8_t oledParams = 0;
+
+/* number of parameter bytes following a command */
+static uint8_t oledParamCount(uint8_t cmd)
+{
+    switch (cmd) {
+    case 0x81: case 0x82: case 0xa8: case 0xd3: case 0xad:
+    case 0xd5: case 0xd8: case 0xd9: case 0xda: case 0xdb:
+        return 1;
+    case 0x91:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+static uint8_t oledExchange(sim_spi_dev_t *dev, uint8_t tx)
+{
+    if (sim_gpioGet(BOARD_PORT(OLED_DC), BOARD_PIN(OLED_DC))) {
+        /* data */
+        oledFb[oledPage][oledColumn] = tx;
+        oledColumn = (oledColumn + 1) % OLED_COLUMNS;
+        return 0xFF;
+    }
+
+    if (oledParams > 0) {
+        oledParams--;
+    } else if (tx <= 0x0F) {
+        oledColumn = (oledColumn & 0xF0) | tx;
+    } else if (tx <= 0x1F) {
+        oledColumn = (oledColumn & 0x0F) | ((tx & 0x0F) << 4);
+    } else if (tx >= 0xB0 && tx <= 0xB7) {
+        oledPage = tx & 0x07;
+    } else {
+        oledParams = oledParamCount(tx);
+    }
+
+    if (oledColumn >= OLED_COLUMNS) {
+        oledColumn = 0;
+    }
+
+    return 0xFF;
+}
+
+static sim_spi_dev_t oled = {
+    "oled", BOARD_PORT(OLED_CS), BOARD_PIN(OLED_CS), oledExchange, NULL, NULL
+};
+
+void sim_oledInit(void)
+{
+    memset(oledFb, 0, sizeof(oledFb));
+    sim_spiAttach(&oled);
+}
+
+/* two pixel rows per text line, using half block characters */
+void sim_oledDump(FILE *f)
+{
+    uint32_t x, y;
+    uint8_t top, bottom;
+    uint8_t *col;
+
+    fprintf(f, "+");
+    for (x = 0; x < OLED_WIDTH; x++) {
+        fprintf(f, "-");
+    }
+    fprintf(f, "+\n");
+
+    for (y = 0; y < OLED_HEIGHT; y += 2) {
+        fprintf(f, "|");
+        for (x = 0; x < OLED_WIDTH; x++) {
+            col = &oledFb[y >> 3][OLED_X_OFFSET + x];
+            top = (*col >> (y & 7)) & 1;
+            bottom = (*col >> ((y + 1) & 7)) & 1;
+            fprintf(f, "%s", top ? (bottom ? "█" : "▀")
+                    : (bottom ? "▄" : " "));
+        }
+        fprintf(f, "|\n");
+    }
+
+    fprintf(f, "+");
+    for (x = 0; x < OLED_WIDTH; x++) {
+        fprintf(f, "-");
+    }
+    fprintf(f, "+\n");
+}
+
+/******************************************************************************
+ * 7 segment display (shift register), CS on P2.2
+ *****************************************************************************/
+
+static uint8_t segShift = 0xFF;
+static uint8_t segValue = 0xFF;
+static uint32_t segUpdates = 0;
+
+static uint8_t segExchange(sim_spi_dev_t *dev, uint8_t tx)
+{
+    segShift = tx;
+    return 0xFF;
+}
+
+/* the shift register is latched on the rising edge of CS */
+static void segSelect(sim_spi_dev_t *dev, uint8_t selected)
+{
+    if (!selected && segShift != segValue) {
+        segValue = segShift;
+        segUpdates++;
+    }
+}
+
+static sim_spi_dev_t led7seg = {
+    "led7seg", BOARD_PORT(LED7_CS), BOARD_PIN(LED7_CS), segExchange,
+    segSelect, NULL
+};
+
+void sim_led7segInit(void)
+{
+    sim_spiAttach(&led7seg);
+}
+
+/******************************************************************************
+ * AT45DB081D dataflash, 4096 pages of 264 bytes, CS on P2.2 (shared with
+ * the 7 segment display). Only the commands used by flash.c are modelled.
+ * The contents can be loaded from and saved to a file (sim_flashImage),
+ * so runs can be chained to test recovery after a power cycle.
+ *****************************************************************************/
+
+#define DF_PAGES     4096
+#define DF_PAGE_SIZE 264
+#define DF_SIZE      (DF_PAGES * DF_PAGE_SIZE)
+
+/* page erase and program through buffer (tEP) */
+#define DF_PROGRAM_US 17000
+
+#define DF_STATUS_RDY 0x80
+#define DF_STATUS_DENSITY (0x09 << 2)
+
+static uint8_t *dfMem = NULL;
+static uint8_t dfBuf[DF_PAGE_SIZE];
+static const char *dfImage = NULL;
+
+static uint8_t dfCmd;
+static uint32_t dfCount;        /* bytes since CS went low */
+static uint32_t dfAddr;
+static uint32_t dfReadPos;
+static uint64_t dfBusyUntil = 0;
+static uint32_t dfPrograms = 0;
+
+static uint32_t dfPage(uint32_t addr)
+{
+    return (addr >> 9) & (DF_PAGES - 1);
+}
+
+static uint8_t dfExchange(sim_spi_dev_t *dev, uint8_t tx)
+{
+    static const uint8_t id[] = { 0x1F, 0x25, 0x00, 0x01 };
+    uint32_t n = dfCount++;
+    uint8_t rx = 0xFF;
+
+    if (n == 0) {
+        dfCmd = tx;
+        dfAddr = 0;
+        return 0xFF;
+    }
+
+    switch (dfCmd) {
+    case 0x9F:                              /* read id */
+        rx = n - 1 < sizeof(id) ? id[n - 1] : 0x00;
+        break;
+    case 0xD7:                              /* status */
+        rx = DF_STATUS_DENSITY
+                | (sim_now() >= dfBusyUntil ? DF_STATUS_RDY : 0);
+        break;
+    case 0x0B:                              /* fast read */
+        if (n <= 3) {
+            dfAddr = (dfAddr << 8) | tx;
+            dfReadPos = dfPage(dfAddr) * DF_PAGE_SIZE
+                    + (dfAddr & 0x1FF) % DF_PAGE_SIZE;
+        } else if (n > 4) {
+            rx = (sim_now() >= dfBusyUntil) ? dfMem[dfReadPos] : 0xFF;
+            dfReadPos = (dfReadPos + 1) % DF_SIZE;
+        }
+        break;
+    case 0x82:                              /* program through buffer 1 */
+        if (n <= 3) {
+            dfAddr = (dfAddr << 8) | tx;
+        } else {
+            dfBuf[((dfAddr & 0x1FF) + n - 4) % DF_PAGE_SIZE] = tx;
+        }
+        break;
+    default:
+        break;
+    }
+
+    return rx;
+}
+
+static void dfSelect(sim_spi_dev_t *dev, uint8_t selected)
+{
+    if (selected) {
+        dfCount = 0;
+        return;
+    }
+
+    /* the page program starts when CS goes high */
+    if (dfCount > 4 && dfCmd == 0x82 && sim_now() >= dfBusyUntil) {
+        memcpy(&dfMem[dfPage(dfAddr) * DF_PAGE_SIZE], dfBuf, DF_PAGE_SIZE);
+        dfBusyUntil = sim_now() + DF_PROGRAM_US;
+        dfPrograms++;
+    }
+}
+
+static sim_spi_dev_t dataflash = {
+    "dataflash", BOARD_PORT(FLASH_CS), BOARD_PIN(FLASH_CS), dfExchange,
+    dfSelect, NULL
+};
+
+void sim_flashInit(void)
+{
+    FILE *f;
+
+    dfMem = malloc(DF_SIZE);
+    memset(dfMem, 0xFF, DF_SIZE);
+
+    if (dfImage != NULL && (f = fopen(dfImage, "rb")) != NULL) {
+        if (fread(dfMem, 1, DF_SIZE, f) != DF_SIZE) {
+            fprintf(stderr, "sim: %s is not a flash image, erased\n",
+                    dfImage);
+            memset(dfMem, 0xFF, DF_SIZE);
+        }
+        fclose(f);
+    }
+
+    sim_spiAttach(&dataflash);
+}
+
+void sim_flashImage(const char *path)
+{
+    dfImage = path;
+}
+
+void sim_flashSave(void)
+{
+    FILE *f;
+
+    if (dfImage == NULL) {
+        return;
+    }
+
+    f = fopen(dfImage, "wb");
+    if (f == NULL || fwrite(dfMem, 1, DF_SIZE, f) != DF_SIZE) {
+        perror(dfImage);
+    }
+    if (f != NULL) {
+        fclose(f);
+    }
+}
+
+uint32_t sim_flashPrograms(void)
+{
+    return dfPrograms;
+}
@@ -0,0 +1,43 @@
+/*****************************************************************************
+ *   sim_temp.c:  MAX6576 temperature sensor model
+ *
+******************************************************************************/
+
+/*
+ * The sensor outputs a square wave with a period proportional to the
+ * absolute temperature: 10 us/K with TS1 = TS0 = 0 (base board default).
+ */
+
+#include "sim.h"
+
+#define TEMP_PORT 0
+#define TEMP_PIN  2
+
+#define TEMP_US_PER_K 10.0
+
+static double celsius = 22.0;
+static uint8_t level = 0;
+static sim_event_t event;
+
+static void toggle(sim_event_t *ev)
+{
+    uint64_t halfPeriod = (uint64_t)((celsius + 273.15) * TEMP_US_PER_K / 2);
+
+    level = !level;
+    sim_gpioInput(TEMP_PORT, TEMP_PIN, level);
+
+    sim_schedule(ev, sim_now() + halfPeriod);
+}
+
+void sim_max6576Init(void)
+{
+    sim_gpioInput(TEMP_PORT, TEMP_PIN, level);
+
+    event.fire = toggle;
+    sim_schedule(&event, sim_now() + 1);
+}
+
+void sim_max6576Set(double c)
+{
+    celsius = c;
+}
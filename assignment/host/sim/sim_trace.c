@@ -0,0 +1,269 @@
+/*****************************************************************************
+ *   sim_trace.c:  Input devices and trace replay
+ *
+******************************************************************************/
+
+/*
+ * A trace is a text file with one timed stimulus per line, times in ms
+ * from reset and in increasing order. '#' starts a comment.
+ *
+ *   <ms> temp <celsius>
+ *   <ms> light <lux>
+ *   <ms> acc <x g> <y g> <z g>
+ *   <ms> button sw3|sw4
+ *   <ms> joystick up|down|left|right|center
+ *   <ms> rotary <steps> [ms/step]   (negative: anti-clockwise)
+ *   <ms> expect acc sampling|idle   (MMA7455 in measurement mode or not)
+ *   <ms> end
+ *
+ * A failed expect is reported on stderr and makes firmware_sim exit with
+ * a failure.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+#include "sim.h"
+
+/* how long a button or joystick direction is held */
+#define PRESS_US 100000
+
+/* one rotary detent is a full Gray code cycle from idle high (pull-ups),
+   A/B change a quarter of the step apart: A falls, B falls, A rises,
+   B rises (clockwise) */
+#define ROTARY_STEP_MS 50
+
+/******************************************************************************
+ * Joystick
+ *****************************************************************************/
+
+static const struct
+{
+    const char *name;
+    uint8_t port;
+    uint8_t pin;
+} joyPins[] = {
+    { "center", BOARD_PORT(JOY_CENTER), BOARD_PIN(JOY_CENTER) },
+    { "down",   BOARD_PORT(JOY_DOWN),   BOARD_PIN(JOY_DOWN) },
+    { "right",  BOARD_PORT(JOY_RIGHT),  BOARD_PIN(JOY_RIGHT) },
+    { "up",     BOARD_PORT(JOY_UP),     BOARD_PIN(JOY_UP) },
+    { "left",   BOARD_PORT(JOY_LEFT),   BOARD_PIN(JOY_LEFT) },
+};
+
+#define NUM_JOY (sizeof(joyPins) / sizeof(joyPins[0]))
+
+static sim_event_t joyRelease[NUM_JOY];
+
+static void joyUp(sim_event_t *ev)
+{
+    uint32_t i = (uint32_t)(uintptr_t)ev->arg;
+
+    sim_gpioInput(joyPins[i].port, joyPins[i].pin, 1);
+}
+
+void sim_inputJoystick(const char *dir)
+{
+    uint32_t i;
+
+    for (i = 0; i < NUM_JOY; i++) {
+        if (strcmp(dir, joyPins[i].name) == 0) {
+            sim_gpioInput(joyPins[i].port, joyPins[i].pin, 0);
+
+            joyRelease[i].fire = joyUp;
+            joyRelease[i].arg = (void *)(uintptr_t)i;
+            sim_schedule(&joyRelease[i], sim_now() + PRESS_US);
+            return;
+        }
+    }
+
+    fprintf(stderr, "sim: unknown joystick direction '%s'\n", dir);
+}
+
+/******************************************************************************
+ * Buttons: SW3 on P2.10 (EINT0), SW4 on P2.11 (EINT1)
+ *****************************************************************************/
+
+void sim_inputButton(uint8_t sw)
+{
+    uint8_t eint = (sw == 3) ? 0 : 1;
+
+    /* edge sensitive, falling edge */
+    LPC_SC->EXTINT |= 1 << eint;
+    sim_irqRaise(eint == 0 ? EINT0_IRQn : EINT1_IRQn);
+}
+
+/******************************************************************************
+ * Rotary switch, P0.24 / P0.25
+ *****************************************************************************/
+
+static int32_t rotarySteps = 0;
+static uint32_t rotaryPhaseUs = ROTARY_STEP_MS * 1000 / 4;
+static uint8_t rotaryPhase = 0;
+static sim_event_t rotaryEvent;
+
+static void rotaryFire(sim_event_t *ev)
+{
+    /* clockwise: A (P0.24) leads, both pins on the same port */
+    uint8_t port = BOARD_PORT(ROTARY_A);
+    uint8_t first = rotarySteps > 0 ? BOARD_PIN(ROTARY_A) : BOARD_PIN(ROTARY_B);
+    uint8_t second = rotarySteps > 0 ? BOARD_PIN(ROTARY_B) : BOARD_PIN(ROTARY_A);
+
+    switch (rotaryPhase) {
+    case 0:
+        sim_gpioInput(port, first, 0);
+        break;
+    case 1:
+        sim_gpioInput(port, second, 0);
+        break;
+    case 2:
+        sim_gpioInput(port, first, 1);
+        break;
+    default:
+        sim_gpioInput(port, second, 1);
+        rotarySteps += rotarySteps > 0 ? -1 : 1;
+        rotaryPhase = 0;
+        if (rotarySteps != 0) {
+            sim_schedule(ev, sim_now() + rotaryPhaseUs);
+        }
+        return;
+    }
+
+    rotaryPhase++;
+    sim_schedule(ev, sim_now() + rotaryPhaseUs);
+}
+
+void sim_inputRotary(int8_t steps, uint32_t stepMs)
+{
+    if (rotarySteps == 0 && steps != 0) {
+        rotaryPhase = 0;
+        rotaryPhaseUs = stepMs * 1000 / 4;
+        rotaryEvent.fire = rotaryFire;
+        sim_schedule(&rotaryEvent, sim_now());
+    }
+    rotarySteps += steps;
+}
+
+/******************************************************************************
+ * Trace replay
+ *****************************************************************************/
+
+static FILE *trace = NULL;
+static uint32_t lineNo = 0;
+static sim_event_t traceEvent;
+
+static char pending[256];
+static uint8_t havePending = 0;
+static uint32_t failures = 0;
+
+static void expect(const char *what, const char *state)
+{
+    uint8_t sampling = sim_mma7455Sampling();
+
+    if (strcmp(what, "acc") != 0
+            || (strcmp(state, "sampling") != 0 && strcmp(state, "idle") != 0)) {
+        fprintf(stderr, "sim: trace line %u: unknown expect %s %s\n",
+                lineNo, what, state);
+        failures++;
+        return;
+    }
+
+    if (sampling != (strcmp(state, "sampling") == 0)) {
+        fprintf(stderr, "sim: trace line %u at %.3f s: expected acc %s, "
+                "is %s\n", lineNo, sim_now() / 1e6, state,
+                sampling ? "sampling" : "idle");
+        failures++;
+    }
+}
+
+static void apply(const char *line)
+{
+    char cmd[16];
+    char arg[16];
+    char arg2[16];
+    double a, b, c;
+
+    if (sscanf(line, "%*u %15s", cmd) != 1) {
+        return;
+    }
+
+    if (strcmp(cmd, "temp") == 0 && sscanf(line, "%*u %*s %lf", &a) == 1) {
+        sim_max6576Set(a);
+    } else if (strcmp(cmd, "light") == 0
+            && sscanf(line, "%*u %*s %lf", &a) == 1) {
+        sim_isl29003Set((uint32_t)a);
+    } else if (strcmp(cmd, "acc") == 0
+            && sscanf(line, "%*u %*s %lf %lf %lf", &a, &b, &c) == 3) {
+        sim_mma7455Set(a, b, c);
+    } else if (strcmp(cmd, "button") == 0
+            && sscanf(line, "%*u %*s %15s", arg) == 1) {
+        sim_inputButton(strcmp(arg, "sw3") == 0 ? 3 : 4);
+    } else if (strcmp(cmd, "joystick") == 0
+            && sscanf(line, "%*u %*s %15s", arg) == 1) {
+        sim_inputJoystick(arg);
+    } else if (strcmp(cmd, "rotary") == 0
+            && sscanf(line, "%*u %*s %lf", &a) == 1) {
+        if (sscanf(line, "%*u %*s %*f %lf", &b) != 1 || b < 1) {
+            b = ROTARY_STEP_MS;
+        }
+        sim_inputRotary((int8_t)a, (uint32_t)b);
+    } else if (strcmp(cmd, "expect") == 0
+            && sscanf(line, "%*u %*s %15s %15s", arg, arg2) == 2) {
+        expect(arg, arg2);
+    } else if (strcmp(cmd, "end") == 0) {
+        sim_finish();
+    } else {
+        fprintf(stderr, "sim: trace line %u not understood: %s",
+                lineNo, line);
+    }
+}
+
+/* read the next stimulus and schedule it */
+static void traceNext(sim_event_t *ev)
+{
+    char *p;
+    unsigned long ms;
+
+    if (havePending) {
+        havePending = 0;
+        apply(pending);
+    }
+
+    while (fgets(pending, sizeof(pending), trace) != NULL) {
+        lineNo++;
+
+        p = strchr(pending, '#');
+        if (p != NULL) {
+            *p = '\n';
+            p[1] = '\0';
+        }
+        if (sscanf(pending, "%lu", &ms) != 1) {
+            continue;
+        }
+
+        havePending = 1;
+        sim_schedule(ev, ms * 1000 > sim_now() ? ms * 1000 : sim_now());
+        return;
+    }
+
+    fclose(trace);
+    trace = NULL;
+}
+
+uint32_t sim_traceFailures(void)
+{
+    return failures;
+}
+
+int sim_traceOpen(const char *path)
+{
+    trace = fopen(path, "r");
+    if (trace == NULL) {
+        return -1;
+    }
+
+    traceEvent.fire = traceNext;
+    traceNext(&traceEvent);
+
+    return 0;
+}
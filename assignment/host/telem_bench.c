@@ -0,0 +1,188 @@
+/*****************************************************************************
+ *   telem_bench.c:  Host benchmark of the batched sample stream
+ *
+ *   Feeds one hour of 100 ms samples of three synthetic signals through
+ *   the TELEM_BATCH encoder and the frame layer, decodes the byte stream
+ *   again and compares every sample. Reports the wire size per sample
+ *   against one TELEM_RECORD frame per sample, and the encode cost.
+ *
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "telem.h"
+
+#define PERIOD_MS 100
+#define RUN_SAMPLES (60UL * 60UL * 1000UL / PERIOD_MS)
+
+/* frame with one TELEM_RECORD payload, see telem.c */
+#define RECORD_WIRE_LEN 18
+
+typedef void (*signal_t)(uint32_t i, telem_sample_t *s);
+
+static telem_sample_t sent[RUN_SAMPLES];
+static telem_sample_t received[RUN_SAMPLES];
+
+static uint8_t stream[RUN_SAMPLES * TELEM_FRAME_LEN(16)];
+static uint32_t streamLen;
+
+static uint32_t rnd(void)
+{
+    static uint32_t x = 2463534242u;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+/* board on a desk: slow temperature drift, steady light, sensor noise */
+static void quiet(uint32_t i, telem_sample_t *s)
+{
+    s->temp = 245 + (i / 600) % 5;
+    s->light = 300;
+    s->accX = (rnd() % 16 == 0) ? 1 : 0;
+    s->accY = 0;
+    s->accZ = 0;
+}
+
+/* carried around: everything moves a little every sample */
+static void busy(uint32_t i, telem_sample_t *s)
+{
+    static telem_sample_t w = { 250, 300, 0, 0, 0 };
+
+    w.temp += (int16_t)(rnd() % 3) - 1;
+    w.light += (uint16_t)((int32_t)(rnd() % 41) - 20);
+    w.accX = (int8_t)(rnd() % 21) - 10;
+    w.accY = (int8_t)(rnd() % 21) - 10;
+    w.accZ = (int8_t)(rnd() % 21) - 10;
+    *s = w;
+}
+
+/* worst case: unrelated full range values */
+static void noise(uint32_t i, telem_sample_t *s)
+{
+    s->temp = (int16_t)rnd();
+    s->light = (uint16_t)rnd();
+    s->accX = (int8_t)rnd();
+    s->accY = (int8_t)rnd();
+    s->accZ = (int8_t)rnd();
+}
+
+static int sameSamples(uint32_t count)
+{
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        if (sent[i].temp != received[i].temp
+                || sent[i].light != received[i].light
+                || sent[i].accX != received[i].accX
+                || sent[i].accY != received[i].accY
+                || sent[i].accZ != received[i].accZ) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void emit(telem_batch_t *b)
+{
+    streamLen += telem_encode(TELEM_BATCH, b->time, b->payload, b->len,
+            &stream[streamLen]);
+    telem_batchInit(b, PERIOD_MS);
+}
+
+/* split the stream at the delimiters and decode all batches */
+static uint32_t decodeStream(void)
+{
+    telem_frame_t f;
+    uint32_t start = 0;
+    uint32_t count = 0;
+    uint32_t period;
+    uint32_t i;
+    int n;
+
+    for (i = 0; i < streamLen; i++) {
+        if (stream[i] != 0) {
+            continue;
+        }
+
+        if (telem_decode(&stream[start], i - start, &f) != 0
+                || f.type != TELEM_BATCH
+                || f.time != count * PERIOD_MS) {
+            return count;
+        }
+
+        n = telem_batchDecode(f.payload, f.len, &period, &received[count],
+                RUN_SAMPLES - count);
+        if (n <= 0 || period != PERIOD_MS) {
+            return count;
+        }
+
+        count += n;
+        start = i + 1;
+    }
+
+    return count;
+}
+
+static int run(const char *name, signal_t signal)
+{
+    telem_batch_t batch;
+    struct timespec t0, t1;
+    uint32_t frames = 0;
+    uint32_t got;
+    uint32_t i;
+    double ns;
+    int ok;
+
+    for (i = 0; i < RUN_SAMPLES; i++) {
+        signal(i, &sent[i]);
+    }
+
+    streamLen = 0;
+    telem_batchInit(&batch, PERIOD_MS);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < RUN_SAMPLES; i++) {
+        if (telem_batchAdd(&batch, i * PERIOD_MS, &sent[i])) {
+            emit(&batch);
+            frames++;
+        }
+    }
+    if (batch.count > 0) {
+        emit(&batch);
+        frames++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+
+    got = decodeStream();
+    ok = (got == RUN_SAMPLES && sameSamples(got));
+
+    printf("  %-6s %6lu frames, %5.2f bytes/sample (%4.1f%% of records), "
+            "%5.1f ns/sample%s\n",
+            name, (unsigned long)frames, (double)streamLen / RUN_SAMPLES,
+            100.0 * streamLen / (RUN_SAMPLES * RECORD_WIRE_LEN),
+            ns / RUN_SAMPLES, ok ? "" : "  <-- MISMATCH");
+
+    return ok;
+}
+
+int main(void)
+{
+    int ok = 1;
+
+    printf("%lu samples, %u ms apart, %u byte record frame\n",
+            (unsigned long)RUN_SAMPLES, PERIOD_MS, RECORD_WIRE_LEN);
+
+    ok &= run("quiet", quiet);
+    ok &= run("busy", busy);
+    ok &= run("noise", noise);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,223 @@
+/*****************************************************************************
+ *   telem_decode.c:  Host decoder for the UART3 telemetry frames
+ *
+ *   Reads the raw byte stream (XBee serial port, capture file or
+ *   firmware_sim output) and prints one line per frame. Gaps in the
+ *   sequence numbers and frames failing the CRC are reported inline,
+ *   totals go to stderr at the end.
+ *
+ *     telem_decode [-v] [file]    (default: stdin)
+ *
+ *   -v prints every sample of a TELEM_BATCH block instead of a summary.
+ *
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "telem.h"
+
+/* longer runs between delimiters can't be frames */
+#define MAX_ENCODED (TELEM_FRAME_LEN(TELEM_MAX_PAYLOAD))
+
+static unsigned long frames = 0;
+static unsigned long bad = 0;
+static unsigned long lost = 0;
+
+static int verbose = 0;
+
+static int haveSeq = 0;
+static uint8_t lastSeq = 0;
+
+static void printRecord(const telem_record_t *rec)
+{
+    printf("T-%.1f_L-%u_AX.%d_AY.%d_AZ.%d%s%s\n",
+            rec->temp / 10.0, rec->light, rec->accX, rec->accY, rec->accZ,
+            (rec->flags & TELEM_FLAG_FIRE) ? " FIRE" : "",
+            (rec->flags & TELEM_FLAG_DARK) ? " DARK" : "");
+}
+
+static void printSample(const telem_sample_t *s)
+{
+    printf("T-%.1f_L-%u_AX.%d_AY.%d_AZ.%d\n",
+            s->temp / 10.0, s->light, s->accX, s->accY, s->accZ);
+}
+
+static void printBatch(const telem_frame_t *f)
+{
+    telem_sample_t samples[TELEM_MAX_PAYLOAD];
+    uint32_t period;
+    int n;
+    int i;
+
+    n = telem_batchDecode(f->payload, f->len, &period, samples,
+            TELEM_MAX_PAYLOAD);
+    if (n <= 0) {
+        printf("bad batch (%u bytes)\n", (unsigned)f->len);
+        return;
+    }
+
+    printf("batch of %d, %lu ms, %u bytes\n", n, (unsigned long)period,
+            (unsigned)f->len);
+    if (verbose) {
+        for (i = 0; i < n; i++) {
+            printf("        %9.3f   ", (f->time + i * period) / 1000.0);
+            printSample(&samples[i]);
+        }
+    } else {
+        printf("        first     ");
+        printSample(&samples[0]);
+        printf("        last      ");
+        printSample(&samples[n - 1]);
+    }
+}
+
+static void printLog(const telem_frame_t *f)
+{
+    telem_record_t rec;
+    uint32_t time;
+    uint32_t n;
+    uint32_t i;
+
+    if (f->len < 2 || (f->len - 2) % TELEM_LOG_ENTRY_LEN != 0) {
+        printf("bad log block (%u bytes)\n", (unsigned)f->len);
+        return;
+    }
+
+    n = (f->len - 2) / TELEM_LOG_ENTRY_LEN;
+    printf("log of %lu, boot %u\n", (unsigned long)n,
+            f->payload[0] | (f->payload[1] << 8));
+    for (i = 0; i < n; i++) {
+        telem_unpackLogEntry(&f->payload[2 + i * TELEM_LOG_ENTRY_LEN], &time,
+                &rec);
+        printf("        %9.3f   ", time / 1000.0);
+        printRecord(&rec);
+    }
+}
+
+static void printEvent(const telem_frame_t *f)
+{
+    if (f->len == 0) {
+        printf("empty event\n");
+        return;
+    }
+
+    switch (f->payload[0]) {
+    case TELEM_EVENT_MONITOR:
+        printf("MONITOR mode\n");
+        break;
+    case TELEM_EVENT_CEMS:
+        printf("CEMS request from %.*s\n", (int)f->len - 1, &f->payload[1]);
+        break;
+    default:
+        printf("event %u\n", f->payload[0]);
+        break;
+    }
+}
+
+static void handleFrame(const uint8_t *data, uint32_t len)
+{
+    telem_frame_t f;
+    telem_record_t rec;
+
+    if (len == 0) {
+        return;
+    }
+
+    if (len > MAX_ENCODED || telem_decode(data, len, &f) != 0) {
+        bad++;
+        printf("# bad frame (%u bytes)\n", (unsigned)len);
+        return;
+    }
+
+    frames++;
+    if (haveSeq && f.seq != (uint8_t)(lastSeq + 1)) {
+        lost += (uint8_t)(f.seq - lastSeq - 1);
+        printf("# %u frame(s) lost\n", (uint8_t)(f.seq - lastSeq - 1));
+    }
+    haveSeq = 1;
+    lastSeq = f.seq;
+
+    printf("%03u %9.3f ", f.seq, f.time / 1000.0);
+
+    switch (f.type) {
+    case TELEM_RECORD:
+        if (f.len != TELEM_RECORD_LEN) {
+            printf("record with %u bytes\n", (unsigned)f.len);
+            break;
+        }
+        telem_unpackRecord(f.payload, &rec);
+        printRecord(&rec);
+        break;
+    case TELEM_EVENT:
+        printEvent(&f);
+        break;
+    case TELEM_BATCH:
+        printBatch(&f);
+        break;
+    case TELEM_LOG:
+        printLog(&f);
+        break;
+    case TELEM_TEXT:
+        printf("| %.*s\n", (int)f.len, (const char *)f.payload);
+        break;
+    default:
+        printf("type %u, %u bytes\n", f.type, (unsigned)f.len);
+        break;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    uint8_t buf[MAX_ENCODED];
+    uint32_t len = 0;
+    uint8_t overflow = 0;
+    int c;
+    int arg = 1;
+
+    if (arg < argc && strcmp(argv[arg], "-v") == 0) {
+        verbose = 1;
+        arg++;
+    }
+    if (arg + 1 < argc || (arg < argc && argv[arg][0] == '-')) {
+        fprintf(stderr, "usage: %s [-v] [file]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (arg < argc) {
+        in = fopen(argv[arg], "rb");
+        if (in == NULL) {
+            perror(argv[arg]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    while ((c = getc(in)) != EOF) {
+        if (c != 0) {
+            if (len < sizeof(buf)) {
+                buf[len++] = c;
+            } else {
+                overflow = 1;
+            }
+            continue;
+        }
+
+        if (overflow) {
+            bad++;
+            printf("# bad frame (too long)\n");
+        } else {
+            handleFrame(buf, len);
+        }
+        len = 0;
+        overflow = 0;
+    }
+
+    if (len > 0) {
+        printf("# %u trailing bytes\n", (unsigned)len);
+    }
+
+    fprintf(stderr, "%lu frames, %lu bad, %lu lost\n", frames, bad, lost);
+
+    return (bad == 0 && lost == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,281 @@
+/*****************************************************************************
+ *   filter.c:  Fixed-point filter stages for the sensor channels
+ *
+******************************************************************************/
+
+/*
+ * A channel is a table of stages (filter_stage_t) run in order on every
+ * sample by filter_process, usually followed by a hysteresis comparator
+ * (filter_hyst) taking the alarm decision, e.g.
+ *
+ *   static filter_stage_t tempFilter[] = {
+ *       FILTER_MEDIAN(5),
+ *       FILTER_EMA(FILTER_Q15(0.25)),
+ *   };
+ *
+ * - median: the ring buffer keeps the arrival order and a second array
+ *   the same samples sorted. A new sample replaces the oldest one in the
+ *   sorted array by shifting it into place, so a sample costs at most
+ *   FILTER_MEDIAN_MAX moves, with no sorting and independent of the rate.
+ * - EMA: y += alpha * (x - y), alpha in Q15, y in Q16 so slow averages
+ *   (small alpha) don't stall on the integer rounding.
+ * - decimation: the mean of every factor samples; the stages after it
+ *   only see every factor-th sample.
+ *
+ * The first sample primes the median window and the EMA, so a channel
+ * starts at its first value instead of ramping up from 0.
+ *
+ * No floating point, no heap. Each channel must be used from one context.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "filter.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define Q16_ONE (1L << 16)
+#define Q16_HALF (1L << 15)
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Forget the samples of a channel, the next sample primes it again
+ *
+ * Params:
+ *   [in] stages - the stages of the channel
+ *   [in] numStages - number of stages
+ *
+ *****************************************************************************/
+void filter_reset(filter_stage_t *stages, uint8_t numStages)
+{
+    uint8_t i;
+
+    for (i = 0; i < numStages; i++) {
+        switch (stages[i].type) {
+        case FILTER_TYPE_MEDIAN:
+            stages[i].u.median.primed = 0;
+            break;
+        case FILTER_TYPE_EMA:
+            stages[i].u.ema.primed = 0;
+            break;
+        case FILTER_TYPE_DECIMATE:
+            stages[i].u.decim.count = 0;
+            stages[i].u.decim.sum = 0;
+            break;
+        }
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Run a sample through the stages of a channel
+ *
+ * Params:
+ *   [in] stages - the stages of the channel
+ *   [in] numStages - number of stages
+ *   [in/out] value - the sample, replaced by the filtered value
+ *
+ * Returns:
+ *   1 if value is a new output, 0 if a decimation stage kept the sample
+ *
+ *****************************************************************************/
+uint8_t filter_process(filter_stage_t *stages, uint8_t numStages,
+        int32_t *value)
+{
+    uint8_t i;
+
+    for (i = 0; i < numStages; i++) {
+        switch (stages[i].type) {
+        case FILTER_TYPE_MEDIAN:
+            *value = filter_median(&stages[i].u.median, *value);
+            break;
+        case FILTER_TYPE_EMA:
+            *value = filter_ema(&stages[i].u.ema, *value);
+            break;
+        case FILTER_TYPE_DECIMATE:
+            if (!filter_decimate(&stages[i].u.decim, value)) {
+                return 0;
+            }
+            break;
+        }
+    }
+
+    return 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Moving median stage
+ *
+ * Params:
+ *   [in] m - the stage
+ *   [in] x - the sample
+ *
+ * Returns:
+ *   median of the last m->size samples
+ *
+ *****************************************************************************/
+int32_t filter_median(filter_median_t *m, int32_t x)
+{
+    int32_t old;
+    uint8_t size = m->size;
+    uint8_t i;
+
+    if (size == 0 || size > FILTER_MEDIAN_MAX) {
+        return x;
+    }
+
+    if (!m->primed) {
+        for (i = 0; i < size; i++) {
+            m->ring[i] = x;
+            m->sorted[i] = x;
+        }
+        m->pos = 0;
+        m->primed = 1;
+        return x;
+    }
+
+    old = m->ring[m->pos];
+    m->ring[m->pos] = x;
+    if (++m->pos == size) {
+        m->pos = 0;
+    }
+
+    /* the slot of the oldest sample becomes a hole moving towards x */
+    i = 0;
+    while (m->sorted[i] != old) {
+        i++;
+    }
+    while (i > 0 && m->sorted[i - 1] > x) {
+        m->sorted[i] = m->sorted[i - 1];
+        i--;
+    }
+    while (i < size - 1 && m->sorted[i + 1] < x) {
+        m->sorted[i] = m->sorted[i + 1];
+        i++;
+    }
+    m->sorted[i] = x;
+
+    return m->sorted[size / 2];
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Exponential moving average stage
+ *
+ * Params:
+ *   [in] e - the stage
+ *   [in] x - the sample
+ *
+ * Returns:
+ *   the average, rounded
+ *
+ *****************************************************************************/
+int32_t filter_ema(filter_ema_t *e, int32_t x)
+{
+    int64_t xq = (int64_t)x * Q16_ONE;
+
+    if (!e->primed) {
+        e->y = xq;
+        e->primed = 1;
+    } else {
+        /* arithmetic shift, rounds towards minus infinity */
+        e->y += ((xq - e->y) * e->alpha) >> 15;
+    }
+
+    return (int32_t)((e->y + Q16_HALF) >> 16);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Decimation stage
+ *
+ * Params:
+ *   [in] d - the stage
+ *   [in/out] x - the sample, replaced by the mean of the last d->factor
+ *                samples when 1 is returned
+ *
+ * Returns:
+ *   1 every d->factor samples, otherwise 0
+ *
+ *****************************************************************************/
+uint8_t filter_decimate(filter_decim_t *d, int32_t *x)
+{
+    int32_t n = (d->factor == 0) ? 1 : d->factor;
+
+    d->sum += *x;
+    if (++d->count < n) {
+        return 0;
+    }
+
+    /* rounded to the nearest, halves away from 0 */
+    *x = (d->sum >= 0) ? (d->sum + n / 2) / n : (d->sum - n / 2) / n;
+    d->sum = 0;
+    d->count = 0;
+
+    return 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Set the thresholds of a comparator, see filter_hyst_t. The comparator
+ *    starts inactive.
+ *
+ * Params:
+ *   [in] h - the comparator
+ *   [in] enter - threshold to become active
+ *   [in] exit - threshold to become inactive
+ *
+ *****************************************************************************/
+void filter_hystInit(filter_hyst_t *h, int32_t enter, int32_t exit)
+{
+    h->enter = enter;
+    h->exit = exit;
+    h->active = 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Feed a value to a comparator
+ *
+ * Params:
+ *   [in] h - the comparator
+ *   [in] x - the value
+ *
+ * Returns:
+ *   1 while active, otherwise 0
+ *
+ *****************************************************************************/
+uint8_t filter_hyst(filter_hyst_t *h, int32_t x)
+{
+    if (h->enter >= h->exit) {
+        if (!h->active && x >= h->enter) {
+            h->active = 1;
+        } else if (h->active && x <= h->exit) {
+            h->active = 0;
+        }
+    } else {
+        if (!h->active && x <= h->enter) {
+            h->active = 1;
+        } else if (h->active && x >= h->exit) {
+            h->active = 0;
+        }
+    }
+
+    return h->active;
+}
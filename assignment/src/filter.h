@@ -0,0 +1,94 @@
+/*****************************************************************************
+ *   filter.h:  Header file for the fixed-point sensor filter stages
+ *
+******************************************************************************/
+#ifndef __FILTER_H
+#define __FILTER_H
+
+#include <stdint.h>
+
+/* longest moving median window */
+#define FILTER_MEDIAN_MAX 9
+
+/* EMA coefficient in Q15, for constants only, e.g. FILTER_Q15(0.25) */
+#define FILTER_Q15(x) ((uint16_t)((x) * 32768.0 + 0.5))
+
+/* stage initializers for filter_stage_t tables */
+#define FILTER_MEDIAN(n) \
+    { .type = FILTER_TYPE_MEDIAN, .u.median = { .size = (n) } }
+#define FILTER_EMA(a) \
+    { .type = FILTER_TYPE_EMA, .u.ema = { .alpha = (a) } }
+#define FILTER_DECIMATE(n) \
+    { .type = FILTER_TYPE_DECIMATE, .u.decim = { .factor = (n) } }
+
+typedef enum
+{
+    FILTER_TYPE_MEDIAN,     /* median of the last size samples */
+    FILTER_TYPE_EMA,        /* exponential moving average */
+    FILTER_TYPE_DECIMATE    /* mean of every factor samples */
+} filter_type_t;
+
+typedef struct
+{
+    uint8_t size;           /* odd, up to FILTER_MEDIAN_MAX */
+    uint8_t pos;
+    uint8_t primed;
+    int32_t ring[FILTER_MEDIAN_MAX];    /* in arrival order */
+    int32_t sorted[FILTER_MEDIAN_MAX];
+} filter_median_t;
+
+typedef struct
+{
+    uint16_t alpha;         /* Q15 weight of a new sample, 1..32768 */
+    uint8_t primed;
+    int64_t y;              /* Q16 */
+} filter_ema_t;
+
+typedef struct
+{
+    uint8_t factor;
+    uint8_t count;
+    int32_t sum;
+} filter_decim_t;
+
+typedef struct
+{
+    filter_type_t type;
+    union
+    {
+        filter_median_t median;
+        filter_ema_t ema;
+        filter_decim_t decim;
+    } u;
+} filter_stage_t;
+
+/*
+ * Comparator with separate enter and exit thresholds. With enter >= exit
+ * it becomes active at or above enter and inactive at or below exit
+ * (e.g. over temperature), with enter < exit it becomes active at or
+ * below enter and inactive at or above exit (e.g. darkness).
+ */
+typedef struct
+{
+    int32_t enter;
+    int32_t exit;
+    uint8_t active;
+} filter_hyst_t;
+
+
+void filter_reset(filter_stage_t *stages, uint8_t numStages);
+uint8_t filter_process(filter_stage_t *stages, uint8_t numStages,
+        int32_t *value);
+
+int32_t filter_median(filter_median_t *m, int32_t x);
+int32_t filter_ema(filter_ema_t *e, int32_t x);
+uint8_t filter_decimate(filter_decim_t *d, int32_t *x);
+
+void filter_hystInit(filter_hyst_t *h, int32_t enter, int32_t exit);
+uint8_t filter_hyst(filter_hyst_t *h, int32_t x);
+
+
+#endif /* end __FILTER_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
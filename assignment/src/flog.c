@@ -0,0 +1,380 @@
+/*****************************************************************************
+ *   flog.c:  Ring log of fixed size entries in the dataflash
+ *
+******************************************************************************/
+
+/*
+ * Entries are collected in a RAM page image and written one full page at
+ * a time with a single page program through the chip's buffer
+ * (flash_writeAsync, built-in erase). Pages are written in sequence
+ * around the ring, so every page is erased once per lap.
+ *
+ * Every page starts with a header
+ *
+ *   magic (2) | boot (2) | seq (4) | count (1) | 0xFF | CRC-16 (2)
+ *
+ * (little endian, CRC over the first 10 bytes and the entries). The
+ * sequence number counts pages since the log was created and page seq is
+ * always stored at ring position seq % FLOG_NUM_PAGES. flog_init only
+ * reads the headers to find the newest page; a page torn by a power loss
+ * keeps its place in the sequence but fails the CRC when it is read.
+ *
+ * The boot number is one more than the newest page's at start-up, so
+ * entries (which are timestamped relative to reset) can be told apart
+ * across power cycles.
+ *
+ * Entries not yet written (at most two pages) are lost on power loss.
+ * All functions must be called from task context.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <string.h>
+#include "flog.h"
+#include "flash.h"
+#include "telem.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define MAGIC 0x4C47
+
+#define NO_PAGE 0xFF
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static uint8_t enabled = 0;
+static uint16_t pageSize = 0;
+
+static uint16_t boot = 0;
+static uint32_t oldest = 0;
+
+/* two page images: one being filled, one waiting for / being written */
+static uint8_t ram[2][FLOG_PAGE_DATA];
+static uint8_t fill = 0;
+static uint8_t count = 0;
+static uint32_t fillSeq = 0;
+
+static uint8_t pending = NO_PAGE;
+static uint32_t pendingSeq = 0;
+
+/* set from the DMA interrupt when the page has been sent to the chip */
+static volatile uint8_t writing = 0;
+static volatile uint32_t writeResult = 0;
+
+static uint32_t dropped = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return get16(p) | ((uint32_t)get16(&p[2]) << 16);
+}
+
+static uint32_t pageOffset(uint32_t seq)
+{
+    return (FLOG_FIRST_PAGE + seq % FLOG_NUM_PAGES) * pageSize;
+}
+
+/* header fields of a page image, 0 if it doesn't belong to the ring */
+static int parseHeader(const uint8_t *hdr, uint32_t position,
+        uint32_t *seq, uint16_t *pageBoot)
+{
+    *seq = get32(&hdr[4]);
+    *pageBoot = get16(&hdr[2]);
+
+    return get16(&hdr[0]) == MAGIC && *seq != 0xFFFFFFFF
+            && *seq % FLOG_NUM_PAGES == position
+            && hdr[8] <= FLOG_ENTRIES_PER_PAGE;
+}
+
+static void seal(uint8_t *p, uint32_t seq, uint8_t n)
+{
+    put16(&p[0], MAGIC);
+    put16(&p[2], boot);
+    put16(&p[4], seq & 0xFFFF);
+    put16(&p[6], seq >> 16);
+    p[8] = n;
+    p[9] = 0xFF;
+    put16(&p[10], telem_crc16(&p[FLOG_HEADER_SIZE], n * FLOG_ENTRY_SIZE,
+            telem_crc16(p, 10, 0xFFFF)));
+}
+
+/* hand a full page image over to flog_service, if it is free */
+static void handOver(void)
+{
+    if (count < FLOG_ENTRIES_PER_PAGE || pending != NO_PAGE) {
+        return;
+    }
+
+    seal(ram[fill], fillSeq, count);
+    pending = fill;
+    pendingSeq = fillSeq;
+
+    fill ^= 1;
+    fillSeq++;
+    count = 0;
+}
+
+static void copyPage(const uint8_t *p, uint32_t seq, uint8_t n,
+        flog_page_t *page)
+{
+    page->seq = seq;
+    page->boot = boot;
+    page->count = n;
+    memcpy(page->entries, &p[FLOG_HEADER_SIZE], n * FLOG_ENTRY_SIZE);
+}
+
+static void written(uint32_t len)
+{
+    writeResult = len;
+    writing = 0;
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the flash and find the end of the log by reading the
+ *    page headers. SSP1 must have been initialized.
+ *
+ * Returns:
+ *   0 on success, -1 if there is no usable flash (logging disabled)
+ *
+ *****************************************************************************/
+int flog_init (void)
+{
+    uint8_t hdr[FLOG_HEADER_SIZE];
+    uint32_t seq;
+    uint32_t newest = 0;
+    uint32_t first = 0xFFFFFFFF;
+    uint16_t pageBoot;
+    uint16_t lastBoot = 0;
+    uint8_t found = 0;
+    uint32_t i;
+
+    if (!flash_init()) {
+        return (-1);
+    }
+
+    pageSize = flash_getPageSize();
+    if (pageSize < FLOG_PAGE_DATA) {
+        return (-1);
+    }
+
+    for (i = 0; i < FLOG_NUM_PAGES; i++) {
+        if (flash_read(hdr, pageOffset(i), FLOG_HEADER_SIZE)
+                != FLOG_HEADER_SIZE || !parseHeader(hdr, i, &seq, &pageBoot)) {
+            continue;
+        }
+
+        if (!found || seq > newest) {
+            newest = seq;
+            lastBoot = pageBoot;
+        }
+        if (seq < first) {
+            first = seq;
+        }
+        found = 1;
+    }
+
+    boot = found ? lastBoot + 1 : 0;
+    fillSeq = found ? newest + 1 : 0;
+    oldest = found ? first : 0;
+    count = 0;
+    enabled = 1;
+
+    return (0);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Append an entry. When a page is full it is handed to flog_service.
+ *
+ * Params:
+ *   [in] entry - FLOG_ENTRY_SIZE bytes
+ *
+ * Returns:
+ *   0 if the entry was stored, -1 if logging is disabled or both page
+ *   images are full
+ *
+ *****************************************************************************/
+int flog_append(const uint8_t *entry)
+{
+    if (!enabled || count == FLOG_ENTRIES_PER_PAGE) {
+        dropped++;
+        return (-1);
+    }
+
+    memcpy(&ram[fill][FLOG_HEADER_SIZE + count * FLOG_ENTRY_SIZE], entry,
+            FLOG_ENTRY_SIZE);
+    count++;
+
+    handOver();
+    flog_service();
+
+    return (0);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Write a full page when the flash is ready. Called by flog_append;
+ *    call it periodically as well so a page held back by a busy flash
+ *    gets written.
+ *
+ *****************************************************************************/
+void flog_service(void)
+{
+    if (!enabled || writing) {
+        return;
+    }
+
+    if (writeResult != 0) {
+        /* the page has been transferred, the chip programs it */
+        writeResult = 0;
+        pending = NO_PAGE;
+
+        if (pendingSeq >= oldest + FLOG_NUM_PAGES) {
+            oldest = pendingSeq - FLOG_NUM_PAGES + 1;
+        }
+
+        /* the other image may have filled up in the meantime */
+        handOver();
+    }
+
+    if (pending == NO_PAGE || flash_isBusy()) {
+        return;
+    }
+
+    writing = 1;
+    if (flash_writeAsync(ram[pending], pageOffset(pendingSeq),
+            FLOG_PAGE_DATA, written) != FLOG_PAGE_DATA) {
+        writing = 0;
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Sequence number of the oldest page that may still be stored
+ *
+ *****************************************************************************/
+uint32_t flog_oldest(void)
+{
+    return oldest;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Sequence number of the page being filled in RAM. Pages before it
+ *    are in the flash (or about to be written).
+ *
+ *****************************************************************************/
+uint32_t flog_current(void)
+{
+    return fillSeq;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Read a page of the log. The page being filled and the page waiting
+ *    to be written are returned from RAM. Pages in the flash can't be read
+ *    while a page is programmed.
+ *
+ * Params:
+ *   [in] seq - page sequence number, flog_oldest() .. flog_current()
+ *   [out] page - the page
+ *
+ * Returns:
+ *   0 on success, FLOG_BUSY if the flash is busy, -1 if the page isn't in
+ *   the log or is corrupt
+ *
+ *****************************************************************************/
+int flog_readPage(uint32_t seq, flog_page_t *page)
+{
+    uint8_t p[FLOG_PAGE_DATA];
+    uint32_t pageSeq;
+    uint16_t pageBoot;
+
+    if (!enabled || seq < oldest || seq > fillSeq) {
+        return (-1);
+    }
+
+    if (seq == fillSeq) {
+        copyPage(ram[fill], seq, count, page);
+        return (0);
+    }
+    if (pending != NO_PAGE && seq == pendingSeq) {
+        copyPage(ram[pending], seq, FLOG_ENTRIES_PER_PAGE, page);
+        return (0);
+    }
+
+    if (flash_isBusy()) {
+        return FLOG_BUSY;
+    }
+
+    if (flash_read(p, pageOffset(seq), FLOG_PAGE_DATA) != FLOG_PAGE_DATA
+            || !parseHeader(p, seq % FLOG_NUM_PAGES, &pageSeq, &pageBoot)
+            || pageSeq != seq) {
+        return (-1);
+    }
+
+    if (telem_crc16(&p[FLOG_HEADER_SIZE], p[8] * FLOG_ENTRY_SIZE,
+            telem_crc16(p, 10, 0xFFFF)) != get16(&p[10])) {
+        return (-1);
+    }
+
+    page->seq = seq;
+    page->boot = pageBoot;
+    page->count = p[8];
+    memcpy(page->entries, &p[FLOG_HEADER_SIZE], p[8] * FLOG_ENTRY_SIZE);
+
+    return (0);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the boot number entries are logged with
+ *
+ *****************************************************************************/
+uint16_t flog_getBoot(void)
+{
+    return boot;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of entries that couldn't be logged
+ *
+ *****************************************************************************/
+uint32_t flog_getDropped(void)
+{
+    return dropped;
+}
@@ -0,0 +1,48 @@
+/*****************************************************************************
+ *   flog.h:  Header file for the dataflash ring log
+ *
+******************************************************************************/
+#ifndef __FLOG_H
+#define __FLOG_H
+
+#include <stdint.h>
+
+/* bytes per entry, see TELEM_LOG_ENTRY_LEN */
+#define FLOG_ENTRY_SIZE 12
+
+/* bytes used per flash page, the same for 256 and 264 byte pages */
+#define FLOG_PAGE_DATA 256
+#define FLOG_HEADER_SIZE 12
+#define FLOG_ENTRIES_PER_PAGE \
+    ((FLOG_PAGE_DATA - FLOG_HEADER_SIZE) / FLOG_ENTRY_SIZE)
+
+/* flog_readPage: the flash is programming a page, read again later */
+#define FLOG_BUSY 1
+
+/* flash pages used by the ring */
+#define FLOG_FIRST_PAGE 0
+#define FLOG_NUM_PAGES 4096
+
+typedef struct
+{
+    uint32_t seq;           /* page sequence number */
+    uint16_t boot;          /* boot the entries were logged in */
+    uint8_t count;
+    uint8_t entries[FLOG_ENTRIES_PER_PAGE * FLOG_ENTRY_SIZE];
+} flog_page_t;
+
+
+int flog_init (void);
+int flog_append(const uint8_t *entry);
+void flog_service(void);
+uint32_t flog_oldest(void);
+uint32_t flog_current(void);
+int flog_readPage(uint32_t seq, flog_page_t *page);
+uint16_t flog_getBoot(void);
+uint32_t flog_getDropped(void);
+
+
+#endif /* end __FLOG_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
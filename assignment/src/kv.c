@@ -0,0 +1,453 @@
+/*****************************************************************************
+ *   kv.c:  Log structured key/value store in the EEPROM
+ *
+******************************************************************************/
+
+/*
+ * The EEPROM is split into two areas. The active area starts with a header
+ *
+ *   'K' | 'V' | generation (2)
+ *
+ * followed by a log of records
+ *
+ *   key | len | value (len) | CRC-16 (2)
+ *
+ * (little endian, CRC over the generation, key, len and value). A changed
+ * value is appended as a new record, the last record of a key wins. When
+ * the area is full the live values are written to the other area with the
+ * next generation, header last, so a power loss leaves one of the areas
+ * intact. Records of an older generation left in the area fail the CRC and
+ * end the log.
+ *
+ * All values are cached in RAM by kv_init: kv_get never touches the EEPROM.
+ * kv_set only updates the cache, kv_service writes the changed keys in one
+ * batch in the background (eeprom_write_async). All functions must be
+ * called from task context.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <string.h>
+#include "kv.h"
+#include "eeprom.h"
+#include "telem.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define HEADER_SIZE 4
+#define RECORD_OVERHEAD 4
+
+#define NO_AREA 0xFF
+
+/* one EEPROM block per read */
+#define READ_CHUNK 256
+
+typedef enum
+{
+    IDLE,
+    APPEND,         /* records written at the end of the log */
+    RECORDS,        /* compaction, records written to the other area */
+    HEADER          /* compaction, header written */
+} phase_t;
+
+typedef struct
+{
+    uint8_t key;
+    uint8_t len;
+    uint8_t dirty;
+    uint8_t value[KV_MAX_VALUE];
+} entry_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static entry_t entries[KV_MAX_KEYS];
+static uint8_t numEntries = 0;
+
+static uint8_t area = NO_AREA;
+static uint16_t gen = 0;
+static uint16_t tail = 0;
+
+/* all values have to be written to a fresh area */
+static uint8_t rewrite = 0;
+
+/* data of the write in progress */
+static uint8_t image[KV_AREA_SIZE];
+static uint16_t imageLen = 0;
+static uint8_t target = 0;
+static phase_t phase = IDLE;
+
+static volatile uint8_t writing = 0;
+static volatile int32_t writeStatus = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static uint16_t get16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static int validHeader(const uint8_t *hdr)
+{
+    return hdr[0] == 'K' && hdr[1] == 'V';
+}
+
+static uint16_t recordCrc(uint16_t recGen, const uint8_t *rec)
+{
+    uint8_t g[2];
+
+    put16(g, recGen);
+    return telem_crc16(rec, 2 + rec[1], telem_crc16(g, 2, 0xFFFF));
+}
+
+static entry_t *find(uint8_t key)
+{
+    uint8_t i;
+
+    for (i = 0; i < numEntries; i++) {
+        if (entries[i].key == key) {
+            return &entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* the record at p, 0 if it ends the log */
+static uint16_t parseRecord(const uint8_t *p, uint16_t space)
+{
+    entry_t *e;
+    uint8_t len = p[1];
+
+    if (space < RECORD_OVERHEAD || p[0] == 0x00 || p[0] == 0xFF
+            || len > KV_MAX_VALUE || space < RECORD_OVERHEAD + len
+            || recordCrc(gen, p) != get16(&p[2 + len])) {
+        return 0;
+    }
+
+    e = find(p[0]);
+    if (e == NULL) {
+        if (numEntries == KV_MAX_KEYS) {
+            return 0;
+        }
+        e = &entries[numEntries++];
+        e->key = p[0];
+    }
+
+    e->len = len;
+    e->dirty = 0;
+    memcpy(e->value, &p[2], len);
+
+    return RECORD_OVERHEAD + len;
+}
+
+static uint16_t putRecord(uint8_t *p, uint16_t recGen, entry_t *e)
+{
+    p[0] = e->key;
+    p[1] = e->len;
+    memcpy(&p[2], e->value, e->len);
+    put16(&p[2 + e->len], recordCrc(recGen, p));
+    e->dirty = 0;
+
+    return RECORD_OVERHEAD + e->len;
+}
+
+static void written(int32_t status, void *arg)
+{
+    writeStatus = status;
+    writing = 0;
+}
+
+static void startWrite(uint16_t offset, uint8_t *buf, uint16_t len,
+        phase_t next)
+{
+    phase = next;
+    writing = 1;
+    if (eeprom_write_async(buf, offset, len, written, NULL) != len) {
+        writing = 0;
+        writeStatus = -1;
+    }
+}
+
+/* write all values to the other area */
+static void compact(void)
+{
+    uint16_t len = HEADER_SIZE;
+    uint8_t i;
+
+    target = (area == NO_AREA) ? 0 : area ^ 1;
+    rewrite = 0;
+
+    image[0] = 'K';
+    image[1] = 'V';
+    put16(&image[2], gen + 1);
+
+    for (i = 0; i < numEntries; i++) {
+        len += putRecord(&image[len], gen + 1, &entries[i]);
+    }
+    imageLen = len;
+
+    if (imageLen > HEADER_SIZE) {
+        startWrite(target * KV_AREA_SIZE + HEADER_SIZE, &image[HEADER_SIZE],
+                imageLen - HEADER_SIZE, RECORDS);
+    } else {
+        startWrite(target * KV_AREA_SIZE, image, HEADER_SIZE, HEADER);
+    }
+}
+
+/* append the changed values to the log */
+static void append(void)
+{
+    uint16_t len = 0;
+    uint8_t i;
+
+    for (i = 0; i < numEntries; i++) {
+        if (entries[i].dirty) {
+            len += RECORD_OVERHEAD + entries[i].len;
+        }
+    }
+
+    if (len == 0) {
+        return;
+    }
+    if (tail + len > KV_AREA_SIZE) {
+        compact();
+        return;
+    }
+
+    len = 0;
+    for (i = 0; i < numEntries; i++) {
+        if (entries[i].dirty) {
+            len += putRecord(&image[len], gen, &entries[i]);
+        }
+    }
+    imageLen = len;
+
+    startWrite(area * KV_AREA_SIZE + tail, image, imageLen, APPEND);
+}
+
+/* bookkeeping after a background write has ended */
+static void writeEnded(void)
+{
+    phase_t done = phase;
+
+    phase = IDLE;
+
+    if (writeStatus < 0) {
+        /* the log may end in a torn record, start over */
+        rewrite = 1;
+        return;
+    }
+
+    switch (done) {
+    case APPEND:
+        tail += imageLen;
+        break;
+    case RECORDS:
+        startWrite(target * KV_AREA_SIZE, image, HEADER_SIZE, HEADER);
+        break;
+    case HEADER:
+        area = target;
+        gen++;
+        tail = imageLen;
+        break;
+    default:
+        break;
+    }
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Load the values from the EEPROM into the cache. I2C2 must have been
+ *    initialized. Without a valid area the store starts empty and is
+ *    formatted by the first kv_service call after a kv_set.
+ *
+ * Returns:
+ *   0 on success, -1 if the EEPROM couldn't be read
+ *
+ *****************************************************************************/
+int kv_init (void)
+{
+    uint8_t hdr[2][HEADER_SIZE];
+    uint16_t off;
+    uint16_t n;
+    uint8_t i;
+
+    numEntries = 0;
+    area = NO_AREA;
+    tail = HEADER_SIZE;
+    phase = IDLE;
+
+    for (i = 0; i < 2; i++) {
+        if (eeprom_read(hdr[i], i * KV_AREA_SIZE, HEADER_SIZE)
+                != HEADER_SIZE) {
+            return (-1);
+        }
+    }
+
+    if (validHeader(hdr[0]) && validHeader(hdr[1])) {
+        area = (int16_t)(get16(&hdr[1][2]) - get16(&hdr[0][2])) > 0 ? 1 : 0;
+    } else if (validHeader(hdr[0])) {
+        area = 0;
+    } else if (validHeader(hdr[1])) {
+        area = 1;
+    } else {
+        return (0);
+    }
+    gen = get16(&hdr[area][2]);
+
+    for (off = 0; off < KV_AREA_SIZE; off += READ_CHUNK) {
+        if (eeprom_read(&image[off], area * KV_AREA_SIZE + off, READ_CHUNK)
+                != READ_CHUNK) {
+            area = NO_AREA;
+            return (-1);
+        }
+    }
+
+    while ((n = parseRecord(&image[tail], KV_AREA_SIZE - tail)) > 0) {
+        tail += n;
+    }
+
+    return (0);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get a value from the cache
+ *
+ * Params:
+ *   [in] key - key
+ *   [out] value - the value, at most len bytes are copied
+ *   [in] len - size of the value buffer
+ *
+ * Returns:
+ *   length of the stored value or -1 if the key isn't stored
+ *
+ *****************************************************************************/
+int kv_get(uint8_t key, void *value, uint8_t len)
+{
+    entry_t *e = find(key);
+
+    if (e == NULL) {
+        return (-1);
+    }
+
+    memcpy(value, e->value, len < e->len ? len : e->len);
+
+    return e->len;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Set a value. The cache is updated at once, the EEPROM by the next
+ *    kv_service call.
+ *
+ * Params:
+ *   [in] key - key, 1..254
+ *   [in] value - the value
+ *   [in] len - length of the value, up to KV_MAX_VALUE
+ *
+ * Returns:
+ *   0 on success, -1 for an invalid key or length or if all KV_MAX_KEYS
+ *   keys are used
+ *
+ *****************************************************************************/
+int kv_set(uint8_t key, const void *value, uint8_t len)
+{
+    entry_t *e;
+
+    if (key == 0x00 || key == 0xFF || len > KV_MAX_VALUE) {
+        return (-1);
+    }
+
+    e = find(key);
+    if (e == NULL) {
+        if (numEntries == KV_MAX_KEYS) {
+            return (-1);
+        }
+        e = &entries[numEntries++];
+        e->key = key;
+    } else if (e->len == len && memcmp(e->value, value, len) == 0) {
+        return (0);
+    }
+
+    e->len = len;
+    memcpy(e->value, value, len);
+    e->dirty = 1;
+
+    return (0);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Write the values changed since the last call, in the background.
+ *    Call it periodically; changes made while a write is in progress are
+ *    written by a later call.
+ *
+ *****************************************************************************/
+void kv_service(void)
+{
+    if (writing) {
+        return;
+    }
+
+    if (phase != IDLE) {
+        writeEnded();
+        if (phase != IDLE) {
+            return;
+        }
+    }
+
+    if (rewrite || area == NO_AREA) {
+        if (rewrite || kv_isDirty()) {
+            compact();
+        }
+        return;
+    }
+
+    append();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Check if there are values not yet written to the EEPROM
+ *
+ *****************************************************************************/
+uint8_t kv_isDirty(void)
+{
+    uint8_t i;
+
+    if (rewrite || phase != IDLE) {
+        return 1;
+    }
+
+    for (i = 0; i < numEntries; i++) {
+        if (entries[i].dirty) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,31 @@
+/*****************************************************************************
+ *   kv.h:  Header file for the EEPROM key/value store
+ *
+******************************************************************************/
+#ifndef __KV_H
+#define __KV_H
+
+#include <stdint.h>
+
+/* keys 1..254, values up to KV_MAX_VALUE bytes */
+#define KV_MAX_KEYS 16
+#define KV_MAX_VALUE 16
+
+/* the EEPROM is split into two areas, one of them holds the log */
+#define KV_AREA_SIZE 512
+
+/* records collected between two kv_service calls */
+#define KV_PENDING_SIZE 64
+
+
+int kv_init (void);
+int kv_get(uint8_t key, void *value, uint8_t len);
+int kv_set(uint8_t key, const void *value, uint8_t len);
+void kv_service(void);
+uint8_t kv_isDirty(void);
+
+
+#endif /* end __KV_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
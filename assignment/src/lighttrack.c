@@ -0,0 +1,191 @@
+/*****************************************************************************
+ *   lighttrack.c:  Light level tracker for the ISL29003 threshold interrupt
+ *
+******************************************************************************/
+
+/*
+ * Instead of two fixed thresholds (dark / not dark) the sensor's interrupt
+ * window is moved with the light: after every interrupt the lux is read
+ * and the window is centred on it again, windowPercent of the lux (at
+ * least minWindow) either way. A slow change therefore interrupts once
+ * per window instead of never, and each window crossing is kept in the
+ * history.
+ *
+ * The window never reaches across the darkness level, so the change into
+ * or out of darkness always interrupts:
+ *
+ * - light: lo is at least dark, darkness starts below dark.
+ * - dark: hi is at most dark + hysteresis, darkness ends above it.
+ *
+ * Pure computation, the caller reads the sensor and programs the window
+ * (lighttrack_getWindow), from task context.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "lighttrack.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define HISTORY_MASK (LIGHTTRACK_HISTORY - 1)
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static void setWindow(lighttrack_t *t, uint32_t lux)
+{
+    uint32_t half = lux * t->cfg.windowPercent / 100;
+    uint32_t edge;
+
+    if (half < t->cfg.minWindow) {
+        half = t->cfg.minWindow;
+    }
+
+    t->lo = (lux > half) ? lux - half : 0;
+    t->hi = lux + half;
+
+    if (t->dark) {
+        edge = t->cfg.dark + t->cfg.hysteresis;
+        if (t->hi > edge) {
+            t->hi = edge;
+        }
+    } else if (t->lo < t->cfg.dark) {
+        t->lo = t->cfg.dark;
+    }
+
+    if (t->hi > t->cfg.maxLux) {
+        t->hi = t->cfg.maxLux;
+    }
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize a tracker. The first lux value sets the darkness state.
+ *
+ * Params:
+ *   [in] t - the tracker
+ *   [in] cfg - levels, copied
+ *
+ *****************************************************************************/
+void lighttrack_init (lighttrack_t *t, const lighttrack_config_t *cfg)
+{
+    t->cfg = *cfg;
+    t->primed = 0;
+    t->dark = 0;
+    t->lo = 0;
+    t->hi = cfg->maxLux;
+    t->head = 0;
+    t->count = 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Feed a lux value read after a threshold interrupt (or at start up),
+ *    update the darkness state and move the window to it.
+ *
+ * Params:
+ *   [in] t - the tracker
+ *   [in] lux - the light level
+ *   [in] time - ms, kept in the history
+ *
+ * Returns:
+ *   1 if the darkness state has changed or was set by the first value,
+ *   otherwise 0
+ *
+ *****************************************************************************/
+uint8_t lighttrack_update(lighttrack_t *t, uint32_t lux, uint32_t time)
+{
+    uint8_t dark;
+    uint8_t changed;
+
+    if (t->primed && t->dark) {
+        dark = (lux <= t->cfg.dark + t->cfg.hysteresis);
+    } else {
+        dark = (lux < t->cfg.dark);
+    }
+    changed = (!t->primed || dark != t->dark);
+
+    t->primed = 1;
+    t->dark = dark;
+    setWindow(t, lux);
+
+    t->history[t->head & HISTORY_MASK].time = time;
+    t->history[t->head & HISTORY_MASK].lux = lux;
+    t->head++;
+    if (t->count < LIGHTTRACK_HISTORY) {
+        t->count++;
+    }
+
+    return changed;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the darkness state
+ *
+ * Returns:
+ *   1 while dark, 0 otherwise (also before the first value)
+ *
+ *****************************************************************************/
+uint8_t lighttrack_isDark(const lighttrack_t *t)
+{
+    return t->dark;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the thresholds to program, the sensor should interrupt when the
+ *    light leaves [lo, hi]
+ *
+ * Params:
+ *   [in] t - the tracker
+ *   [out] lo - low threshold, lux
+ *   [out] hi - high threshold, lux
+ *
+ *****************************************************************************/
+void lighttrack_getWindow(const lighttrack_t *t, uint32_t *lo, uint32_t *hi)
+{
+    *lo = t->lo;
+    *hi = t->hi;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Copy the latest lux values, oldest first
+ *
+ * Params:
+ *   [in] t - the tracker
+ *   [out] entries - time and lux of each update
+ *   [in] max - size of entries
+ *
+ * Returns:
+ *   number of entries copied
+ *
+ *****************************************************************************/
+uint8_t lighttrack_getHistory(const lighttrack_t *t,
+        lighttrack_entry_t *entries, uint8_t max)
+{
+    uint8_t n = (t->count < max) ? t->count : max;
+    uint8_t first = (uint8_t)(t->head - n);
+    uint8_t i;
+
+    for (i = 0; i < n; i++) {
+        entries[i] = t->history[(uint8_t)(first + i) & HISTORY_MASK];
+    }
+
+    return n;
+}
@@ -0,0 +1,53 @@
+/*****************************************************************************
+ *   lighttrack.h:  Header file for the light level tracker
+ *
+******************************************************************************/
+#ifndef __LIGHTTRACK_H
+#define __LIGHTTRACK_H
+
+#include <stdint.h>
+
+/* number of kept light changes, must be a power of 2 */
+#define LIGHTTRACK_HISTORY 16
+
+/* levels in lux */
+typedef struct
+{
+    uint32_t dark;          /* darkness below this */
+    uint32_t hysteresis;    /* and until above dark + hysteresis */
+    uint8_t windowPercent;  /* half width of the window, % of the lux */
+    uint32_t minWindow;     /* smallest half width */
+    uint32_t maxLux;        /* highest threshold of the sensor range */
+} lighttrack_config_t;
+
+typedef struct
+{
+    uint32_t time;          /* ms */
+    uint32_t lux;
+} lighttrack_entry_t;
+
+typedef struct
+{
+    lighttrack_config_t cfg;
+    uint8_t primed;
+    uint8_t dark;
+    uint32_t lo;            /* window: the sensor interrupts outside */
+    uint32_t hi;
+    lighttrack_entry_t history[LIGHTTRACK_HISTORY];
+    uint8_t head;
+    uint8_t count;
+} lighttrack_t;
+
+
+void lighttrack_init (lighttrack_t *t, const lighttrack_config_t *cfg);
+uint8_t lighttrack_update(lighttrack_t *t, uint32_t lux, uint32_t time);
+uint8_t lighttrack_isDark(const lighttrack_t *t);
+void lighttrack_getWindow(const lighttrack_t *t, uint32_t *lo, uint32_t *hi);
+uint8_t lighttrack_getHistory(const lighttrack_t *t,
+        lighttrack_entry_t *entries, uint8_t max);
+
+
+#endif /* end __LIGHTTRACK_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
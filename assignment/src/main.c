@@ -1,4 +1,4 @@
-#include "stdio.h"
+#include "string.h"
 
 #include "lpc17xx_pinsel.h"
 #include "lpc17xx_gpio.h"
@@ -6,6 +6,7 @@
 #include "lpc17xx_ssp.h"
 #include "lpc17xx_timer.h"
 #include "lpc17xx_uart.h"
+#include "lpc17xx_gpdma.h"
 
 #include "joystick.h"
 #include "pca9532.h"
@@ -15,6 +16,23 @@
 #include "led7seg.h"
 #include "light.h"
 #include "temp.h"
+#include "ssp1.h"
+#include "i2c2.h"
+#include "uart3.h"
+#include "sched.h"
+#include "prof.h"
+#include "telem.h"
+#include "flog.h"
+#include "board.h"
+#include "kv.h"
+#include "gpioint.h"
+#include "rotary.h"
+#include "ui.h"
+#include "screens.h"
+#include "fmt.h"
+#include "filter.h"
+#include "motion.h"
+#include "lighttrack.h"
 
 #define DEBUG_HEAT
 
@@ -26,59 +44,60 @@
 #endif
 
 #define SCREEN_CHG_DELAY 500
-#define TEMP_HIGH_WARNING 450
-
-/*** Message strings ***/
-unsigned char* STR_CEMS_ALERT = "User %s has requested for assistance.\r\n";
-unsigned char* STR_FIRE_ALERT = "Fire was Detected.\r\n";
-unsigned char* STR_DARK_ALERT = "Movement in darkness was Detected.\r\n";
-unsigned char* STR_MONITOR_MODE = "Entering MONITOR Mode.\r\n";
-
-unsigned char* STR_ARROW_CHAR = ">";
-unsigned char* STR_BLANK_CHAR = " ";
-
-unsigned char* STR_INTVALUES_OUTPUT = "%d    ";
-unsigned char* STR_UINTVALUES_OUTPUT = "%u    ";
-unsigned char* STR_FLOATVALUES_OUTPUT = "%.2f   ";
-
-unsigned char* STR_FUNC_TITLE = "Select Function:";
-unsigned char* STR_FUNC_1 = "Siren       ";
-unsigned char* STR_FUNC_2 = "SOS to CEMS ";
-unsigned char* STR_FUNC_3 = "Lights      ";
-unsigned char* STR_FUNC_4 = "$$$$$       ";
-
-unsigned char* STR_MAIN_LUX = "LUX : ";
-unsigned char* STR_MAIN_TEMP = "TEMP: ";
-unsigned char* STR_MAIN_ACCX = "ACCX: ";
-unsigned char* STR_MAIN_ACCY = "ACCY: ";
-unsigned char* STR_MAIN_ACCZ = "ACCZ: ";
-unsigned char* STR_MAIN_TITLE = "MODE: MONITOR";
-
-unsigned char* STR_BIG_TEMP = "TEMP   ";
-unsigned char* STR_BIG_LIGHT = "LUX   ";
-unsigned char* STR_BIG_ACCX = "ACC X  ";
-unsigned char* STR_BIG_ACCY = "ACC Y  ";
-unsigned char* STR_BIG_ACCZ = "ACC Z  ";
-
-/*** device/user id ***/
-const char* userID = "EE2024";
+#define BIG_FONT 2				//scale of the values on the single value pages
+#define FIELD_WIDTH 7			//characters, covers the longest value drawn before
+#define JOY_DEBOUNCE 30		//ms between accepted joystick presses
+#define ROTARY_DEBOUNCE 2		//ms, A bouncing at its rising edge
+#define ROTARY_DETENTS_PER_PAGE 4
+#define ROTARY_FAST 40			//detents/s, from here a detent counts 2
+#define ROTARY_VERY_FAST 100	//detents/s, from here a detent counts 4
+#define SAMPLE_PERIOD 100
+#define TEMP_HYSTERESIS 10		//0.1 deg C, the warning clears this far below
+#define MOTION_THRESHOLD 6		//counts (64 per g) of jerk or tilt for movement
+#define MOTION_QUIET 3			//counts of jerk, below it for MOTION_HOLD samples: stopped
+#define MOTION_HOLD 125			//samples, 1s at 125 Hz
+#define MOTION_WAKE 3			//counts (16 per g) from rest to wake the sampling
+#define LIGHT_HYSTERESIS 10		//lux, darkness ends this far above the threshold
+#define LIGHT_WINDOW 25			//%, the light sensor interrupts beyond +-25% of the lux
+#define LIGHT_MIN_WINDOW 8		//lux, 2 steps of the 8 bit sensor thresholds
+#define LIGHT_MAX_LUX 972		//highest threshold in the 1000 lux range
+#define LIGHT_RETRY 2			//ms until a busy light sensor transfer is retried
+#define BACKFILL_RETRY 5		//ms until a log page is read again while the flash is busy
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+/*** configuration defaults, the values are kept in the EEPROM ***/
+#define TEMP_HIGH_WARNING 450	//0.1 deg C
+#define LIGHT_DARK_THRESHOLD 50	//lux
+#define USER_ID "EE2024"
+
+/*** lightTask steps, queued on I2C2 in this order ***/
+#define LIGHT_STEP_READ 0x01
+#define LIGHT_STEP_LO 0x02
+#define LIGHT_STEP_HI 0x04
+#define LIGHT_STEP_CLEAR 0x08
+
+/*** configuration keys ***/
+#define CFG_TEMP_HIGH 1
+#define CFG_LIGHT_DARK 2
+#define CFG_USER_ID 3
+
+/*** configuration, loaded from the EEPROM by load_config ***/
+static int32_t temp_high_warning = TEMP_HIGH_WARNING;
+static uint16_t light_dark_threshold = LIGHT_DARK_THRESHOLD;
+static char userID[KV_MAX_VALUE + 1] = USER_ID;
 
 /*** LED params ***/
 static uint8_t rgbLED_mask = 0x00;
 static uint8_t rgbLED_set = 0x03;
-static volatile uint8_t rgbLED_flag = 0;
 
 static uint32_t led_set = 0x0001; //for array
-static volatile uint8_t led_array_flag = 0;
 static uint8_t leds_toggle_flag = 0;
 
 /*** timer params ***/
-volatile uint32_t msTicks = 0; // counter for 1ms SysTicks
-uint32_t oldSampleTicks = 0;
 uint32_t oldSpeakerTicks = 0;
 
 /*** 7-segment display params ***/
-volatile uint8_t sseg_flag = 0;
 unsigned int timer2count = 0;
 int monitor_symbols[] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A',
 		'B', 'C', 'D', 'E', 'F' };
@@ -90,12 +109,21 @@ uint8_t speaker_on_flag = 0;
 /*** ISL290003 light sensor params ***/
 uint32_t light_reading = 0;
 uint8_t movement_lowLight_flag = 0;
-volatile uint8_t detect_darkness_flag = 1; // 0 also means that darkness is detected
+static lighttrack_config_t lightConfig = {
+	LIGHT_DARK_THRESHOLD,		//from the configuration, see init_interrupts
+	LIGHT_HYSTERESIS,
+	LIGHT_WINDOW,
+	LIGHT_MIN_WINDOW,
+	LIGHT_MAX_LUX,
+};
+static lighttrack_t lightTrack;		//darkness and the window of the threshold interrupt
+static volatile uint8_t light_irq = 0;		//the light left the window, read it
+static volatile uint8_t light_luxReady = 0;	//light_lux read for lightTrack
+static volatile uint32_t light_lux = 0;
 
 /*** MMA7455 accelerometer sensor params ***/
 int8_t accInitX, accInitY, accInitZ; //for offsetting
 int8_t accX, accY, accZ;
-int8_t accOldX, accOldY, accOldZ;
 volatile uint8_t movement_detected_flag = 0;
 volatile uint32_t lastMotionDetectedTicks = 0;
 
@@ -103,80 +131,79 @@ volatile uint32_t lastMotionDetectedTicks = 0;
 int32_t temperature_reading = 0;
 uint8_t temp_high_flag = 0;
 
+/*** alarm filters: a single noisy sample must not raise a warning ***/
+static filter_stage_t tempFilter[] = {
+	FILTER_MEDIAN(3),				//per measurement, about 0.5s apart
+	FILTER_EMA(FILTER_Q15(0.5)),
+};
+static filter_hyst_t tempAlarm;
+static filter_stage_t accFilter[3][1] = {	//per axis, at the DRDY rate
+	{ FILTER_MEDIAN(3) },
+	{ FILTER_MEDIAN(3) },
+	{ FILTER_MEDIAN(3) },
+};
+
+/*** motion detector, fed with the filtered accelerometer samples ***/
+static const motion_config_t motionConfig = {
+	MOTION_THRESHOLD,
+	MOTION_QUIET,
+	MOTION_HOLD,
+	FILTER_Q15(1.0 / 1024),		//gravity baseline, about 8s at 125 Hz
+};
+static motion_t motion;
+static uint8_t acc_waiting = 0;	//sampling stopped, the MMA7455 watches for motion
+
 /*** stable, monitor mode flag ***/
 volatile uint8_t mode_flag = 0; //1 - monitor, 0 - passive
 
-/*** flag to sample light and accelerometer sensors ***/
-volatile uint8_t sample_sensors_flag = 0;
-
 /*** OLED params ***/
-volatile uint32_t lastScreenChangeTicks = 0;
-volatile uint8_t oled_page_state = 0; //0 - default, 1 - temp, 2 - lux, 3 - accX, 4- accY, 5- accZ, 6 - funcMode
-volatile uint8_t reinit_screen_flag = 0;
-uint8_t tempStr[80];
-
-/*** Function mode params ***/
-volatile uint8_t func_mode_selection = 0; //0 - Siren, 1 - SOS to CEMS, 2 - Lights, 3 - $$$$$
-volatile uint8_t func_change_flag = 0; //init to 1 to set 1st arrow
-volatile uint8_t func_execute_flag = 0;
-
-/*** UART params ***/
-volatile uint8_t send_message_flag = 0;
+uint32_t lastScreenChangeTicks = 0;
 
 /*** Rotary Switch params ***/
-volatile uint8_t font_size = 2;
-volatile uint8_t rotary_flag_0 = 0;
-volatile uint8_t rotary_flag_1 = 0;
+int8_t rotary_detents = 0; //weighted detents towards the next page
+
+/*** 0.1s samples, sent in delta coded blocks ***/
+static telem_batch_t batch;
+volatile uint32_t light_sample = 0;
+
+/*** scheduler tasks ***/
+static sched_task_t modeTask;		//SW4 pressed, enter/leave monitor mode
+static sched_task_t secondTask;		//1s: 7 segment, sensors, telemetry
+static sched_task_t blinkTask;		//0.33s: RGB led warnings
+static sched_task_t sampleTask;		//0.1s: temperature and accelerometer
+static sched_task_t speakerTask;	//siren
+static sched_task_t uiTask;			//apply UI events, redraw changed fields
+static sched_task_t funcTask;		//SW3 pressed
+static sched_task_t flushTask;		//push changed OLED columns
+static sched_task_t profTask;		//dump the profiler zones on UART3
+static sched_task_t backfillTask;	//SW3 in passive mode, send the flash log
+static sched_task_t inputTask;		//joystick and rotary edges queued by EINT3
+static sched_task_t wakeTask;		//the accelerometer detected motion
+static sched_task_t lightTask;		//light sensor interrupt: read, move the window
+
+/*** profiler zones ***/
+PROF_ZONE(dmaZone, "DMA_IRQ");
+PROF_ZONE(uart3Zone, "UART3_IRQ");
+PROF_ZONE(i2c2Zone, "I2C2_IRQ");
+PROF_ZONE(ritZone, "RIT_IRQ");
+PROF_ZONE(eint0Zone, "EINT0_IRQ");
+PROF_ZONE(eint1Zone, "EINT1_IRQ");
+PROF_ZONE(eint3Zone, "EINT3_IRQ");
+PROF_ZONE(uiZone, "ui_service");
+PROF_ZONE(sampleZone, "sample_sensors");
 
 void rgbLED_controller(void);
 void sseg_controller(void);
 void prep_passiveMode();
+void send_event(uint8_t code, const char* text);
+void send_batch(void);
+void sample_sensors(void);
+void notify_cems(void);
 
 /*** protocols initialisers ***/
-static void init_GPIO(void) {
-	PINSEL_CFG_Type PinCfg;
-
-	/* Init Ext LED to GPIO PIO2_8 P2.8 */
-	PinCfg.Pinnum = 2;
-	PinCfg.Portnum = 2;
-	PINSEL_ConfigPin(&PinCfg);
-	GPIO_SetDir(2, (1 << 8), 1);
-
-	/* Initialize SW4 pin connect to GPIO P2.11 (EINT1)*/
-	PinCfg.Pinmode = 0;
-	PinCfg.OpenDrain = 0;
-	PinCfg.Portnum = 2;
-	PinCfg.Pinnum = 11;
-	PinCfg.Funcnum = 1;
-	PINSEL_ConfigPin(&PinCfg);
-	/* Initialize SW3 pin connect to GPIO P2.10 (EINT0) */
-	PinCfg.Pinnum = 10;
-	PINSEL_ConfigPin(&PinCfg);
-
-	/* ---- Speaker ------> */
-	GPIO_SetDir(0, 1 << 27, 1);
-	GPIO_SetDir(0, 1 << 28, 1);
-	GPIO_SetDir(2, 1 << 13, 1);
-
-	GPIO_ClearValue(0, 1 << 27); //LM4811-clk
-	GPIO_ClearValue(0, 1 << 28); //LM4811-up/dn
-	GPIO_ClearValue(2, 1 << 13); //LM4811-shutdn
-	/* <---- Speaker ------ */
-}
-
 //i2c enabler
 static void init_I2C2(void) {
-	PINSEL_CFG_Type PinCfg;
-
-	/* Initialize I2C2 pin connect P0.10 */
-	PinCfg.Funcnum = 2;
-	PinCfg.Pinnum = 10;
-	PinCfg.Portnum = 0;
-	PINSEL_ConfigPin(&PinCfg);
-	PinCfg.Pinnum = 11;
-	PINSEL_ConfigPin(&PinCfg);
-
-	// Initialize I2C2 peripheral
+	// Initialize I2C2 peripheral (pins P0.10/P0.11 set up by board_init)
 	I2C_Init(LPC_I2C2, 100000);
 
 	/* Enable I2C2 operation */
@@ -186,30 +213,14 @@ static void init_I2C2(void) {
 //ssp enabler
 static void init_SSP(void) {
 	SSP_CFG_Type SSP_ConfigStruct;
-	PINSEL_CFG_Type PinCfg;
 
 	/*
-	 * Initialize SPI pin connect
+	 * SPI pins set up by board_init
 	 * P0.7 - SCK;
 	 * P0.8 - MISO
 	 * P0.9 - MOSI
-	 * P2.2 - SSEL - used as GPIO
+	 * chip selects (P0.6 OLED, P2.2 7-segment/flash) used as GPIO
 	 */
-	PinCfg.Funcnum = 2;
-	PinCfg.OpenDrain = 0;
-	PinCfg.Pinmode = 0;
-	PinCfg.Portnum = 0;
-	PinCfg.Pinnum = 7;
-	PINSEL_ConfigPin(&PinCfg);
-	PinCfg.Pinnum = 8;
-	PINSEL_ConfigPin(&PinCfg);
-	PinCfg.Pinnum = 9;
-	PINSEL_ConfigPin(&PinCfg);
-//	PinCfg.Funcnum = 0;
-	PinCfg.Portnum = 0;
-	PinCfg.Pinnum = 6;
-	PINSEL_ConfigPin(&PinCfg);
-
 	SSP_ConfigStructInit(&SSP_ConfigStruct);
 
 	// Initialize SSP peripheral with parameter given in structure above
@@ -219,17 +230,6 @@ static void init_SSP(void) {
 	SSP_Cmd(LPC_SSP1, ENABLE);
 }
 
-//uart3 pincfg
-static void pinsel_uart3(void) {
-	PINSEL_CFG_Type PinCfg;
-	PinCfg.Funcnum = 2;
-	PinCfg.Pinnum = 0;
-	PinCfg.Portnum = 0;
-	PINSEL_ConfigPin(&PinCfg);
-	PinCfg.Pinnum = 1;
-	PINSEL_ConfigPin(&PinCfg);
-}
-
 //uart enabler
 static void init_uart(void) {
 	UART_CFG_Type uartCfg;
@@ -238,111 +238,53 @@ static void init_uart(void) {
 	uartCfg.Parity = UART_PARITY_NONE;
 	uartCfg.Stopbits = UART_STOPBIT_1;
 
-	//init uart3
-	pinsel_uart3();
+	//init uart3 (pins P0.0/P0.1 set up by board_init)
 	UART_Init(LPC_UART3, &uartCfg);
 	UART_TxCmd(LPC_UART3, ENABLE);
 }
 
-//timer1 w/ 0.33s~ period
-static void init_timer1() {
-
-	// default value of PCLK = CCLK/4
-	// CCLK is derived from PLL0 output signal / (CCLKSEL + 1) [CCLKCFG register]
-
-	LPC_SC ->PCONP |= (1 << 2); /* Power ON Timer1 */
-
-	LPC_TIM1 ->MCR = (1 << 0) | (1 << 1); /* Clear COUNT on MR0 match and Generate Interrupt */
-	LPC_TIM1 ->PR = 0; /* Update COUNT every (value + 1) of PCLK  */
-	LPC_TIM1 ->MR0 = 8888888; /* Value of COUNT that triggers interrupts */
-	LPC_TIM1 ->TCR = (1 << 0); /* Start timer by setting the Counter Enable */
-
-	NVIC_EnableIRQ(TIMER1_IRQn); /* Enable Timer1 interrupt */
-
+//runs the queued SSP1 bus transactions (OLED, 7 segment, flash)
+void DMA_IRQHandler(void) {
+	PROF_BEGIN(dmaZone);
+	GPDMA_IntHandler();
+	PROF_END(dmaZone);
 }
 
-//timer2 w/ 1s~ period
-static void init_timer2() {
-
-	// default value of PCLK = CCLK/4
-	// CCLK is derived from PLL0 output signal / (CCLKSEL + 1) [CCLKCFG register]
-
-	LPC_SC ->PCONP |= (1 << 22); /* Power ON Timer2 */
-
-	LPC_TIM2 ->MCR = (1 << 0) | (1 << 1); /* Clear COUNT on MR0 match and Generate Interrupt */
-	LPC_TIM2 ->PR = 0; /* Update COUNT every (value + 1) of PCLK  */
-	LPC_TIM2 ->MR0 = 26666666; /* Value of COUNT that triggers interrupts */
-	LPC_TIM2 ->TCR = (1 << 0); /* Start timer by setting the Counter Enable */
-
-	NVIC_EnableIRQ(TIMER2_IRQn); /* Enable Timer2 interrupt */
-
+//drains the UART3 transmit ring
+void UART3_IRQHandler(void) {
+	PROF_BEGIN(uart3Zone);
+	UART3_StdIntHandler();
+	PROF_END(uart3Zone);
 }
 
-void TIMER1_IRQHandler(void) {
-	unsigned int isrMask;
-
-	isrMask = LPC_TIM1 ->IR;
-	LPC_TIM1 ->IR = isrMask; /* Clear the Interrupt Bit by writing to the register */// bitwise not
-
-	rgbLED_flag = 1;
-
-	//slower, delay but much less likely to crash
-	if (rgbLED_flag
-			&& ((((rgbLED_mask & RGB_BLUE) >> 1))
-					|| ((rgbLED_mask & RGB_RED) >> 0))) {
-		rgbLED_controller();
-		rgbLED_flag = 0;
-	}
-
-	led_array_flag = 1;
+//runs the queued I2C2 bus transactions (light, acc, led array)
+void I2C2_IRQHandler(void) {
+	PROF_BEGIN(i2c2Zone);
+	I2C2_StdIntHandler();
+	PROF_END(i2c2Zone);
 }
 
-void TIMER2_IRQHandler(void) {
-	unsigned int isrMask;
-
-	isrMask = LPC_TIM2 ->IR;
-	LPC_TIM2 ->IR = isrMask; /* Clear the Interrupt Bit by writing to the register */// bitwise not
-
-	if (timer2count == 5 || timer2count == 10 || timer2count == 15) {
-		sample_sensors_flag = 1;
-	}
-
-	if (timer2count == 15) {
-		send_message_flag = 1;
-	}
-
-	sseg_flag = 1;
-}
-
-/*** SysTick helper functions ***/
-void SysTick_Handler(void) {
-	msTicks++;
+//wakes the scheduler from sleep
+void RIT_IRQHandler(void) {
+	PROF_BEGIN(ritZone);
+	sched_ritHandler();
+	PROF_END(ritZone);
 }
 
+/*** time helper functions ***/
 uint32_t getTicks(void) {
-	return msTicks;
-}
-
-/** light_sensor helper functions **/\
-
-//configure light sensors thresholds to detect any lighting
-void lightSensor_detectLight() {
-	light_setLoThreshold(0);
-	light_setHiThreshold(50);
-}
-
-//configures light sensor's HI and LO thresholds to detect low light conditions
-void lightSensor_detectDarkness() {
-	light_setLoThreshold(50);
-	light_setHiThreshold(972);
+	return sched_now();
 }
 
 //protocol init
 void init_protocols() {
 	//protocol init
 	init_I2C2();
+	i2c2_init();
 	init_SSP();
+	ssp1_init();
 	init_uart();
+	uart3_init();
 }
 
 //sensors, peripherals init
@@ -354,44 +296,66 @@ void init_peripherals() {
 	//SSP/GPIO devices init
 	led7seg_init(); //seven-segment display
 	oled_init(); //OLED display module
+	oled_setFlushMode(OLED_FLUSH_DEFERRED); //draw to framebuffer, push with oled_flush
 	//I2C sensors init
 	light_init(); //light sensor module
 	acc_init(); //accelerometer sensor
 }
 
+//light sensor left its window, the I2C2 transfers are done by lightTask
+static void light_irqHandler(void) {
+	light_irq = 1;
+	sched_post(&lightTask);
+}
+
+/*** EINT3 pins, sensor edges are handled in the interrupt (light only
+ *** posts lightTask), joystick and rotary edges are queued for inputTask ***/
+enum {
+	PIN_ACC_DRDY,
+	PIN_TEMP,
+	PIN_LIGHT_INT,
+	PIN_JOY_DOWN,
+	PIN_JOY_RIGHT,
+	PIN_JOY_CENTER,
+	PIN_JOY_UP,
+	PIN_JOY_LEFT,
+	PIN_ROTARY,
+	NUM_EINT3_PINS
+};
+
+#define EINT3_PIN(name, edges, debounce, handler) \
+	{ BOARD_PORT(name), BOARD_PIN(name), edges, debounce, handler }
+
+static const gpioint_pin_t eint3Pins[NUM_EINT3_PINS] = {
+	[PIN_ACC_DRDY] = EINT3_PIN(ACC_DRDY, GPIOINT_RISE, 0, acc_drdyHandler),
+	[PIN_TEMP] = EINT3_PIN(TEMP, GPIOINT_RISE, 0, temp_edgeHandler),
+	[PIN_LIGHT_INT] = EINT3_PIN(LIGHT_INT, GPIOINT_FALL, 0, light_irqHandler),
+	[PIN_JOY_DOWN] = EINT3_PIN(JOY_DOWN, GPIOINT_FALL, JOY_DEBOUNCE, NULL),
+	[PIN_JOY_RIGHT] = EINT3_PIN(JOY_RIGHT, GPIOINT_FALL, JOY_DEBOUNCE, NULL),
+	[PIN_JOY_CENTER] = EINT3_PIN(JOY_CENTER, GPIOINT_FALL, JOY_DEBOUNCE, NULL),
+	[PIN_JOY_UP] = EINT3_PIN(JOY_UP, GPIOINT_FALL, JOY_DEBOUNCE, NULL),
+	[PIN_JOY_LEFT] = EINT3_PIN(JOY_LEFT, GPIOINT_FALL, JOY_DEBOUNCE, NULL),
+	[PIN_ROTARY] = EINT3_PIN(ROTARY_A, GPIOINT_RISE, ROTARY_DEBOUNCE, NULL),
+};
+
+//called by the dispatcher when edges were queued
+static void post_inputTask(void) {
+	sched_post(&inputTask);
+}
+
 //interrupts init
 void init_interrupts() {
-	//interrupts init
-	init_timer1(); //0.33s period clock
-	init_timer2(); //1s period clock
-
-	//light sensor
-	LPC_GPIOINT ->IO2IntClr |= 1 << 5;
-	LPC_GPIOINT ->IO2IntEnF |= 1 << 5; // enable light interrupt
+	//GPIO interrupts and EINT edges of the pin map (board.h): light
+	//sensor, rotary switch, accelerometer DRDY, temperature sensor,
+	//joystick, SW3/SW4
+	gpioint_init(eint3Pins, NUM_EINT3_PINS, getTicks, post_inputTask);
+	board_enableInterrupts();
 	light_clearIrqStatus();
-	//configure default light threshold
-	lightSensor_detectDarkness();
-
-	// rotary switch pio1_0 P0.24, pio1_1 P0.25
-	LPC_GPIOINT ->IO0IntClr |= 1 << 24;
-	LPC_GPIOINT ->IO0IntClr |= 1 << 25;
-	LPC_GPIOINT ->IO0IntEnR |= 1 << 24;
-	LPC_GPIOINT ->IO0IntEnR |= 1 << 25;
-
-	// joystick interrupts
-	LPC_GPIOINT ->IO0IntEnF |= 1 << 15;
-	LPC_GPIOINT ->IO0IntEnF |= 1 << 16;
-	LPC_GPIOINT ->IO0IntEnF |= 1 << 17;
-	LPC_GPIOINT ->IO2IntEnF |= 1 << 3;
-	LPC_GPIOINT ->IO2IntEnF |= 1 << 4;
-
-	//configuring EINTx (0,1)
-	int * EXT_INT_Mode_Register = (int *) 0x400fc148;
-	*EXT_INT_Mode_Register |= 1 << 0; // edge sensitive
-	*EXT_INT_Mode_Register |= 1 << 1;
-	int * EXT_INT_Polarity_Register = (int *) 0x400fc14c;
-	*EXT_INT_Polarity_Register |= 0 << 0; // falling edge
-	*EXT_INT_Polarity_Register |= 0 << 1;
+	//first window around the current light, set by lightTask
+	lightConfig.dark = light_dark_threshold;
+	lighttrack_init(&lightTrack, &lightConfig);
+	light_irq = 1;
+	sched_post(&lightTask);
 
 	NVIC_ClearPendingIRQ(EINT0_IRQn);
 	NVIC_ClearPendingIRQ(EINT1_IRQn);
@@ -430,9 +394,9 @@ void speaker_controller() {
 		oldSpeakerTicks = getTicks();
 
 		if (on_note) {
-			GPIO_SetValue(0, 1 << 26);
+			GPIO_SetValue(BOARD_PORT(SPEAKER), BOARD_MASK(SPEAKER));
 		} else {
-			GPIO_ClearValue(0, 1 << 26);
+			GPIO_ClearValue(BOARD_PORT(SPEAKER), BOARD_MASK(SPEAKER));
 		}
 	}
 }
@@ -440,428 +404,354 @@ void speaker_controller() {
 //sets the Ext LED
 void extLED_controller() {
 	if (leds_toggle_flag) {
-		GPIO_SetValue(2, (1 << 8));
+		GPIO_SetValue(BOARD_PORT(EXT_LED), BOARD_MASK(EXT_LED));
 	} else {
-		GPIO_ClearValue(2, 1 << 8);
+		GPIO_ClearValue(BOARD_PORT(EXT_LED), BOARD_MASK(EXT_LED));
 	}
 }
 
 void EINT0_IRQHandler(void) {
-	if (oled_page_state == 6) {
-		func_execute_flag = 1;
-	}
+	PROF_BEGIN(eint0Zone);
+
+	sched_post(&funcTask);
 
 	NVIC_ClearPendingIRQ(EINT0_IRQn);
 	LPC_SC ->EXTINT = (1 << 0); /* Clear Interrupt Flag */
 
+	PROF_END(eint0Zone);
 }
 
 void EINT1_IRQHandler(void) {
+	PROF_BEGIN(eint1Zone);
+
 	mode_flag = !mode_flag;
+	sched_post(&modeTask);
 
 	NVIC_ClearPendingIRQ(EINT1_IRQn);
 	LPC_SC ->EXTINT = (1 << 1); /* Clear Interrupt Flag */
-}
-
-uint8_t acw = 0;
-uint8_t cw = 0;
-
-void check_rotary_switch(void) {
-	// GPIO interrupts on P0.24, P0.25
-	// Check if ANY of the edges detected
-	if ((LPC_GPIOINT ->IO0IntStatR >> 24) & 0x1) {
-		rotary_flag_0 = 1;
-		// channel 1 happened before channel 0
-		// anti-clockwise
-		if (rotary_flag_0 && rotary_flag_1) {
 
-			acw++;
-
-			if ((getTicks() > lastScreenChangeTicks + SCREEN_CHG_DELAY)
-					&& mode_flag && (acw > 10)) {
-				reinit_screen_flag = 1;
-				oled_page_state = (oled_page_state == 0 ? 6 : oled_page_state - 1);
-
-				acw = 0;
-				lastScreenChangeTicks = getTicks();
-			}
-
-			rotary_flag_0 = 0;
-			rotary_flag_1 = 0;
-		}
-		LPC_GPIOINT ->IO0IntClr = 1 << 24; //clear GPIO interrupt
-	} else if (((LPC_GPIOINT ->IO0IntStatR >> 25) & 0x1)) {
-		rotary_flag_1 = 1;
-		// channel 0 happened before channel 1
-		// clockwise
-		if (rotary_flag_0 && rotary_flag_1) {
-			cw++;
-
-			if ((getTicks() > lastScreenChangeTicks + 2 * SCREEN_CHG_DELAY)
-					&& mode_flag && (cw > 10)) {
-				reinit_screen_flag = 1;
-				oled_page_state = (oled_page_state + 1) % 7;
-
-				cw = 0;
-				lastScreenChangeTicks = getTicks();
-			}
-
-			rotary_flag_0 = 0;
-			rotary_flag_1 = 0;
-		}
-		LPC_GPIOINT ->IO0IntClr = 1 << 25; //clear GPIO interrupt
-	}
+	PROF_END(eint1Zone);
 }
 
-void check_joystick(void) {
-	// Determine whether GPIO Interrupt P2.10 has occurred
-	if ((LPC_GPIOINT ->IO0IntStatF >> 15) & 0x1) {
-//		y++;
-		if (oled_page_state == 6) {
-			func_mode_selection = (
-					func_mode_selection == 2 ? 0 : func_mode_selection + 1);
+//rotary switch turned by 'steps' detents (negative: anti-clockwise),
+//faster turns count more detents per page
+void rotary_turned(int8_t steps, uint32_t time) {
+	int32_t speed = rotary_getVelocity(time);
 
-			func_change_flag = 1;
-		}
-		LPC_GPIOINT ->IO0IntClr = 1 << 15;
+	if (!mode_flag) {
+		return;
 	}
-	if ((LPC_GPIOINT ->IO0IntStatF >> 16) & 0x1) {
-//		x++;
-
-		//ensure delay between screen changes
-		if ((getTicks() > lastScreenChangeTicks + SCREEN_CHG_DELAY)
-				&& mode_flag) {
-			reinit_screen_flag = 1;
-			oled_page_state = (oled_page_state + 1) % 7;
 
-			lastScreenChangeTicks = getTicks();
-		}
-		LPC_GPIOINT ->IO0IntClr = 1 << 16;
+	if (speed < 0) {
+		speed = -speed;
 	}
-	if ((LPC_GPIOINT ->IO0IntStatF >> 17) & 0x1) {
-		// centre button
-		LPC_GPIOINT ->IO0IntClr = 1 << 17;
+	if (speed >= ROTARY_VERY_FAST) {
+		steps *= 4;
+	} else if (speed >= ROTARY_FAST) {
+		steps *= 2;
 	}
-	if ((LPC_GPIOINT ->IO2IntStatF >> 3) & 0x1) {
-		if (oled_page_state == 6) {
-			func_mode_selection = (
-					func_mode_selection == 0 ? 2 : func_mode_selection - 1);
 
-			func_change_flag = 1;
-		}
-//		y--;
-		LPC_GPIOINT ->IO2IntClr = 1 << 3;
+	rotary_detents += steps;
+	while (rotary_detents >= ROTARY_DETENTS_PER_PAGE) {
+		ui_post(UI_EVENT_NEXT);
+		rotary_detents -= ROTARY_DETENTS_PER_PAGE;
+		lastScreenChangeTicks = time;
 	}
-	if ((LPC_GPIOINT ->IO2IntStatF >> 4) & 0x1) {
-//		x--;
-		if ((getTicks() > lastScreenChangeTicks + SCREEN_CHG_DELAY)
-				&& mode_flag) {
-			reinit_screen_flag = 1;
-			oled_page_state = (oled_page_state == 0 ? 6 : oled_page_state - 1);
+	while (rotary_detents <= -ROTARY_DETENTS_PER_PAGE) {
+		ui_post(UI_EVENT_PREV);
+		rotary_detents += ROTARY_DETENTS_PER_PAGE;
+		lastScreenChangeTicks = time;
+	}
+}
 
-			lastScreenChangeTicks = getTicks();
+//joystick pressed (falling edge)
+void joystick_event(uint8_t id, uint32_t time) {
+	switch (id) {
+	case PIN_JOY_DOWN:
+		ui_post(UI_EVENT_DOWN);
+		break;
+	case PIN_JOY_UP:
+		ui_post(UI_EVENT_UP);
+		break;
+	case PIN_JOY_RIGHT:
+	case PIN_JOY_LEFT:
+		//ensure delay between screen changes
+		if ((time > lastScreenChangeTicks + SCREEN_CHG_DELAY)
+				&& mode_flag) {
+			ui_post(id == PIN_JOY_RIGHT ? UI_EVENT_NEXT : UI_EVENT_PREV);
+			lastScreenChangeTicks = time;
 		}
-		LPC_GPIOINT ->IO2IntClr = 1 << 4;
+		break;
+	case PIN_JOY_CENTER:
+		// centre button, dump the profiler zones
+		sched_post(&profTask);
+		break;
+	default:
+		break;
 	}
 }
 
 // EINT3 Interrupt Handler
 void EINT3_IRQHandler(void) {
-	// Determine if GPIO Interrupt P2.5 has occurred (ISL2900023)
-	if ((LPC_GPIOINT ->IO2IntStatF >> 5) & 0x1) {
-		//clear interrupts
-		LPC_GPIOINT ->IO2IntClr = 1 << 5; //clear GPIO interrupt
-		light_clearIrqStatus(); //clear peripheral interrupt
+	PROF_BEGIN(eint3Zone);
 
-		//darkness detected
-		if (detect_darkness_flag == 1) {
+	// all GPIO interrupts, see eint3Pins
+	gpioint_dispatch();
 
-			lightSensor_detectLight();
-			detect_darkness_flag = 0;
-		} else if (detect_darkness_flag == 0) {
-
-			lightSensor_detectDarkness();
-			detect_darkness_flag = 1;
-		}
-	}
-
-	check_rotary_switch();
-	check_joystick();
+	PROF_END(eint3Zone);
 }
 
-/*** OLED functions for monitor mode ***/
+/*** OLED pages for monitor mode ***/
 
 void graphics_glitch_fix() {
 	oled_putPixel(95, 47, OLED_COLOR_BLACK);
 }
 
-//prints empty labels and 'monitor' on oled
-void monitor_oled_init(void) {
-	oled_putString(1, 1, STR_MAIN_TITLE, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-	oled_rect(0, 10, 95, 62, OLED_COLOR_WHITE);
-	oled_putString(2, 12, STR_MAIN_LUX, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-	oled_putString(2, 22, STR_MAIN_TEMP, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-	oled_putString(2, 32, STR_MAIN_ACCX, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-	oled_putString(2, 42, STR_MAIN_ACCY, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-	oled_putString(2, 52, STR_MAIN_ACCZ, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-
-	graphics_glitch_fix();
-}
-
-void monitor_oled_temp(void) {
-	oled_putBigString(20, 1, STR_BIG_TEMP, OLED_COLOR_WHITE, OLED_COLOR_BLACK,
-			2);
-	graphics_glitch_fix();
-}
-
-void monitor_oled_light(void) {
-	oled_putBigString(30, 1, STR_BIG_LIGHT, OLED_COLOR_WHITE, OLED_COLOR_BLACK,
-			2);
-	graphics_glitch_fix();
+//values bound to the page fields
+static int32_t value_light(void) {
+	return light_reading;
 }
 
-void monitor_oled_accX(void) {
-	oled_putBigString(15, 1, STR_BIG_ACCX, OLED_COLOR_WHITE, OLED_COLOR_BLACK,
-			2);
-	graphics_glitch_fix();
+static int32_t value_temp(void) {
+	return temperature_reading;
 }
 
-void monitor_oled_accY(void) {
-	oled_putBigString(15, 1, STR_BIG_ACCY, OLED_COLOR_WHITE, OLED_COLOR_BLACK,
-			2);
-	graphics_glitch_fix();
+static int32_t value_accX(void) {
+	return accX - accInitX;
 }
 
-void monitor_oled_accZ(void) {
-	oled_putBigString(15, 1, STR_BIG_ACCZ, OLED_COLOR_WHITE, OLED_COLOR_BLACK,
-			2);
-	graphics_glitch_fix();
+static int32_t value_accY(void) {
+	return accY - accInitY;
 }
 
-void monitor_oled_func(void) {
-	oled_putString(1, 1, STR_FUNC_TITLE, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-
-	//selection boxes
-	oled_rect(0, 10, 95, 23, OLED_COLOR_WHITE);
-	oled_rect(0, 23, 95, 36, OLED_COLOR_WHITE);
-	oled_rect(0, 36, 95, 49, OLED_COLOR_WHITE);
-
-	//selection text
-	oled_putString(9, 13, STR_FUNC_1, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-	oled_putString(9, 27, STR_FUNC_2, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-	oled_putString(9, 39, STR_FUNC_3, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-
-	update_selectArrow_oled();
-
-	graphics_glitch_fix();
+static int32_t value_accZ(void) {
+	return 64 + accZ - accInitZ;
 }
 
-//update sampled data on oled
-void displaySampledData_oled(void) {
-	//update OLED
-	sprintf(tempStr, STR_UINTVALUES_OUTPUT, light_reading);
-	oled_putString(35, 12, tempStr, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-	sprintf(tempStr, STR_FLOATVALUES_OUTPUT, temperature_reading / 10.0);
-	oled_putString(35, 22, tempStr, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-	sprintf(tempStr, STR_INTVALUES_OUTPUT, accX - accInitX);
-	oled_putString(35, 32, tempStr, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-	sprintf(tempStr, STR_INTVALUES_OUTPUT, accY - accInitY);
-	oled_putString(35, 42, tempStr, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-	sprintf(tempStr, STR_INTVALUES_OUTPUT, 64 + accZ - accInitZ);
-	oled_putString(35, 52, tempStr, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-
-	graphics_glitch_fix();
+static void format_int(int32_t value, char* text) {
+	fmt_int(text, value, -FIELD_WIDTH);
 }
 
-//helper functions to display values for diff screens
-void displayTempLarge_oled(void) {
-	sprintf(tempStr, STR_FLOATVALUES_OUTPUT, temperature_reading / 10.0);
-	oled_putBigString(15, 27, tempStr, OLED_COLOR_WHITE, OLED_COLOR_BLACK,
-			font_size);
-
-	graphics_glitch_fix();
+static void format_uint(int32_t value, char* text) {
+	fmt_uint(text, (uint32_t) value, -FIELD_WIDTH);
 }
 
-void displayLightLarge_oled(void) {
-	sprintf(tempStr, STR_UINTVALUES_OUTPUT, light_reading);
-	oled_putBigString(25, 27, tempStr, OLED_COLOR_WHITE, OLED_COLOR_BLACK,
-			font_size);
-
-	graphics_glitch_fix();
+//temperature in 0.1 C
+static void format_temp(int32_t value, char* text) {
+	fmt_fixed(text, value, 1, -FIELD_WIDTH);
 }
 
-void displayAccXLarge_oled(void) {
-	sprintf(tempStr, STR_INTVALUES_OUTPUT, accX - accInitX);
-	oled_putBigString(35, 27, tempStr, OLED_COLOR_WHITE, OLED_COLOR_BLACK,
-			font_size);
-
-	graphics_glitch_fix();
+//values drawn over the pre-rendered screens (see screens.c)
+static const ui_field_t mainFields[] = {
+	{ 35, 12, 1, value_light, format_uint },
+	{ 35, 22, 1, value_temp, format_temp },
+	{ 35, 32, 1, value_accX, format_int },
+	{ 35, 42, 1, value_accY, format_int },
+	{ 35, 52, 1, value_accZ, format_int },
+};
+
+//one value in big digits
+static const ui_field_t tempFields[] = {
+	{ 15, 27, BIG_FONT, value_temp, format_temp } };
+static const ui_field_t lightFields[] = {
+	{ 25, 27, BIG_FONT, value_light, format_uint } };
+static const ui_field_t accXFields[] = {
+	{ 35, 27, BIG_FONT, value_accX, format_int } };
+static const ui_field_t accYFields[] = {
+	{ 35, 27, BIG_FONT, value_accY, format_int } };
+static const ui_field_t accZFields[] = {
+	{ 35, 27, BIG_FONT, value_accZ, format_int } };
+
+void execute_function(uint8_t item);
+
+//static part of a page: its layout and the layout pre-rendered by screen_gen
+#define PAGE(p) &screenLayouts[p], screenImages[p]
+
+static const ui_page_t pages[NUM_PAGES] = {
+	[PAGE_MAIN] = { PAGE(PAGE_MAIN), mainFields, COUNT(mainFields),
+			0, 0, 0, 0, NULL, PAGE_TEMP, PAGE_FUNC },
+	[PAGE_TEMP] = { PAGE(PAGE_TEMP), tempFields, 1, 0, 0, 0, 0, NULL,
+			PAGE_LIGHT, PAGE_MAIN },
+	[PAGE_LIGHT] = { PAGE(PAGE_LIGHT), lightFields, 1, 0, 0, 0, 0, NULL,
+			PAGE_ACCX, PAGE_TEMP },
+	[PAGE_ACCX] = { PAGE(PAGE_ACCX), accXFields, 1, 0, 0, 0, 0, NULL,
+			PAGE_ACCY, PAGE_LIGHT },
+	[PAGE_ACCY] = { PAGE(PAGE_ACCY), accYFields, 1, 0, 0, 0, 0, NULL,
+			PAGE_ACCZ, PAGE_ACCX },
+	[PAGE_ACCZ] = { PAGE(PAGE_ACCZ), accZFields, 1, 0, 0, 0, 0, NULL,
+			PAGE_FUNC, PAGE_ACCY },
+	//SW3 executes the selected function
+	[PAGE_FUNC] = { PAGE(PAGE_FUNC), NULL, 0, 3, 2, 13, 13, execute_function,
+			PAGE_MAIN, PAGE_ACCZ },
+};
+
+//called by ui_post
+static void post_uiTask(void) {
+	sched_post(&uiTask);
 }
 
-void displayAccYLarge_oled(void) {
-	sprintf(tempStr, STR_INTVALUES_OUTPUT, accY - accInitY);
-	oled_putBigString(35, 27, tempStr, OLED_COLOR_WHITE, OLED_COLOR_BLACK,
-			font_size);
-
-	graphics_glitch_fix();
-}
-
-void displayAccZLarge_oled(void) {
-	sprintf(tempStr, STR_INTVALUES_OUTPUT, 64 + accZ - accInitZ);
-	oled_putBigString(35, 27, tempStr, OLED_COLOR_WHITE, OLED_COLOR_BLACK,
-			font_size);
-
-	graphics_glitch_fix();
+//called by acc_drdyHandler, EINT3 interrupt
+static void acc_motion(void) {
+	sched_post(&wakeTask);
 }
 
-void update_selectArrow_oled(void) {
-	//clear the previous arrow
-	oled_putString(2, 13, STR_BLANK_CHAR, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-	oled_putString(2, 26, STR_BLANK_CHAR, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-	oled_putString(2, 39, STR_BLANK_CHAR, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-
-	oled_putString(2, 13 * (1 + func_mode_selection), STR_ARROW_CHAR,
-			OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-
-	graphics_glitch_fix();
+//stop sampling, wake on a change from the resting values (64 per g),
+//which stay the baseline of the motion detector after the wake
+static void arm_motion(int8_t x, int8_t y, int8_t z) {
+	motion_setBaseline(&motion, x, y, z);
+	acc_waiting = 1;
+	acc_startMotionDetect(ACC_MODE_LEVEL, MOTION_WAKE, x, y, z, acc_motion);
 }
 
-void reinit_oled(void) {
-	oled_clearScreen(OLED_COLOR_BLACK);
-	switch (oled_page_state) {
-	case 0:
-		monitor_oled_init();
-		break;
-	case 1:
-		monitor_oled_temp();
-		break;
-	case 2:
-		monitor_oled_light();
-		break;
-	case 3:
-		monitor_oled_accX();
-		break;
-	case 4:
-		monitor_oled_accY();
-		break;
-	case 5:
-		monitor_oled_accZ();
-		break;
-	case 6:
-		monitor_oled_func();
-		break;
-	}
-}
+void prep_monitorMode(void) {
+	lighttrack_entry_t light;
 
-void update_oled() {
-	//display data to relevant screen
-	switch (oled_page_state) {
-	case 0:
-		displaySampledData_oled();
-		break;
-	case 1:
-		displayTempLarge_oled();
-		break;
-	case 2:
-		displayLightLarge_oled();
-		break;
-	case 3:
-		displayAccXLarge_oled();
-		break;
-	case 4:
-		displayAccYLarge_oled();
-		break;
-	case 5:
-		displayAccZLarge_oled();
-		break;
+	//light of the last window change until sampleTask has read it
+	if (lighttrack_getHistory(&lightTrack, &light, 1) == 1) {
+		light_sample = light.lux;
 	}
-}
-
-void prep_monitorMode(void) {
-	//un-reset clocks
-	LPC_TIM1 ->TCR = (0 << 1);
-	LPC_TIM2 ->TCR = (0 << 1);
-	//re-enable
-	init_timer1();
-	init_timer2();
 
-	read_acc(&accInitX, &accInitY, &accInitZ);
+	//start the periodic tasks
+	sched_start(&secondTask, 1000, 1000);
+	sched_start(&blinkTask, 333, 333);
+	sched_start(&sampleTask, SAMPLE_PERIOD, SAMPLE_PERIOD);
+	telem_batchInit(&batch, SAMPLE_PERIOD);
+
+	//reference reading, shown until the first motion is sampled
+	acc_read(&accInitX, &accInitY, &accInitZ);
+	accX = accInitX;
+	accY = accInitY;
+	accZ = accInitZ;
+	motion_init(&motion, &motionConfig);
+	filter_reset(accFilter[0], 1);
+	filter_reset(accFilter[1], 1);
+	filter_reset(accFilter[2], 1);
+
+	filter_reset(tempFilter, COUNT(tempFilter));
+	filter_hystInit(&tempAlarm, temp_high_warning - DEBUG_HEAT_OFFSET,
+			temp_high_warning - DEBUG_HEAT_OFFSET - TEMP_HYSTERESIS);
+	//no polling until the accelerometer detects motion
+	arm_motion(accInitX, accInitY, accInitZ);
 
-	monitor_oled_init();
 	sseg_controller();
 
-	// sample sensors + update OLED
+	// sample sensors, show the main page
 	sample_sensors();
-	update_oled(oled_page_state);
+	ui_show(PAGE_MAIN);
+	sched_post(&uiTask);
 
-	UART_SendString(LPC_UART3, STR_MONITOR_MODE);
+	send_event(TELEM_EVENT_MONITOR, NULL);
 }
 
-//reset devices and disable timers
+//reset devices and stop the periodic tasks
 void prep_passiveMode(void) {
 	//off everything
+	ui_hide();
 	oled_clearScreen(OLED_COLOR_BLACK); //clear OLED
+	oled_flush();
 	led7seg_setChar(0x00, 0);			//off 7 segment
 	timer2count = 0;						//reset 7 segment counter
 	rgb_setLeds(0x00);	//off RGB led
 	pca9532_setLeds(0x00, 0xFFFF); // off led_array
-	GPIO_ClearValue(2, 1 << 8); //off ext LED
-	GPIO_ClearValue(0, 1 << 26); //off siren
-
-	//reset clocks
-	LPC_TIM1 ->TCR = (1 << 1);
-	LPC_TIM2 ->TCR = (1 << 1);
-	//disable timers
-	LPC_TIM1 ->TCR = (0 << 0);
-	LPC_TIM2 ->TCR = (0 << 0);
+	GPIO_ClearValue(BOARD_PORT(EXT_LED), BOARD_MASK(EXT_LED)); //off ext LED
+	GPIO_ClearValue(BOARD_PORT(SPEAKER), BOARD_MASK(SPEAKER)); //off siren
+	acc_stopSampling();
+	acc_waiting = 0;
+	send_batch();
+
+	//stop tasks
+	sched_stop(&secondTask);
+	sched_stop(&blinkTask);
+	sched_stop(&sampleTask);
+	sched_stop(&speakerTask);
+	sched_stop(&uiTask);
 
 	//reset flags
 	temp_high_flag = 0;
-	detect_darkness_flag = 1;
 	movement_detected_flag = 0;
 	speaker_on_flag = 0;
-	func_change_flag = 0;
-
-	//reset page
-	oled_page_state = 0;
-	func_mode_selection = 0;
 
 	//reset RGB flag
 	rgbLED_mask = 0x00;
 }
 
 void read_acc(int8_t* accX, int8_t* accY, int8_t* accZ) {
-	//poll acc sensor
-	acc_read(accX, accY, accZ);
+	acc_sample_t sample;
+	int32_t x, y, z;
+	uint8_t stopped = 0;
+
+	//drain samples collected on DRDY, keeping the latest
+	while (acc_getSample(&sample)) {
+		*accX = sample.x;
+		*accY = sample.y;
+		*accZ = sample.z;
+
+		//a spike of a single sample is no movement
+		x = sample.x;
+		y = sample.y;
+		z = sample.z;
+		filter_process(accFilter[0], 1, &x);
+		filter_process(accFilter[1], 1, &y);
+		filter_process(accFilter[2], 1, &z);
+
+		if (motion_update(&motion, x, y, z) == MOTION_STOP) {
+			stopped = 1;
+		}
+	}
 
-	//check for movement and update accOld
-	if ((*accX - accOldX > 5) || (*accY - accOldY > 5)
-			|| (*accZ - accOldZ > 5)) {
+	//raised again by every drain while moving
+	if (motion_isMoving(&motion)) {
 		movement_detected_flag = 1;
+	} else if (stopped) {
+		//at rest again, at the latest filtered sample
+		arm_motion(x, y, z);
+	}
+}
+
+//take the latest background temperature measurement, if any
+void read_temp(void) {
+	static uint32_t measurements = 0;
+	uint32_t count = temp_getMeasurements();
+	int32_t reading = temp_read_latest();
+
+	if (reading == TEMP_NO_READING) {
+		return;
 	}
+	temperature_reading = reading;
 
-	accOldX = *accX;
-	accOldY = *accY;
-	accOldZ = *accZ;
+	//the warning follows the filtered measurements, each counted once
+	if (count != measurements) {
+		measurements = count;
+		if (filter_process(tempFilter, COUNT(tempFilter), &reading)) {
+			temp_high_flag = filter_hyst(&tempAlarm, reading);
+		}
+	}
 }
 
 //sample the accelerometer, light, temperature sensors
 void sample_sensors(void) {
-	//poll light sensor
-	light_reading = light_read();
+	PROF_BEGIN(sampleZone);
+
+	//latest light value read by sampleTask
+	light_reading = light_sample;
 	//poll acc sensor
 	read_acc(&accX, &accY, &accZ);
-	//poll temp sensor
-	temperature_reading = temp_read();
+	//latest temperature measurement
+	read_temp();
+
+	PROF_END(sampleZone);
 }
 
 /*** function mode executor ***/
-void execute_function(void) {
-	switch (func_mode_selection) {
+void execute_function(uint8_t item) {
+	switch (item) {
 	case 0:
 		speaker_on_flag = !speaker_on_flag;
-		if (!speaker_on_flag) {
-			GPIO_ClearValue(0, 1 << 26); //make sure speaker is off
+		if (speaker_on_flag) {
+			sched_start(&speakerTask, 0, 1);
+		} else {
+			sched_stop(&speakerTask);
+			GPIO_ClearValue(BOARD_PORT(SPEAKER), BOARD_MASK(SPEAKER)); //make sure speaker is off
 		}
 		break;
 	case 1:
@@ -877,141 +767,421 @@ void execute_function(void) {
 	}
 }
 
-//transmit message through UART
-void transmitData() {
-	if (((rgbLED_mask & RGB_RED) >> 0) == 1) {
-		UART_SendString(LPC_UART3, STR_FIRE_ALERT);
+//frame a message straight into the transmit ring, -1 if it is full
+int send_frame(uint8_t type, uint32_t time, const uint8_t* payload,
+		uint32_t len) {
+	uint8_t* frame;
+
+	frame = uart3_reserve(TELEM_FRAME_LEN(len));
+	if (frame == NULL) {
+		return -1;
 	}
 
-	if (((rgbLED_mask & RGB_BLUE) >> 1) == 1) {
-		UART_SendString(LPC_UART3, STR_DARK_ALERT);
+	uart3_commit(telem_encode(type, time, payload, len, frame));
+	return 0;
+}
+
+//event code followed by optional text
+void send_event(uint8_t code, const char* text) {
+	uint8_t payload[1 + 16];
+	uint32_t len = 1;
+
+	payload[0] = code;
+	while (text != NULL && *text != '\0' && len < sizeof(payload)) {
+		payload[len++] = *text++;
 	}
 
-	static uint8_t transmitCount = 0;
+	send_frame(TELEM_EVENT, getTicks(), payload, len);
+}
 
-	char string[50];
+//transmit sensor record through UART
+void transmitData() {
+	telem_record_t rec;
+	uint8_t payload[TELEM_RECORD_LEN];
+	uint8_t entry[TELEM_LOG_ENTRY_LEN];
+
+	rec.temp = temperature_reading;
+	rec.light = (light_reading > 0xFFFF ? 0xFFFF : light_reading);
+	rec.accX = accX - accInitX;
+	rec.accY = accY - accInitY;
+	rec.accZ = accZ - accInitZ;
+	rec.flags = 0;
+	if (rgbLED_mask & RGB_RED) {
+		rec.flags |= TELEM_FLAG_FIRE;
+	}
+	if (rgbLED_mask & RGB_BLUE) {
+		rec.flags |= TELEM_FLAG_DARK;
+	}
 
-	snprintf(string, 50, "%03d_-_T-%.2f_L-%d_AX.%d_AY.%d_AZ.%d\r\n",
-			transmitCount++, temperature_reading / 10.0, light_reading,
-			(int) (accX - accInitX), (int) (accY - accInitY),
-			(int) (accZ - accInitZ));
+	telem_packRecord(&rec, payload);
+	send_frame(TELEM_RECORD, getTicks(), payload, TELEM_RECORD_LEN);
 
-	UART_SendString(LPC_UART3, &string);
+	//keep a copy in the flash log for when the link is down
+	telem_packLogEntry(getTicks(), &rec, entry);
+	flog_append(entry);
 }
 
 //send SOS message to CEMS
 void notify_cems() {
-	char string[50];
+	send_event(TELEM_EVENT_CEMS, userID);
+}
 
-	snprintf(string, 50, STR_CEMS_ALERT, userID);
+//send the collected samples as one frame and start a new block
+void send_batch(void) {
+	if (batch.count > 0) {
+		send_frame(TELEM_BATCH, batch.time, batch.payload, batch.len);
+	}
+	telem_batchInit(&batch, SAMPLE_PERIOD);
+}
 
-	UART_SendString(LPC_UART3, &string);
+//light value for the next sample (I2C2 interrupt)
+static void light_sampled(int32_t status, uint32_t lux) {
+	if (status == I2C2_XFER_OK) {
+		light_sample = lux;
+	}
 }
 
-void initial_setup(int8_t* accInitX, int8_t* accInitY, int8_t* accInitZ) {
-	//SysTick init
-	SysTick_Config(SystemCoreClock / 1000);
+//light value for lightTrack (I2C2 interrupt)
+static void light_tracked(int32_t status, uint32_t lux) {
+	if (status == I2C2_XFER_OK) {
+		light_lux = lux;
+		light_luxReady = 1;
+	} else {
+		light_irq = 1;	//read again
+	}
+	sched_post(&lightTask);
+}
 
-	init_protocols();
-	init_peripherals();
-	init_GPIO();
-	init_interrupts();
+/*** scheduler tasks ***/
 
-	//hardware setup
-	light_setIrqInCycles(LIGHT_CYCLE_1);
-	light_enable(); //enable light sensor
-	oled_clearScreen(OLED_COLOR_BLACK); //clear oled
-	acc_init();
-	read_acc(accInitX, accInitY, accInitZ);
+//enter or leave monitor mode after SW4 was pressed
+static void mode_task(void *arg) {
+	static uint8_t monitoring = 0;
 
-	prep_passiveMode();
+	if (mode_flag == monitoring) {
+		return;
+	}
+	monitoring = mode_flag;
+
+	if (monitoring) {
+		prep_monitorMode();
+	} else {
+		prep_passiveMode();
+	}
 }
 
-int main(void) {
-	initial_setup(&accInitX, &accInitY, &accInitZ);
-	//main execution loop
-	while (1) {
-		//stable, passive mode
-		if (mode_flag == 0) {
-			prep_passiveMode();
-			while (mode_flag == 0)
-				; //wait for MONITOR to be enabled
-			prep_monitorMode();
-		}
+//motion detected while sampling was stopped, sample until it stops
+static void wake_task(void *arg) {
+	if (!acc_waiting) {
+		return;
+	}
+	acc_waiting = 0;
 
-//		//slower, delay but much less likely to crash
-//		if (rgbLED_flag
-//				&& ((((rgbLED_mask & RGB_BLUE) >> 1))
-//						|| ((rgbLED_mask & RGB_RED) >> 0))) {
-//			rgbLED_controller();
-//			rgbLED_flag = 0;
-//		}
-		if (sseg_flag) {
-			sseg_controller();
-			sseg_flag = 0;
-		}
+	movement_detected_flag = 1;
+	motion_start(&motion);
+	acc_startSampling(getTicks);
+}
 
-		//init the screens
-		if (reinit_screen_flag) {
-			reinit_oled();
-			reinit_screen_flag = 0;
-		}
+//read the light after a threshold interrupt, then move the window and
+//clear the interrupt. A step whose previous transfer is still pending is
+//retried after LIGHT_RETRY ms
+static void light_task(void *arg) {
+	static uint8_t steps = 0;
+	uint32_t lo, hi;
+
+	if (light_irq) {
+		light_irq = 0;
+		steps |= LIGHT_STEP_READ;
+	}
+	if (light_luxReady) {
+		light_luxReady = 0;
+		lighttrack_update(&lightTrack, light_lux, getTicks());
+		steps |= LIGHT_STEP_LO | LIGHT_STEP_HI | LIGHT_STEP_CLEAR;
+	}
+
+	if ((steps & LIGHT_STEP_READ) && light_read_async(light_tracked) == 0) {
+		steps &= ~LIGHT_STEP_READ;
+	}
+
+	//the interrupt is cleared once the new window is queued
+	lighttrack_getWindow(&lightTrack, &lo, &hi);
+	if ((steps & LIGHT_STEP_LO) && light_setLoThreshold_async(lo) == 0) {
+		steps &= ~LIGHT_STEP_LO;
+	}
+	if ((steps & LIGHT_STEP_HI) && light_setHiThreshold_async(hi) == 0) {
+		steps &= ~LIGHT_STEP_HI;
+	}
+	if ((steps & (LIGHT_STEP_LO | LIGHT_STEP_HI | LIGHT_STEP_CLEAR))
+			== LIGHT_STEP_CLEAR && light_clearIrqStatus_async() == 0) {
+		steps &= ~LIGHT_STEP_CLEAR;
+	}
+
+	if (steps != 0) {
+		sched_start(&lightTask, LIGHT_RETRY, 0);
+	}
+}
+
+//7 segment every second, sensors every 5s, telemetry every 15s
+static void second_task(void *arg) {
+	uint8_t count = timer2count;
+
+	sseg_controller();
+
+	if (count == 5 || count == 10 || count == 15) {
+		sample_sensors();
+
+		//redraw the changed values
+		sched_post(&uiTask);
+	}
+
+	if (count == 15) {
+		transmitData();
+	}
+
+	flog_service();
+	kv_service();
+}
 
-		//sample sensors every 5s, else sample temp and acc every 0.1s
-		if (sample_sensors_flag) {
-			sample_sensors();
-			sample_sensors_flag = 0;
+//blink the RGB led while a warning is active
+static void blink_task(void *arg) {
+	if (((rgbLED_mask & RGB_BLUE) >> 1) || ((rgbLED_mask & RGB_RED) >> 0)) {
+		rgbLED_controller();
+	}
+}
 
-			//display data to relevant screen
-			update_oled(oled_page_state);
-		} else if (getTicks() > oldSampleTicks + 100) {
-			temperature_reading = temp_read();
-			read_acc(&accX, &accY, &accZ);
+//sample temp and acc every 0.1s, raise warnings
+static void sample_task(void *arg) {
+	telem_sample_t sample;
+
+	read_temp();
+	read_acc(&accX, &accY, &accZ);
+
+	//keep the full rate history
+	sample.temp = temperature_reading;
+	sample.light = (light_sample > 0xFFFF ? 0xFFFF : light_sample);
+	sample.accX = accX - accInitX;
+	sample.accY = accY - accInitY;
+	sample.accZ = accZ - accInitZ;
+	if (telem_batchAdd(&batch, getTicks(), &sample)) {
+		send_batch();
+	}
+	light_read_async(light_sampled);
+
+	//if high temperature is detected, the warning stays on until PASSIVE
+	if (temp_high_flag) {
+		rgbLED_mask |= RGB_RED;
+	}
 
-			oldSampleTicks = getTicks();
+	//if MOVEMENT_DETECTED
+	if (movement_detected_flag) {
+		//if no movement in darkness after set duration, disable movement flag
+		if (getTicks() > lastMotionDetectedTicks + 20) {
+			//check for prolonged movement detection, if so, set flag
+			if (lighttrack_isDark(&lightTrack)) {
+				rgbLED_mask |= RGB_BLUE; //toggle blue led mask on
+			} else {
+				movement_detected_flag = 0;
+			}
 		}
+	}
+}
+
+//drive piezo speaker for siren
+static void speaker_task(void *arg) {
+	speaker_controller();
+}
+
+//apply page and menu events, draw the changed fields
+static void ui_task(void *arg) {
+	PROF_BEGIN(uiZone);
+	if (ui_service()) {
+		graphics_glitch_fix();
+		sched_post(&flushTask);
+	}
+	PROF_END(uiZone);
+}
 
-		//if high temperature is detected
-		if (temperature_reading >= (TEMP_HIGH_WARNING - DEBUG_HEAT_OFFSET)) {
-			rgbLED_mask |= RGB_RED;
+//SW3: execute the selected function, send the flash log in passive mode
+static void func_task(void *arg) {
+	if (ui_getPage() != UI_NO_PAGE) {
+		ui_post(UI_EVENT_SELECT);
+	} else {
+		sched_post(&backfillTask);
+	}
+}
+
+//push changed OLED columns in one burst per page
+static void flush_task(void *arg) {
+	oled_flush();
+}
+
+//joystick and rotary edges, in the order they happened
+static void input_task(void *arg) {
+	gpioint_event_t event;
+	int8_t steps;
+
+	while (gpioint_getEvent(&event)) {
+		if (event.id == PIN_ROTARY) {
+			steps = rotary_decode(event.levels, event.time);
+			if (steps != 0) {
+				rotary_turned(steps, event.time);
+			}
+		} else {
+			joystick_event(event.id, event.time);
 		}
+	}
+}
+
+//stream the flash log from where the last backfill stopped, continues
+//later when the UART3 ring is full or the flash is programming a page
+static void backfill_task(void *arg) {
+	static flog_page_t page;
+	static uint32_t seq = 0;
+	static uint8_t sent = 0;	//entries of page seq already sent
+	static uint8_t loaded = 0;
+	uint8_t payload[2 + TELEM_LOG_MAX_ENTRIES * TELEM_LOG_ENTRY_LEN];
+	uint8_t n;
+	int status;
+
+	if (seq < flog_oldest()) {
+		seq = flog_oldest();
+		sent = 0;
+	}
 
-		//if MOVEMENT_DETECTED
-		if (movement_detected_flag) {
-			//if no movement in darkness after set duration, disable movement flag
-			if (getTicks() > lastMotionDetectedTicks + 20) {
-				//check for prolonged movement detection, if so, set flag
-				if (!detect_darkness_flag) {
-					rgbLED_mask |= RGB_BLUE; //toggle blue led mask on
-				} else {
-					movement_detected_flag = 0;
+	while (seq <= flog_current()) {
+		if (!loaded) {
+			status = flog_readPage(seq, &page);
+			if (status == FLOG_BUSY) {
+				sched_start(&backfillTask, BACKFILL_RETRY, 0);
+				return;
+			}
+			if (status != 0) {
+				//overwritten or torn
+				if (seq == flog_current()) {
+					break;
 				}
+				seq++;
+				sent = 0;
+				continue;
 			}
+			loaded = 1;
 		}
 
-		//if at func mode screen
-		if (func_change_flag && oled_page_state == 6) {
-			update_selectArrow_oled();
-			func_change_flag = 0;
+		n = page.count - sent;
+		if (n > TELEM_LOG_MAX_ENTRIES) {
+			n = TELEM_LOG_MAX_ENTRIES;
 		}
-
-		//execute function if selected
-		if (func_execute_flag) {
-			execute_function();
-			func_execute_flag = 0;
+		if (n > 0) {
+			payload[0] = page.boot & 0xFF;
+			payload[1] = page.boot >> 8;
+			memcpy(&payload[2], &page.entries[sent * TELEM_LOG_ENTRY_LEN],
+					n * TELEM_LOG_ENTRY_LEN);
+			if (send_frame(TELEM_LOG, getTicks(), payload,
+					2 + n * TELEM_LOG_ENTRY_LEN) != 0) {
+				sched_start(&backfillTask, 10, 0);
+				return;
+			}
+			sent += n;
 		}
 
-		//drive piezo speaker for siren
-		if (speaker_on_flag) {
-			speaker_controller();
+		if (sent == page.count) {
+			loaded = 0;
+			//the page in RAM is continued by the next backfill
+			if (seq == flog_current()) {
+				break;
+			}
+			seq++;
+			sent = 0;
 		}
+	}
+}
 
-		//if need to transmit
-		if (send_message_flag) {
-			transmitData();
-			send_message_flag = 0;
+//one line per profiler zone, continues later when the UART3 ring is full
+static void prof_task(void *arg) {
+	static uint32_t zone = 0;
+	char line[PROF_LINE_LEN];
+	int len;
+
+	while (zone < prof_numZones()) {
+		//text frame without the CRLF
+		len = prof_formatZone(zone, line, PROF_LINE_LEN);
+		if (send_frame(TELEM_TEXT, getTicks(), (uint8_t*) line, len - 2) != 0) {
+			sched_start(&profTask, 20, 0);
+			return;
 		}
+		zone++;
 	}
-	return 0;
+
+	zone = 0;
 }
 
+//read the configuration from the EEPROM store, storing the defaults
+//of missing keys
+void load_config() {
+	int len;
+
+	kv_init();
+
+	if (kv_get(CFG_TEMP_HIGH, &temp_high_warning, sizeof(temp_high_warning))
+			!= sizeof(temp_high_warning)) {
+		temp_high_warning = TEMP_HIGH_WARNING;
+		kv_set(CFG_TEMP_HIGH, &temp_high_warning, sizeof(temp_high_warning));
+	}
+	if (kv_get(CFG_LIGHT_DARK, &light_dark_threshold,
+			sizeof(light_dark_threshold)) != sizeof(light_dark_threshold)) {
+		light_dark_threshold = LIGHT_DARK_THRESHOLD;
+		kv_set(CFG_LIGHT_DARK, &light_dark_threshold,
+				sizeof(light_dark_threshold));
+	}
+	len = kv_get(CFG_USER_ID, userID, KV_MAX_VALUE);
+	if (len < 0) {
+		kv_set(CFG_USER_ID, USER_ID, strlen(USER_ID));
+	} else {
+		userID[len] = '\0';
+	}
+}
+
+void initial_setup(int8_t* accInitX, int8_t* accInitY, int8_t* accInitZ) {
+	//scheduler and time base init
+	sched_init();
+	sched_addTask(&modeTask, mode_task, NULL);
+	sched_addTask(&secondTask, second_task, NULL);
+	sched_addTask(&blinkTask, blink_task, NULL);
+	sched_addTask(&sampleTask, sample_task, NULL);
+	sched_addTask(&speakerTask, speaker_task, NULL);
+	sched_addTask(&uiTask, ui_task, NULL);
+	sched_addTask(&funcTask, func_task, NULL);
+	sched_addTask(&flushTask, flush_task, NULL);
+	sched_addTask(&profTask, prof_task, NULL);
+	sched_addTask(&backfillTask, backfill_task, NULL);
+	sched_addTask(&inputTask, input_task, NULL);
+	sched_addTask(&wakeTask, wake_task, NULL);
+	sched_addTask(&lightTask, light_task, NULL);
+	prof_init();
+
+	board_init();	//pin functions and directions, before any driver
+	init_protocols();
+	init_peripherals();
+	flog_init();	//logging stays off without the dataflash
+	load_config();
+	ui_init(pages, NUM_PAGES, post_uiTask);
+	init_interrupts();
+
+	//hardware setup
+	light_setIrqInCycles(LIGHT_CYCLE_1);
+	light_enable(); //enable light sensor
+	oled_clearScreen(OLED_COLOR_BLACK); //clear oled
+	acc_init();
+	acc_read(accInitX, accInitY, accInitZ);
+
+	prep_passiveMode();
+}
+
+int main(void) {
+	initial_setup(&accInitX, &accInitY, &accInitZ);
+
+	//run tasks, sleep when idle
+	sched_run();
+
+	return 0;
+}
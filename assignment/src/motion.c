@@ -0,0 +1,205 @@
+/*****************************************************************************
+ *   motion.c:  Motion detector on the accelerometer samples
+ *
+******************************************************************************/
+
+/*
+ * Runs on every accelerometer sample (the ODR, 125 Hz). The activity of
+ * a sample is the larger of two squared vector magnitudes:
+ *
+ * - jerk: the change since the previous sample, |a[n] - a[n-1]|^2. Picks
+ *   up shaking and knocks in any direction.
+ * - deviation from gravity: |a[n] - g|^2, where g is a per axis EMA of
+ *   the samples. Picks up slow tilting, which changes too little between
+ *   two samples to count as jerk.
+ *
+ * Motion starts when the activity reaches threshold^2 and stops after
+ * holdSamples samples with a jerk below quiet^2, i.e. once the board is
+ * still, whatever its angle. The sample at the stop becomes the baseline,
+ * so a board left at a new angle does not count as moving while the
+ * baseline catches up. Otherwise the baseline adapts all the time, with
+ * a time constant of about 32768 / baselineAlpha samples.
+ *
+ * Squares of counts only, no square roots and no floating point.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "motion.h"
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static uint32_t square(int32_t v)
+{
+    return (uint32_t)(v * v);
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize a detector. The first sample becomes the baseline.
+ *
+ * Params:
+ *   [in] m - the detector
+ *   [in] cfg - sensitivity, copied
+ *
+ *****************************************************************************/
+void motion_init (motion_t *m, const motion_config_t *cfg)
+{
+    uint8_t i;
+
+    m->cfg = *cfg;
+    for (i = 0; i < 3; i++) {
+        m->baseline[i].alpha = cfg->baselineAlpha;
+        m->baseline[i].primed = 0;
+    }
+    m->primed = 0;
+    m->moving = 0;
+    m->quietSamples = 0;
+    m->level = 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Feed a sample
+ *
+ * Params:
+ *   [in] m - the detector
+ *   [in] x, y, z - the sample, counts
+ *
+ * Returns:
+ *   MOTION_START or MOTION_STOP when the state changes, otherwise
+ *   MOTION_NONE
+ *
+ *****************************************************************************/
+motion_event_t motion_update(motion_t *m, int32_t x, int32_t y, int32_t z)
+{
+    int32_t a[3];
+    uint32_t jerk = 0;
+    uint32_t deviation = 0;
+    uint8_t i;
+
+    a[0] = x;
+    a[1] = y;
+    a[2] = z;
+
+    if (!m->primed) {
+        for (i = 0; i < 3; i++) {
+            m->last[i] = a[i];
+            filter_ema(&m->baseline[i], a[i]);
+        }
+        m->primed = 1;
+        return MOTION_NONE;
+    }
+
+    for (i = 0; i < 3; i++) {
+        jerk += square(a[i] - m->last[i]);
+        /* the sample moves the slow baseline by a negligible amount */
+        deviation += square(a[i] - filter_ema(&m->baseline[i], a[i]));
+        m->last[i] = a[i];
+    }
+    m->level = (jerk > deviation) ? jerk : deviation;
+
+    if (!m->moving) {
+        if (m->level >= square(m->cfg.threshold)) {
+            m->moving = 1;
+            m->quietSamples = 0;
+            return MOTION_START;
+        }
+        return MOTION_NONE;
+    }
+
+    if (jerk >= square(m->cfg.quiet)) {
+        m->quietSamples = 0;
+    } else if (++m->quietSamples >= m->cfg.holdSamples) {
+        /* at rest, at a new angle or not */
+        motion_setBaseline(m, x, y, z);
+        m->moving = 0;
+        return MOTION_STOP;
+    }
+
+    return MOTION_NONE;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the state of a detector
+ *
+ * Returns:
+ *   1 between MOTION_START and MOTION_STOP, otherwise 0
+ *
+ *****************************************************************************/
+uint8_t motion_isMoving(const motion_t *m)
+{
+    return m->moving;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the activity of the last sample, e.g. to tune the sensitivity
+ *
+ * Returns:
+ *   the larger of the squared jerk and deviation, counts^2
+ *
+ *****************************************************************************/
+uint32_t motion_getLevel(const motion_t *m)
+{
+    return m->level;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Enter the moving state for motion detected elsewhere, e.g. by the
+ *    accelerometer's own level detection. It stops like any other motion.
+ *
+ * Params:
+ *   [in] m - the detector
+ *
+ *****************************************************************************/
+void motion_start(motion_t *m)
+{
+    m->moving = 1;
+    m->quietSamples = 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Set the gravity baseline to a known resting vector, e.g. the one the
+ *    accelerometer's level detection compares against. The next sample is
+ *    measured against it instead of becoming the baseline, so a sample
+ *    taken while already moving does not become the baseline.
+ *
+ * Params:
+ *   [in] m - the detector
+ *   [in] x, y, z - the resting acceleration, counts
+ *
+ *****************************************************************************/
+void motion_setBaseline(motion_t *m, int32_t x, int32_t y, int32_t z)
+{
+    int32_t a[3];
+    uint8_t i;
+
+    a[0] = x;
+    a[1] = y;
+    a[2] = z;
+
+    for (i = 0; i < 3; i++) {
+        m->baseline[i].primed = 0;
+        filter_ema(&m->baseline[i], a[i]);
+        m->last[i] = a[i];
+    }
+    m->primed = 1;
+}
@@ -0,0 +1,50 @@
+/*****************************************************************************
+ *   motion.h:  Header file for the accelerometer motion detector
+ *
+******************************************************************************/
+#ifndef __MOTION_H
+#define __MOTION_H
+
+#include <stdint.h>
+#include "filter.h"
+
+typedef enum
+{
+    MOTION_NONE,
+    MOTION_START,
+    MOTION_STOP
+} motion_event_t;
+
+/* sensitivity, in accelerometer counts (64 per g in the 2g range) */
+typedef struct
+{
+    uint8_t threshold;      /* motion starts at this jerk or deviation */
+    uint8_t quiet;          /* and stops after holdSamples of jerk below this */
+    uint16_t holdSamples;
+    uint16_t baselineAlpha; /* Q15 weight of a sample in the baseline */
+} motion_config_t;
+
+typedef struct
+{
+    motion_config_t cfg;
+    filter_ema_t baseline[3];   /* gravity */
+    int32_t last[3];
+    uint8_t primed;
+    uint8_t moving;
+    uint16_t quietSamples;
+    uint32_t level;             /* activity of the last sample, counts^2 */
+} motion_t;
+
+
+void motion_init (motion_t *m, const motion_config_t *cfg);
+motion_event_t motion_update(motion_t *m, int32_t x, int32_t y, int32_t z);
+uint8_t motion_isMoving(const motion_t *m);
+uint32_t motion_getLevel(const motion_t *m);
+void motion_start(motion_t *m);
+void motion_setBaseline(motion_t *m, int32_t x, int32_t y, int32_t z);
+
+
+#endif /* end __MOTION_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
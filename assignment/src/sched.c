@@ -0,0 +1,274 @@
+/*****************************************************************************
+ *   sched.c:  Tickless cooperative task scheduler
+ *
+******************************************************************************/
+
+/*
+ * Tasks are run to completion from sched_run (or sched_dispatch) when
+ * their timer expires or when they have been posted with sched_post.
+ * sched_post may be called from interrupt handlers; all other functions
+ * must be called from task (thread) context.
+ *
+ * When nothing is due the scheduler sleeps through the port layer until
+ * the next deadline or the next interrupt. There is no periodic tick.
+ *
+ * This file has no hardware dependencies and is also built on the host,
+ * see assignment/host.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stddef.h>
+#include "sched.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+/* true if time a is at or after time b, wrap-around safe */
+#define TIME_REACHED(a, b) ((int32_t)((a) - (b)) >= 0)
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static sched_task_t *tasks = NULL;
+
+/* set by sched_post, cleared by the dispatcher before it scans the tasks */
+static volatile uint8_t eventPending = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static uint8_t isDue(sched_task_t *t, uint32_t now)
+{
+    return t->armed && TIME_REACHED(now, t->deadline);
+}
+
+static void rearm(sched_task_t *t, uint32_t now)
+{
+    if (t->period == 0) {
+        t->armed = 0;
+        return;
+    }
+
+    /* keep the cadence, but don't try to catch up on missed periods */
+    t->deadline += t->period;
+    if (TIME_REACHED(now, t->deadline)) {
+        t->deadline = now + t->period;
+    }
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the scheduler and its time base
+ *
+ *****************************************************************************/
+void sched_init (void)
+{
+    tasks = NULL;
+    eventPending = 0;
+    sched_port_init();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Add a task. It doesn't run until it is started or posted.
+ *
+ * Params:
+ *   [in] task - task control block, must stay valid
+ *   [in] func - task function
+ *   [in] arg - argument passed to func
+ *
+ *****************************************************************************/
+void sched_addTask(sched_task_t *task, sched_func_t func, void *arg)
+{
+    sched_task_t **p = &tasks;
+
+    task->func = func;
+    task->arg = arg;
+    task->armed = 0;
+    task->posted = 0;
+    task->next = NULL;
+
+    while (*p != NULL) {
+        p = &(*p)->next;
+    }
+    *p = task;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Arm the timer of a task
+ *
+ * Params:
+ *   [in] task - task to start
+ *   [in] delay - ms until the first run
+ *   [in] period - ms between runs, 0 to run once
+ *
+ *****************************************************************************/
+void sched_start(sched_task_t *task, uint32_t delay, uint32_t period)
+{
+    task->deadline = sched_now() + delay;
+    task->period = period;
+    task->armed = 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Disarm the timer of a task and drop a pending post
+ *
+ *****************************************************************************/
+void sched_stop(sched_task_t *task)
+{
+    task->armed = 0;
+    task->posted = 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Make a task ready to run. May be called from an interrupt handler.
+ *    Posting an already posted task has no further effect.
+ *
+ *****************************************************************************/
+void sched_post(sched_task_t *task)
+{
+    task->posted = 1;
+    eventPending = 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the scheduler time
+ *
+ * Returns:
+ *    Milliseconds since sched_init
+ *
+ *****************************************************************************/
+uint32_t sched_now(void)
+{
+    return sched_port_now();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the time until the earliest armed timer
+ *
+ * Returns:
+ *    ms until the next deadline (0 if overdue), SCHED_FOREVER if none
+ *
+ *****************************************************************************/
+uint32_t sched_nextDeadline(void)
+{
+    sched_task_t *t;
+    uint32_t now = sched_now();
+    uint32_t next = SCHED_FOREVER;
+    uint32_t left;
+
+    for (t = tasks; t != NULL; t = t->next) {
+        if (!t->armed) {
+            continue;
+        }
+        left = TIME_REACHED(now, t->deadline) ? 0 : t->deadline - now;
+        if (left < next) {
+            next = left;
+        }
+    }
+
+    return next;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Run every task that is posted or due, once each
+ *
+ * Returns:
+ *    Number of tasks that were run
+ *
+ *****************************************************************************/
+uint32_t sched_dispatch(void)
+{
+    sched_task_t *t;
+    uint32_t now = sched_now();
+    uint32_t count = 0;
+    uint8_t run;
+
+    eventPending = 0;
+
+    for (t = tasks; t != NULL; t = t->next) {
+        run = 0;
+
+        if (t->posted) {
+            t->posted = 0;
+            run = 1;
+        }
+        if (isDue(t, now)) {
+            rearm(t, now);
+            run = 1;
+        }
+
+        if (run) {
+            t->func(t->arg);
+            count++;
+            now = sched_now();
+        }
+    }
+
+    return count;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Sleep until the next deadline or until an interrupt has occurred.
+ *    Returns right away if a task has been posted since the last dispatch.
+ *
+ *****************************************************************************/
+void sched_idle(void)
+{
+    uint32_t key;
+    uint32_t next = sched_nextDeadline();
+
+    if (next == 0) {
+        return;
+    }
+    if (next > SCHED_MAX_SLEEP_MS) {
+        next = SCHED_MAX_SLEEP_MS;
+    }
+
+    /* a post between the check and the sleep leaves an interrupt pending */
+    key = sched_port_lock();
+    if (!eventPending) {
+        sched_port_sleep(next);
+    }
+    sched_port_unlock(key);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Run the scheduler. Never returns.
+ *
+ *****************************************************************************/
+void sched_run(void)
+{
+    for (;;) {
+        sched_dispatch();
+        sched_idle();
+    }
+}
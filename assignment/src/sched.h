@@ -0,0 +1,67 @@
+/*****************************************************************************
+ *   sched.h:  Header file for the cooperative task scheduler
+ *
+******************************************************************************/
+#ifndef __SCHED_H
+#define __SCHED_H
+
+#include <stdint.h>
+
+/* returned by sched_nextDeadline when no timer is armed */
+#define SCHED_FOREVER 0xFFFFFFFF
+
+/* longest single sleep, keeps the port's time base from wrapping */
+#define SCHED_MAX_SLEEP_MS 10000
+
+typedef void (*sched_func_t)(void *arg);
+
+/*
+ * Task control block, owned by the caller. A task runs to completion when
+ * its timer expires or when it has been posted. Tasks run in the order
+ * they were added.
+ */
+typedef struct sched_task
+{
+    sched_func_t func;
+    void *arg;
+
+    uint32_t deadline;      /* ms, valid while armed */
+    uint32_t period;        /* ms, 0 for a one-shot timer */
+    uint8_t armed;
+
+    volatile uint8_t posted;
+
+    struct sched_task *next;
+} sched_task_t;
+
+
+void sched_init (void);
+void sched_addTask(sched_task_t *task, sched_func_t func, void *arg);
+void sched_start(sched_task_t *task, uint32_t delay, uint32_t period);
+void sched_stop(sched_task_t *task);
+void sched_post(sched_task_t *task);
+uint32_t sched_now(void);
+uint32_t sched_nextDeadline(void);
+uint32_t sched_dispatch(void);
+void sched_idle(void);
+void sched_run(void);
+
+/*
+ * Port layer, implemented once per target. sched_port_sleep is called with
+ * interrupts masked (sched_port_lock) and must return when an interrupt is
+ * pending or 'ms' milliseconds have passed, whichever comes first.
+ */
+void sched_port_init(void);
+uint32_t sched_port_now(void);
+void sched_port_sleep(uint32_t ms);
+uint32_t sched_port_lock(void);
+void sched_port_unlock(uint32_t key);
+
+/* LPC17xx port, to be called from RIT_IRQHandler */
+void sched_ritHandler(void);
+
+
+#endif /* end __SCHED_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -0,0 +1,133 @@
+/*****************************************************************************
+ *   sched_port.c:  Scheduler port for the LPC17xx (RIT time base, WFI)
+ *
+******************************************************************************/
+
+/*
+ * The repetitive interrupt timer (RIT) runs free and is the time base of
+ * the scheduler. To sleep, the compare register is set to the wake-up time
+ * and the core waits in WFI. The application must forward RIT_IRQHandler
+ * to sched_ritHandler().
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "LPC17xx.h"
+#include "lpc17xx_clkpwr.h"
+#include "lpc17xx_rit.h"
+#include "sched.h"
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static uint32_t ticksPerMs = 0;
+
+/* RIT counter at the last update of 'ms' and the ticks not yet counted */
+static uint32_t lastCount = 0;
+static uint32_t remainder = 0;
+static uint32_t ms = 0;
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Start the RIT counting. Must be called with interrupts enabled.
+ *
+ *****************************************************************************/
+void sched_port_init(void)
+{
+    RIT_Init(LPC_RIT);
+    ticksPerMs = CLKPWR_GetPCLK(CLKPWR_PCLKSEL_RIT) / 1000;
+
+    lastCount = LPC_RIT->RICOUNTER;
+    remainder = 0;
+    ms = 0;
+
+    NVIC_ClearPendingIRQ(RIT_IRQn);
+    NVIC_EnableIRQ(RIT_IRQn);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the time in ms. Must be called at least once per RIT wrap-around
+ *    (171 s at 25 MHz), which sched_idle guarantees. May be called from
+ *    an interrupt handler.
+ *
+ *****************************************************************************/
+uint32_t sched_port_now(void)
+{
+    uint32_t key = sched_port_lock();
+    uint32_t count = LPC_RIT->RICOUNTER;
+    uint32_t now;
+
+    remainder += count - lastCount;
+    lastCount = count;
+
+    ms += remainder / ticksPerMs;
+    remainder %= ticksPerMs;
+    now = ms;
+
+    sched_port_unlock(key);
+
+    return now;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Sleep for at most 'timeout' milliseconds. Called with interrupts
+ *    masked, WFI still returns on a pending interrupt.
+ *
+ *****************************************************************************/
+void sched_port_sleep(uint32_t timeout)
+{
+    LPC_RIT->RICOMPVAL = LPC_RIT->RICOUNTER + timeout * ticksPerMs;
+    __WFI();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Mask interrupts
+ *
+ * Returns:
+ *    Key to pass to sched_port_unlock
+ *
+ *****************************************************************************/
+uint32_t sched_port_lock(void)
+{
+    uint32_t key = __get_PRIMASK();
+
+    __disable_irq();
+
+    return key;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Restore the interrupt mask saved by sched_port_lock
+ *
+ *****************************************************************************/
+void sched_port_unlock(uint32_t key)
+{
+    __set_PRIMASK(key);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    RIT compare match, only used to end a WFI
+ *
+ *****************************************************************************/
+void sched_ritHandler(void)
+{
+    RIT_GetIntStatus(LPC_RIT);
+}
@@ -0,0 +1,99 @@
+/*****************************************************************************
+ *   screens.c:  Static text and frames of the OLED pages
+ *
+******************************************************************************/
+
+/*
+ * These layouts are rendered into screens_img.c by the host tool
+ * assignment/host/screen_gen, the firmware shows the images. Regenerate
+ * the images after changing anything here:
+ *
+ *   cmake --build build-host --target screens
+ *
+ * The values and the menu cursor are drawn at run time (see main.c).
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stddef.h>
+#include "screens.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+/* scale of the titles on the single value pages */
+#define BIG_FONT 2
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static const char STR_MAIN_TITLE[] = "MODE: MONITOR";
+static const char STR_MAIN_LUX[] = "LUX : ";
+static const char STR_MAIN_TEMP[] = "TEMP: ";
+static const char STR_MAIN_ACCX[] = "ACCX: ";
+static const char STR_MAIN_ACCY[] = "ACCY: ";
+static const char STR_MAIN_ACCZ[] = "ACCZ: ";
+
+static const char STR_BIG_TEMP[] = "TEMP   ";
+static const char STR_BIG_LIGHT[] = "LUX   ";
+static const char STR_BIG_ACCX[] = "ACC X  ";
+static const char STR_BIG_ACCY[] = "ACC Y  ";
+static const char STR_BIG_ACCZ[] = "ACC Z  ";
+
+static const char STR_FUNC_TITLE[] = "Select Function:";
+static const char STR_FUNC_1[] = "Siren       ";
+static const char STR_FUNC_2[] = "SOS to CEMS ";
+static const char STR_FUNC_3[] = "Lights      ";
+
+/* all sensor values */
+static const ui_text_t mainTexts[] = {
+    { 1, 1, 1, STR_MAIN_TITLE },
+    { 2, 12, 1, STR_MAIN_LUX },
+    { 2, 22, 1, STR_MAIN_TEMP },
+    { 2, 32, 1, STR_MAIN_ACCX },
+    { 2, 42, 1, STR_MAIN_ACCY },
+    { 2, 52, 1, STR_MAIN_ACCZ },
+};
+static const ui_rect_t mainRects[] = {
+    { 0, 10, 95, 62 },
+};
+
+/* one value in big digits */
+static const ui_text_t tempTexts[] = { { 20, 1, BIG_FONT, STR_BIG_TEMP } };
+static const ui_text_t lightTexts[] = { { 30, 1, BIG_FONT, STR_BIG_LIGHT } };
+static const ui_text_t accXTexts[] = { { 15, 1, BIG_FONT, STR_BIG_ACCX } };
+static const ui_text_t accYTexts[] = { { 15, 1, BIG_FONT, STR_BIG_ACCY } };
+static const ui_text_t accZTexts[] = { { 15, 1, BIG_FONT, STR_BIG_ACCZ } };
+
+/* function menu */
+static const ui_text_t funcTexts[] = {
+    { 1, 1, 1, STR_FUNC_TITLE },
+    { 9, 13, 1, STR_FUNC_1 },
+    { 9, 27, 1, STR_FUNC_2 },
+    { 9, 39, 1, STR_FUNC_3 },
+};
+static const ui_rect_t funcRects[] = {
+    { 0, 10, 95, 23 },
+    { 0, 23, 95, 36 },
+    { 0, 36, 95, 49 },
+};
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+const ui_layout_t screenLayouts[NUM_PAGES] = {
+    [PAGE_MAIN] = { mainTexts, COUNT(mainTexts), mainRects, COUNT(mainRects) },
+    [PAGE_TEMP] = { tempTexts, 1, NULL, 0 },
+    [PAGE_LIGHT] = { lightTexts, 1, NULL, 0 },
+    [PAGE_ACCX] = { accXTexts, 1, NULL, 0 },
+    [PAGE_ACCY] = { accYTexts, 1, NULL, 0 },
+    [PAGE_ACCZ] = { accZTexts, 1, NULL, 0 },
+    [PAGE_FUNC] = { funcTexts, COUNT(funcTexts), funcRects, COUNT(funcRects) },
+};
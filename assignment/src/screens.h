@@ -0,0 +1,35 @@
+/*****************************************************************************
+ *   screens.h:  Header file for the static part of the OLED pages
+ *
+******************************************************************************/
+#ifndef __SCREENS_H
+#define __SCREENS_H
+
+#include <stdint.h>
+#include "oled.h"
+#include "ui.h"
+
+/* index in screenLayouts, screenImages and the page table */
+enum
+{
+    PAGE_MAIN,
+    PAGE_TEMP,
+    PAGE_LIGHT,
+    PAGE_ACCX,
+    PAGE_ACCY,
+    PAGE_ACCZ,
+    PAGE_FUNC,
+    NUM_PAGES
+};
+
+/* screens.c */
+extern const ui_layout_t screenLayouts[NUM_PAGES];
+
+/* screens_img.c, generated from screenLayouts by host/screen_gen */
+extern const uint8_t screenImages[NUM_PAGES][OLED_FB_SIZE];
+
+
+#endif /* end __SCREENS_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -0,0 +1,523 @@
+/*****************************************************************************
+ *   telem.c:  Binary telemetry frames
+ *
+******************************************************************************/
+
+/*
+ * A frame is
+ *
+ *   type (1) | seq (1) | time in ms (4) | payload (0..128) | CRC-16 (2)
+ *
+ * with all multi-byte fields little endian. The CRC is CRC-16/CCITT-FALSE
+ * (polynomial 0x1021, initial value 0xFFFF) over everything before it.
+ * The frame is COBS encoded, so it contains no zero bytes, and terminated
+ * with a single zero byte. A receiver resynchronizes on the next zero
+ * after an error and detects lost frames from gaps in the sequence
+ * number, which is shared by all frame types.
+ *
+ * A sensor record (TELEM_RECORD) takes 18 bytes on the wire.
+ *
+ * A TELEM_BATCH payload is the sample period in ms followed by the
+ * samples, all as varints (7 bits per byte, least significant group
+ * first, top bit set on all but the last byte). Each sample starts with
+ * a byte with one bit per field (temp, light, accX, accY, accZ) that
+ * changed since the previous sample, followed by the zigzag coded
+ * difference of each changed field. The first sample is coded against an
+ * all zero sample. An unchanged sample costs a single byte. The frame
+ * timestamp is the time of the first sample.
+ *
+ * This file has no hardware dependencies and is also built on the host,
+ * where the decoder is used, see assignment/host.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stddef.h>
+#include <string.h>
+#include "telem.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define TELEM_MAX_RAW (TELEM_HEADER_LEN + TELEM_MAX_PAYLOAD + TELEM_CRC_LEN)
+
+/* longest COBS block, 254 data bytes */
+#define COBS_MAX_CODE 0xFF
+
+#define BATCH_FIELDS 5
+
+/* change mask plus a worst case (17 bit) varint per field */
+#define BATCH_MAX_SAMPLE_LEN (1 + BATCH_FIELDS * 3)
+
+#define ZIGZAG(v) (((uint32_t)(v) << 1) ^ (uint32_t)((v) >> 31))
+#define UNZIGZAG(u) ((int32_t)((u) >> 1) ^ -(int32_t)((u) & 1))
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static uint8_t seq = 0;
+
+/* CRC-16/CCITT-FALSE, one entry per value of the top byte */
+static const uint16_t crcTable[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0,
+};
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t putVarint(uint8_t *p, uint32_t v)
+{
+    uint32_t n = 0;
+
+    while (v >= 0x80) {
+        p[n++] = (v & 0x7F) | 0x80;
+        v >>= 7;
+    }
+    p[n++] = v;
+
+    return n;
+}
+
+/* returns the number of bytes used, 0 if the varint is truncated */
+static uint32_t getVarint(const uint8_t *p, uint32_t len, uint32_t *v)
+{
+    uint32_t n = 0;
+    uint32_t shift = 0;
+
+    *v = 0;
+    while (n < len && shift < 32) {
+        *v |= (uint32_t)(p[n] & 0x7F) << shift;
+        if ((p[n++] & 0x80) == 0) {
+            return n;
+        }
+        shift += 7;
+    }
+
+    return 0;
+}
+
+static void sampleFields(const telem_sample_t *s, int32_t *f)
+{
+    f[0] = s->temp;
+    f[1] = s->light;
+    f[2] = s->accX;
+    f[3] = s->accY;
+    f[4] = s->accZ;
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Build an encoded, zero terminated frame. Every call uses the next
+ *    sequence number.
+ *
+ * Params:
+ *   [in] type - frame type, TELEM_x
+ *   [in] time - timestamp in ms
+ *   [in] payload - payload, may be NULL if len is 0
+ *   [in] len - payload length, at most TELEM_MAX_PAYLOAD
+ *   [out] frame - output, TELEM_FRAME_LEN(len) bytes
+ *
+ * Returns:
+ *   Number of bytes written to frame, 0 if the payload is too long
+ *
+ *****************************************************************************/
+uint32_t telem_encode(uint8_t type, uint32_t time, const uint8_t *payload,
+        uint32_t len, uint8_t *frame)
+{
+    uint8_t raw[TELEM_MAX_RAW];
+    uint32_t n;
+
+    if (len > TELEM_MAX_PAYLOAD) {
+        return 0;
+    }
+
+    raw[0] = type;
+    raw[1] = seq++;
+    put16(&raw[2], time & 0xFFFF);
+    put16(&raw[4], time >> 16);
+    if (len > 0) {
+        memcpy(&raw[TELEM_HEADER_LEN], payload, len);
+    }
+    n = TELEM_HEADER_LEN + len;
+    put16(&raw[n], telem_crc16(raw, n, 0xFFFF));
+    n += TELEM_CRC_LEN;
+
+    n = telem_cobsEncode(raw, n, frame);
+    frame[n++] = 0;
+
+    return n;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Decode and check one frame
+ *
+ * Params:
+ *   [in] data - the bytes between two zero delimiters
+ *   [in] len - number of bytes
+ *   [out] frame - the decoded frame
+ *
+ * Returns:
+ *   0 on success, -1 if the frame is malformed or the CRC doesn't match
+ *
+ *****************************************************************************/
+int telem_decode(const uint8_t *data, uint32_t len, telem_frame_t *frame)
+{
+    uint8_t raw[TELEM_MAX_RAW + 1];
+    int n;
+
+    if (len > TELEM_MAX_RAW + 1) {
+        return (-1);
+    }
+
+    n = telem_cobsDecode(data, len, raw);
+    if (n < TELEM_HEADER_LEN + TELEM_CRC_LEN || n > TELEM_MAX_RAW) {
+        return (-1);
+    }
+
+    n -= TELEM_CRC_LEN;
+    if (telem_crc16(raw, n, 0xFFFF) != get16(&raw[n])) {
+        return (-1);
+    }
+
+    frame->type = raw[0];
+    frame->seq = raw[1];
+    frame->time = get16(&raw[2]) | ((uint32_t)get16(&raw[4]) << 16);
+    frame->len = n - TELEM_HEADER_LEN;
+    memcpy(frame->payload, &raw[TELEM_HEADER_LEN], frame->len);
+
+    return (0);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Serialize a sensor record into TELEM_RECORD_LEN payload bytes
+ *
+ *****************************************************************************/
+void telem_packRecord(const telem_record_t *rec, uint8_t *payload)
+{
+    put16(&payload[0], (uint16_t)rec->temp);
+    put16(&payload[2], rec->light);
+    payload[4] = (uint8_t)rec->accX;
+    payload[5] = (uint8_t)rec->accY;
+    payload[6] = (uint8_t)rec->accZ;
+    payload[7] = rec->flags;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Deserialize a sensor record from TELEM_RECORD_LEN payload bytes
+ *
+ *****************************************************************************/
+void telem_unpackRecord(const uint8_t *payload, telem_record_t *rec)
+{
+    rec->temp = (int16_t)get16(&payload[0]);
+    rec->light = get16(&payload[2]);
+    rec->accX = (int8_t)payload[4];
+    rec->accY = (int8_t)payload[5];
+    rec->accZ = (int8_t)payload[6];
+    rec->flags = payload[7];
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Serialize a timestamped record into TELEM_LOG_ENTRY_LEN bytes
+ *
+ *****************************************************************************/
+void telem_packLogEntry(uint32_t time, const telem_record_t *rec,
+        uint8_t *entry)
+{
+    put16(&entry[0], time & 0xFFFF);
+    put16(&entry[2], time >> 16);
+    telem_packRecord(rec, &entry[4]);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Deserialize a timestamped record from TELEM_LOG_ENTRY_LEN bytes
+ *
+ *****************************************************************************/
+void telem_unpackLogEntry(const uint8_t *entry, uint32_t *time,
+        telem_record_t *rec)
+{
+    *time = get16(&entry[0]) | ((uint32_t)get16(&entry[2]) << 16);
+    telem_unpackRecord(&entry[4], rec);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Start a new TELEM_BATCH block
+ *
+ * Params:
+ *   [out] batch - the block
+ *   [in] period - sample period in ms
+ *
+ *****************************************************************************/
+void telem_batchInit(telem_batch_t *batch, uint32_t period)
+{
+    batch->period = period;
+    batch->count = 0;
+    batch->len = putVarint(batch->payload, period);
+    batch->last.temp = 0;
+    batch->last.light = 0;
+    batch->last.accX = 0;
+    batch->last.accY = 0;
+    batch->last.accZ = 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Append a sample to a block. Samples are assumed to be taken every
+ *    period ms. When the block is full it must be sent (payload, len,
+ *    time) and restarted with telem_batchInit.
+ *
+ * Params:
+ *   [in] batch - the block
+ *   [in] time - time of the sample in ms, only used for the first one
+ *   [in] sample - the sample
+ *
+ * Returns:
+ *   1 if the block is full, 0 otherwise
+ *
+ *****************************************************************************/
+int telem_batchAdd(telem_batch_t *batch, uint32_t time,
+        const telem_sample_t *sample)
+{
+    int32_t cur[BATCH_FIELDS];
+    int32_t prev[BATCH_FIELDS];
+    uint32_t mask = 0;
+    uint32_t maskPos;
+    uint32_t i;
+
+    if (batch->count == 0) {
+        batch->time = time;
+    }
+
+    sampleFields(sample, cur);
+    sampleFields(&batch->last, prev);
+
+    maskPos = batch->len++;
+    for (i = 0; i < BATCH_FIELDS; i++) {
+        if (cur[i] != prev[i]) {
+            mask |= 1 << i;
+            batch->len += putVarint(&batch->payload[batch->len],
+                    ZIGZAG(cur[i] - prev[i]));
+        }
+    }
+    batch->payload[maskPos] = mask;
+
+    batch->last = *sample;
+    batch->count++;
+
+    return (batch->count >= TELEM_BATCH_MAX
+            || batch->len + BATCH_MAX_SAMPLE_LEN > TELEM_MAX_PAYLOAD);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Decode a TELEM_BATCH payload
+ *
+ * Params:
+ *   [in] payload - the payload
+ *   [in] len - payload length
+ *   [out] period - sample period in ms
+ *   [out] samples - decoded samples
+ *   [in] max - room in samples
+ *
+ * Returns:
+ *   Number of samples, -1 if the payload is malformed
+ *
+ *****************************************************************************/
+int telem_batchDecode(const uint8_t *payload, uint32_t len, uint32_t *period,
+        telem_sample_t *samples, uint32_t max)
+{
+    int32_t f[BATCH_FIELDS] = { 0 };
+    uint32_t pos;
+    uint32_t count = 0;
+    uint32_t mask;
+    uint32_t v;
+    uint32_t n;
+    uint32_t i;
+
+    pos = getVarint(payload, len, period);
+    if (pos == 0) {
+        return (-1);
+    }
+
+    while (pos < len) {
+        mask = payload[pos++];
+        if (mask >> BATCH_FIELDS != 0 || count >= max) {
+            return (-1);
+        }
+
+        for (i = 0; i < BATCH_FIELDS; i++) {
+            if (mask & (1 << i)) {
+                n = getVarint(&payload[pos], len - pos, &v);
+                if (n == 0) {
+                    return (-1);
+                }
+                pos += n;
+                f[i] += UNZIGZAG(v);
+            }
+        }
+
+        samples[count].temp = f[0];
+        samples[count].light = f[1];
+        samples[count].accX = f[2];
+        samples[count].accY = f[3];
+        samples[count].accZ = f[4];
+        count++;
+    }
+
+    return count;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Update a CRC-16/CCITT-FALSE. Start with crc = 0xFFFF.
+ *
+ *****************************************************************************/
+uint16_t telem_crc16(const uint8_t *data, uint32_t len, uint16_t crc)
+{
+    while (len-- > 0) {
+        crc = (crc << 8) ^ crcTable[(crc >> 8) ^ *data++];
+    }
+
+    return crc;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    COBS encode a buffer. The output holds no zero bytes and is at most
+ *    len + len / 254 + 1 bytes long. No delimiter is appended.
+ *
+ * Returns:
+ *   Number of bytes written to dst
+ *
+ *****************************************************************************/
+uint32_t telem_cobsEncode(const uint8_t *src, uint32_t len, uint8_t *dst)
+{
+    uint32_t code = 0;      /* where the current block's code byte goes */
+    uint32_t n = 1;
+    uint8_t run = 1;
+
+    while (len-- > 0) {
+        if (*src == 0) {
+            dst[code] = run;
+            code = n++;
+            run = 1;
+        } else {
+            dst[n++] = *src;
+            if (++run == COBS_MAX_CODE) {
+                dst[code] = run;
+                code = n++;
+                run = 1;
+            }
+        }
+        src++;
+    }
+    dst[code] = run;
+
+    return n;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    COBS decode a buffer (without its delimiter). dst must hold len bytes.
+ *
+ * Returns:
+ *   Number of decoded bytes, -1 if the input is malformed
+ *
+ *****************************************************************************/
+int telem_cobsDecode(const uint8_t *src, uint32_t len, uint8_t *dst)
+{
+    uint32_t i = 0;
+    uint32_t n = 0;
+    uint32_t end;
+    uint8_t code;
+
+    while (i < len) {
+        code = src[i++];
+        end = i + code - 1;
+        if (code == 0 || end > len) {
+            return (-1);
+        }
+
+        while (i < end) {
+            if (src[i] == 0) {
+                return (-1);
+            }
+            dst[n++] = src[i++];
+        }
+
+        /* a short block stands for a zero, except at the end */
+        if (code < COBS_MAX_CODE && i < len) {
+            dst[n++] = 0;
+        }
+    }
+
+    return n;
+}
@@ -0,0 +1,109 @@
+/*****************************************************************************
+ *   telem.h:  Header file for the binary telemetry frames
+ *
+******************************************************************************/
+#ifndef __TELEM_H
+#define __TELEM_H
+
+#include <stdint.h>
+
+/* frame types */
+#define TELEM_RECORD 0x01       /* sensor record, see telem_record_t */
+#define TELEM_EVENT  0x02       /* event code, optionally followed by text */
+#define TELEM_TEXT   0x03       /* free text (diagnostics) */
+#define TELEM_BATCH  0x04       /* block of delta coded samples */
+#define TELEM_LOG    0x05       /* boot number, then logged records */
+
+/* TELEM_EVENT codes */
+#define TELEM_EVENT_MONITOR 0x01    /* entered MONITOR mode */
+#define TELEM_EVENT_CEMS    0x02    /* assistance requested, text: user id */
+
+/* telem_record_t flags */
+#define TELEM_FLAG_FIRE     0x01
+#define TELEM_FLAG_DARK     0x02    /* movement in darkness */
+
+/* type, sequence number, timestamp */
+#define TELEM_HEADER_LEN 6
+#define TELEM_CRC_LEN 2
+#define TELEM_MAX_PAYLOAD 128
+#define TELEM_RECORD_LEN 8
+
+/* TELEM_LOG entry: time (ms since boot) and record */
+#define TELEM_LOG_ENTRY_LEN (4 + TELEM_RECORD_LEN)
+#define TELEM_LOG_MAX_ENTRIES ((TELEM_MAX_PAYLOAD - 2) / TELEM_LOG_ENTRY_LEN)
+
+/* most samples in one TELEM_BATCH block */
+#define TELEM_BATCH_MAX 50
+
+/* worst case encoded size of a frame, COBS overhead and delimiter included */
+#define TELEM_FRAME_LEN(payloadLen) \
+    ((TELEM_HEADER_LEN + (payloadLen) + TELEM_CRC_LEN) \
+    + (TELEM_HEADER_LEN + (payloadLen) + TELEM_CRC_LEN) / 254 + 2)
+
+typedef struct
+{
+    int16_t temp;           /* 0.1 degrees C */
+    uint16_t light;         /* lux */
+    int8_t accX;            /* relative to the reference reading */
+    int8_t accY;
+    int8_t accZ;
+    uint8_t flags;          /* TELEM_FLAG_x */
+} telem_record_t;
+
+/* one fast sample, the fields of a record without the flags */
+typedef struct
+{
+    int16_t temp;
+    uint16_t light;
+    int8_t accX;
+    int8_t accY;
+    int8_t accZ;
+} telem_sample_t;
+
+/* TELEM_BATCH block being built, see telem_batchAdd */
+typedef struct
+{
+    uint32_t time;          /* ms, first sample */
+    uint32_t period;        /* ms between samples */
+    uint32_t count;
+    uint32_t len;
+    telem_sample_t last;
+    uint8_t payload[TELEM_MAX_PAYLOAD];
+} telem_batch_t;
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t seq;
+    uint32_t time;          /* ms */
+    uint32_t len;
+    uint8_t payload[TELEM_MAX_PAYLOAD];
+} telem_frame_t;
+
+
+uint32_t telem_encode(uint8_t type, uint32_t time, const uint8_t *payload,
+        uint32_t len, uint8_t *frame);
+int telem_decode(const uint8_t *data, uint32_t len, telem_frame_t *frame);
+
+void telem_packRecord(const telem_record_t *rec, uint8_t *payload);
+void telem_unpackRecord(const uint8_t *payload, telem_record_t *rec);
+void telem_packLogEntry(uint32_t time, const telem_record_t *rec,
+        uint8_t *entry);
+void telem_unpackLogEntry(const uint8_t *entry, uint32_t *time,
+        telem_record_t *rec);
+
+void telem_batchInit(telem_batch_t *batch, uint32_t period);
+int telem_batchAdd(telem_batch_t *batch, uint32_t time,
+        const telem_sample_t *sample);
+int telem_batchDecode(const uint8_t *payload, uint32_t len, uint32_t *period,
+        telem_sample_t *samples, uint32_t max);
+
+uint16_t telem_crc16(const uint8_t *data, uint32_t len, uint16_t crc);
+uint32_t telem_cobsEncode(const uint8_t *src, uint32_t len, uint8_t *dst);
+int telem_cobsDecode(const uint8_t *src, uint32_t len, uint8_t *dst);
+
+
+#endif /* end __TELEM_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -0,0 +1,343 @@
+/*****************************************************************************
+ *   ui.c:  OLED pages and menu, driven by input events
+ *
+******************************************************************************/
+
+/*
+ * The screens are described by a table of ui_page_t (see ui.h). Input is
+ * posted as events (ui_post) and applied by ui_service, which also draws:
+ *
+ * - a page change copies the page's pre-rendered image into the
+ *   framebuffer (or draws its layout if it has none). The OLED driver
+ *   only sends the columns that differ from what the display shows, so
+ *   switching between similar pages costs a few columns.
+ * - a field is redrawn only when its bound value has changed since it was
+ *   drawn.
+ * - a menu move redraws the old and the new cursor.
+ *
+ * The OLED must be in deferred flush mode; the caller pushes the changes
+ * with oled_flush when ui_service returns 1. All functions must be called
+ * from task context, the ISRs post events through a task.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stddef.h>
+#include "ui.h"
+#include "oled.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define QUEUE_MASK (UI_QUEUE_SIZE - 1)
+
+#define CURSOR_CHAR ">"
+#define BLANK_CHAR " "
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static const ui_page_t *pageTable = NULL;
+static uint8_t numPageTable = 0;
+static void (*notifyTask)(void) = NULL;
+
+static uint8_t current = UI_NO_PAGE;
+static uint8_t item = 0;
+
+/* the page has to be drawn from scratch */
+static uint8_t redraw = 0;
+/* the cursor has moved from this item */
+static uint8_t oldItem = 0;
+static uint8_t moveCursor = 0;
+
+/* values on the screen, valid[i] is 0 until field i is drawn */
+static int32_t shown[UI_MAX_FIELDS];
+static uint8_t valid[UI_MAX_FIELDS];
+
+static ui_event_t queue[UI_QUEUE_SIZE];
+static uint8_t head = 0;
+static uint8_t tail = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static void drawText(uint8_t x, uint8_t y, uint8_t size, const char *text)
+{
+    if (size <= 1) {
+        oled_putString(x, y, (uint8_t *) text, OLED_COLOR_WHITE,
+                OLED_COLOR_BLACK);
+    } else {
+        oled_putBigString(x, y, (uint8_t *) text, OLED_COLOR_WHITE,
+                OLED_COLOR_BLACK, size);
+    }
+}
+
+static void drawCursor(const ui_page_t *p, uint8_t i, const char *ch)
+{
+    drawText(p->cursorX, p->cursorY + i * p->cursorStep, 1, ch);
+}
+
+static void drawPage(const ui_page_t *p)
+{
+    uint8_t i;
+
+    if (p->image != NULL) {
+        oled_loadFramebuffer(p->image);
+    } else {
+        ui_drawLayout(p->layout);
+    }
+
+    if (p->numItems > 0) {
+        /* the selection is kept across pages */
+        if (item >= p->numItems) {
+            item = 0;
+        }
+        drawCursor(p, item, CURSOR_CHAR);
+    }
+
+    for (i = 0; i < UI_MAX_FIELDS; i++) {
+        valid[i] = 0;
+    }
+}
+
+/* returns 1 if a field was drawn */
+static uint8_t drawFields(const ui_page_t *p)
+{
+    char text[UI_FIELD_LEN + 1];
+    uint8_t drawn = 0;
+    int32_t v;
+    uint8_t i;
+
+    for (i = 0; i < p->numFields && i < UI_MAX_FIELDS; i++) {
+        v = p->fields[i].value();
+        if (valid[i] && shown[i] == v) {
+            continue;
+        }
+
+        p->fields[i].format(v, text);
+        text[UI_FIELD_LEN] = '\0';
+        drawText(p->fields[i].x, p->fields[i].y, p->fields[i].size, text);
+
+        shown[i] = v;
+        valid[i] = 1;
+        drawn = 1;
+    }
+
+    return drawn;
+}
+
+static void apply(ui_event_t event)
+{
+    const ui_page_t *p = &pageTable[current];
+
+    switch (event) {
+    case UI_EVENT_NEXT:
+    case UI_EVENT_PREV:
+        current = (event == UI_EVENT_NEXT) ? p->next : p->prev;
+        redraw = 1;
+        break;
+    case UI_EVENT_UP:
+    case UI_EVENT_DOWN:
+        if (p->numItems == 0) {
+            break;
+        }
+        if (!moveCursor) {
+            oldItem = item;
+            moveCursor = 1;
+        }
+        if (event == UI_EVENT_DOWN) {
+            item = (item + 1 == p->numItems) ? 0 : item + 1;
+        } else {
+            item = (item == 0) ? p->numItems - 1 : item - 1;
+        }
+        break;
+    case UI_EVENT_SELECT:
+        if (p->numItems > 0 && p->select != NULL) {
+            p->select(item);
+        }
+        break;
+    }
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Install the page table. Nothing is shown until ui_show.
+ *
+ * Params:
+ *   [in] pages - page table, must stay valid
+ *   [in] numPages - number of pages
+ *   [in] notify - called by ui_post, e.g. to post the task calling
+ *                 ui_service, may be NULL
+ *
+ *****************************************************************************/
+void ui_init (const ui_page_t *pages, uint8_t numPages, void (*notify)(void))
+{
+    pageTable = pages;
+    numPageTable = numPages;
+    notifyTask = notify;
+    current = UI_NO_PAGE;
+    head = tail = 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Queue an input event. Events are dropped while nothing is shown or
+ *    when the queue is full.
+ *
+ * Params:
+ *   [in] event - the event
+ *
+ *****************************************************************************/
+void ui_post(ui_event_t event)
+{
+    if (current == UI_NO_PAGE || (uint8_t)(head - tail) == UI_QUEUE_SIZE) {
+        return;
+    }
+
+    queue[head & QUEUE_MASK] = event;
+    head++;
+
+    if (notifyTask != NULL) {
+        notifyTask();
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Apply the queued events and draw what has changed into the OLED
+ *    framebuffer
+ *
+ * Returns:
+ *   1 if something was drawn (call oled_flush), otherwise 0
+ *
+ *****************************************************************************/
+uint8_t ui_service(void)
+{
+    const ui_page_t *p;
+    uint8_t drawn = 0;
+
+    if (current == UI_NO_PAGE) {
+        return 0;
+    }
+
+    while (tail != head) {
+        apply(queue[tail & QUEUE_MASK]);
+        tail++;
+    }
+
+    p = &pageTable[current];
+
+    if (redraw) {
+        drawPage(p);
+        redraw = 0;
+        moveCursor = 0;
+        drawn = 1;
+    } else if (moveCursor) {
+        drawCursor(p, oldItem, BLANK_CHAR);
+        drawCursor(p, item, CURSOR_CHAR);
+        moveCursor = 0;
+        drawn = 1;
+    }
+
+    drawn |= drawFields(p);
+
+    return drawn;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Show a page with the first menu item selected. Drawn by the next
+ *    ui_service call.
+ *
+ * Params:
+ *   [in] page - index in the page table
+ *
+ *****************************************************************************/
+void ui_show(uint8_t page)
+{
+    if (page >= numPageTable) {
+        return;
+    }
+
+    head = tail = 0;
+    current = page;
+    item = 0;
+    redraw = 1;
+    moveCursor = 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Stop drawing and drop the queued events. The screen is left as is.
+ *
+ *****************************************************************************/
+void ui_hide(void)
+{
+    current = UI_NO_PAGE;
+    head = tail = 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the page shown
+ *
+ * Returns:
+ *   index in the page table, UI_NO_PAGE if nothing is shown
+ *
+ *****************************************************************************/
+uint8_t ui_getPage(void)
+{
+    return current;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the selected menu item of the page shown
+ *
+ *****************************************************************************/
+uint8_t ui_getItem(void)
+{
+    return item;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Clear the screen and draw a layout. Used for pages without an image
+ *    and by the host tool rendering the images.
+ *
+ * Params:
+ *   [in] layout - the layout
+ *
+ *****************************************************************************/
+void ui_drawLayout(const ui_layout_t *layout)
+{
+    uint8_t i;
+
+    oled_clearScreen(OLED_COLOR_BLACK);
+
+    for (i = 0; i < layout->numTexts; i++) {
+        drawText(layout->texts[i].x, layout->texts[i].y,
+                layout->texts[i].size, layout->texts[i].text);
+    }
+    for (i = 0; i < layout->numRects; i++) {
+        oled_rect(layout->rects[i].x0, layout->rects[i].y0,
+                layout->rects[i].x1, layout->rects[i].y1, OLED_COLOR_WHITE);
+    }
+}
@@ -0,0 +1,112 @@
+/*****************************************************************************
+ *   ui.h:  Header file for the OLED page and menu layer
+ *
+******************************************************************************/
+#ifndef __UI_H
+#define __UI_H
+
+#include <stdint.h>
+
+/* longest field text */
+#define UI_FIELD_LEN 16
+
+/* most fields on a page */
+#define UI_MAX_FIELDS 8
+
+/* number of queued events, must be a power of 2 */
+#define UI_QUEUE_SIZE 8
+
+/* returned by ui_getPage while nothing is shown */
+#define UI_NO_PAGE 0xFF
+
+/* input events, see ui_post */
+typedef enum
+{
+    UI_EVENT_NEXT,          /* next page */
+    UI_EVENT_PREV,          /* previous page */
+    UI_EVENT_UP,            /* previous menu item */
+    UI_EVENT_DOWN,          /* next menu item */
+    UI_EVENT_SELECT         /* run the page's select function */
+} ui_event_t;
+
+/* static text, size 1 is the 5x7 font, larger sizes are scaled */
+typedef struct
+{
+    uint8_t x;
+    uint8_t y;
+    uint8_t size;
+    const char *text;
+} ui_text_t;
+
+typedef struct
+{
+    uint8_t x0;
+    uint8_t y0;
+    uint8_t x1;
+    uint8_t y1;
+} ui_rect_t;
+
+/* the static part of a page, drawn on a cleared screen */
+typedef struct
+{
+    const ui_text_t *texts;
+    uint8_t numTexts;
+    const ui_rect_t *rects;
+    uint8_t numRects;
+} ui_layout_t;
+
+/*
+ * A value drawn as text. The field is redrawn when value() returns a
+ * different value than the one on the screen. format writes the text,
+ * at most UI_FIELD_LEN characters; it should pad with blanks to cover
+ * longer texts of other values.
+ */
+typedef struct
+{
+    uint8_t x;
+    uint8_t y;
+    uint8_t size;
+    int32_t (*value)(void);
+    void (*format)(int32_t value, char *text);
+} ui_field_t;
+
+/*
+ * One screen. The layout is drawn once when the page is shown, copied
+ * from image if the page has one: the layout rendered at build time
+ * (OLED_FB_SIZE bytes, see assignment/host/screen_gen.c). Pages with menu
+ * items draw a cursor at cursorX, cursorY + item * cursorStep; UP/DOWN
+ * move it and SELECT calls select with the item. next/prev are the pages
+ * shown for NEXT/PREV.
+ */
+typedef struct
+{
+    const ui_layout_t *layout;
+    const uint8_t *image;   /* NULL: draw the layout */
+    const ui_field_t *fields;
+    uint8_t numFields;
+
+    uint8_t numItems;
+    uint8_t cursorX;
+    uint8_t cursorY;
+    uint8_t cursorStep;
+    void (*select)(uint8_t item);
+
+    uint8_t next;
+    uint8_t prev;
+} ui_page_t;
+
+
+void ui_init (const ui_page_t *pages, uint8_t numPages, void (*notify)(void));
+void ui_post(ui_event_t event);
+uint8_t ui_service(void);
+void ui_show(uint8_t page);
+void ui_hide(void);
+uint8_t ui_getPage(void);
+uint8_t ui_getItem(void);
+void ui_drawLayout(const ui_layout_t *layout);
+
+
+#endif /* end __UI_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/